@@ -8,7 +8,31 @@
  */
 
 /* Accepts an argument "n" for the largest value up to which we should search
- * for all consecutive odd numbers that are prime.
+ * for all consecutive odd numbers that are prime, an argument "m" for the
+ * method used to find the primes, and any number of "t" arguments each giving
+ * a prime pattern to count as a comma-separated list of offsets.
+ *
+ *     -m sieve  (default) sieve {1, ..., n} with the segmented bit sieve from
+ *               chap05 and count the patterns in the sieved bits
+ *     -m trial  check every odd number with check_prime (only the twin
+ *               pattern is supported)
+ *     -m mr     check every odd number with the Miller-Rabin test
+ *               check_prime_mr (only the twin pattern is supported)
+ *     -m check  count with the sieve, then count again by checking every
+ *               member of every candidate tuple with check_prime_mr, and
+ *               compare the results
+ *
+ * For example "-t 0,2 -t 0,4 -t 0,2,6,8" counts twin primes, cousin primes,
+ * and prime quadruplets in a single pass.  The default is "-t 0,2".
+ *
+ * With the trial and mr methods an argument "s" selects how the odd numbers
+ * are split among the processes, and "c" the number of odd numbers per chunk
+ * of the dynamic schedule (default 16384).
+ *
+ *     -s block    (default) contiguous blocks of equal length
+ *     -s cost     contiguous blocks of equal estimated cost, which shrink as
+ *                 the numbers grow for the trial method
+ *     -s dynamic  chunks taken from a shared counter until none are left
  */
 
 /* Note: according to http://mathworld.wolfram.com/PrimeNumber.html a prime
@@ -29,32 +53,62 @@
  * long as all pairs are checked the algorithm is correct.
  */
 
+/* In the sieve method the rank-th process sieves the rank-th block of {1, ...,
+ * n}, plus a look-ahead region as long as the largest offset, and counts the
+ * tuples whose smallest member is in its block.  A tuple that straddles two
+ * blocks (or two segments within a block) is thus counted exactly once, by the
+ * block containing its smallest member.
+ */
+
 #include <mpi.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <getopt.h>
+#include <errno.h>
 #include "prime_num_fcns.h"
-#include "parse_n.h"
+#include "segsieve_helper.h"
+#include "tuple_fcns.h"
+#include "sched_fcns.h"
 
 #define FALSE    0
 #define TRUE     1
 
+#define METHOD_SIEVE  0
+#define METHOD_TRIAL  1
+#define METHOD_MR     2
+#define METHOD_CHECK  3
+
+void parse_tuple_args(int argc, char* argv[], long long *n, int *method,
+		      tuple_pattern *patterns, int *npatterns, int *sched,
+		      long long *chunk);
+
+void count_trial(int rank, int size, long long n, int method, int sched,
+		 long long chunk);
+
+long long count_twins_range(long long startnum, long long stopnum, long long n,
+			    int method);
+
+void count_sieve(int rank, int size, long long n, tuple_pattern *patterns,
+		 int npatterns, int check);
+
+long long count_tuples_brute(long long startnum, long long stopnum, long long n,
+			     const tuple_pattern *pattern);
+
 
 int main(int argc, char *argv[]) {
 
     int size;
     int rank;
 
-    int n;             // largest value to search for consec. odd primes
-    int startnum;      // the smallest number a process considers
-    int stopnum;       // the largest number a process considers
+    long long n;       // largest value to search for prime patterns
+    int method;        // METHOD_SIEVE, METHOD_TRIAL, METHOD_MR, or METHOD_CHECK
+    int sched;         // SCHED_* schedule of the trial and mr methods, or -1
+    long long chunk;   // odd numbers per chunk of the dynamic schedule, or 0
 
-    int curr;  // if current odd integer is prime
-    int next;  // if next odd integer is prime
-    int i;
-
-    int localct;   // track the local number of pairs of primes
-    int globalct;  // track the overall number of pairs of primes
-
-    localct = globalct = 0;
+    tuple_pattern patterns[MAX_NPATTERNS];  // the patterns to count
+    int npatterns;
 
     // Initialize the MPI environment
     MPI_Init(&argc, &argv);
@@ -65,63 +119,370 @@ int main(int argc, char *argv[]) {
 
     /* Default value of the largest value to consider in search for consecutive
      * odd primes as given by the prompt.  If an argument for n is given as an
-     * option then this value is written to *n in parse_args.
+     * option then this value is written to *n in parse_tuple_args.
      */
     n = 1e6;
-    parse_args(argc, argv, &n);
+    method = METHOD_SIEVE;
+    npatterns = 0;
+    sched = -1;
+    chunk = 0;
+    parse_tuple_args(argc, argv, &n, &method, patterns, &npatterns, &sched, &chunk);
     if (n < 2) {
 	fprintf(stderr, "n must be >= 2\n");
 	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
     }
 
-    /* Globally: split the numbers from 1 to n into size nearly evenly sized
-     * sets.  Locally: set startnum and stopnum to be the smallest and largest
-     * values of the rank-th set
-     */
-    find_process_set(rank, size, n, &startnum, &stopnum);
+    // case: no patterns specified; count twin primes
+    if (!npatterns) {
+	parse_tuple_pattern("0,2", &patterns[0]);
+	npatterns = 1;
+    }
+
+    if ((method == METHOD_TRIAL) || (method == METHOD_MR)) {
+	if ((npatterns != 1) || (patterns[0].len != 2) || (patterns[0].offsets[1] != 2)) {
+	    fprintf(stderr, "the trial and mr methods only support the pattern 0,2\n");
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	else if ((method == METHOD_TRIAL) && (n > INT_MAX - 2)) {
+	    fprintf(stderr, "the trial method requires n <= %d\n", INT_MAX - 2);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	count_trial(rank, size, n, method, (sched < 0) ? SCHED_BLOCK : sched,
+		    chunk ? chunk : DEFAULT_CHUNK);
+    }
+    else if ((sched >= 0) || chunk) {
+	fprintf(stderr, "-s and -c require the trial or mr method\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    else {
+	count_sieve(rank, size, n, patterns, npatterns, method == METHOD_CHECK);
+    }
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+
+    return 0;
+}
+
 
-    /* In the following loop we actually want to compare one odd number past
-     * stopnum; this is b/c we need to see if the largest odd number in a set
-     * and the smallest odd number in the next are both prime.  However we don't
-     * want to do this on the last set, hence conditional for this case.
+
+
+/* Count the twin primes in {2, ..., n} by checking every odd number with
+ * check_prime, or with check_prime_mr if method is METHOD_MR, and print the
+ * result.  The odd numbers are handed out to the processes with the schedule
+ * sched (see sched_fcns.h), and the busy time of each process is printed so
+ * that the balance of the schedule can be checked.
+ */
+
+void count_trial(int rank, int size, long long n, int method, int sched,
+		 long long chunk) {
+
+    long long startnum;  // the smallest number of the current range
+    long long stopnum;   // the largest number of the current range
+
+    long long localct;   // track the local number of pairs of primes
+    long long globalct;  // track the overall number of pairs of primes
+
+    work_schedule ws;
+
+    localct = globalct = 0;
+
+    /* Checking w by trial division takes about sqrt(w) steps when w is prime,
+     * while the Miller-Rabin test takes about the same time for every w
      */
-    if (rank != (size - 1)) {
+    init_schedule(&ws, sched, n, (method == METHOD_MR) ? 0.0 : 0.5, chunk);
+
+    while (next_range(&ws, &startnum, &stopnum)) {
+	localct += count_twins_range(startnum, stopnum, n, method);
+	end_range(&ws);
+    }
+
+    if (sched == SCHED_DYNAMIC) {
+	printf("rank %d processor:\n"
+	       "The number of chunks of %lld odd numbers checked is:  %lld\n"
+	       "\n",
+	       rank, chunk, ws.nranges);
+    }
+    else {
+	printf("rank %d processor:\n"
+	       "The number of times that consecutive odd numbers with the smaller\n"
+	       "between %lld and %lld (inclusive) are both prime is:  %lld\n"
+	       "\n",
+	       rank, startnum, stopnum, localct);
+    }
+
+    // Collect local consecutive primes count
+    MPI_Reduce(&localct, &globalct, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    print_busy_times(&ws);
+    free_schedule(&ws);
+
+    // Print result
+    if (rank == 0) {
+	printf("--------------------------------------------------------\n"
+	       "The number of times that consecutive odd numbers between\n"
+	       "2 and %lld (inclusive) are both prime is:  %lld\n"
+	       "--------------------------------------------------------\n"
+	       "\n",
+	       n, globalct);
+    }
+}
+
+
+
+
+/* Return the number of pairs of consecutive odd numbers i and i + 2 that are
+ * both prime, with startnum <= i <= stopnum and i + 2 <= n, where startnum is
+ * odd.
+ *
+ * In the following loop we actually want to check one odd number past stopnum;
+ * this is b/c we need to see if the largest odd number in a range and the
+ * smallest odd number in the next are both prime.  Each pair is thus counted
+ * by the range containing its smaller member, for any split of {1, ..., n}.
+ */
+
+long long count_twins_range(long long startnum, long long stopnum, long long n,
+			    int method) {
+
+    int curr;  // if current odd integer is prime
+    int next;  // if next odd integer is prime
+    long long count;
+    long long i;
+
+    if (stopnum + 2 <= n) {
 	stopnum += 2;
     }
+    else {
+	stopnum = n;
+    }
 
     /* Each iteration checks if the pair of odd numbers (i - 2) and i are both
-     * prime and if so adds 1 to localct.
+     * prime and if so adds 1 to count.
      */
+    count = 0;
     curr = FALSE;
     for (i = startnum; i <= stopnum; i += 2) {
-	next = check_prime(i);
+	next = (method == METHOD_MR) ? check_prime_mr(i) : check_prime((int) i);
 	// Add 1 if both curr and next are prime, 0 otherwise
-	localct += curr && next;
+	count += curr && next;
 	// Update curr for next iteration
 	curr = next;
     }
 
-    printf("rank %d processor:\n"
-	   "The number of times that consecutive odd numbers between \n"
-	   "%d and %d (inclusive) are both prime is:  %d\n"
-	   "\n",
-	   rank, startnum, stopnum, localct);
+    return count;
+}
 
-    // Collect local consecutive primes count
-    MPI_Reduce(&localct, &globalct, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
 
-    // Finalize the MPI environment.
-    MPI_Finalize();
+
+
+/* Count the matches of each pattern in {2, ..., n} using the segmented sieve
+ * and print the results.  If check is set, then the matches are also counted
+ * by brute force and the two sets of counts compared.
+ */
+
+void count_sieve(int rank, int size, long long n, tuple_pattern *patterns,
+		 int npatterns, int check) {
+
+    long long local_low;      // lowest odd value in local set
+    long long local_high;     // highest value in local set (can be even)
+    long long local_setsize;  // number of odd values in local set
+
+    int *primes;              // odd primes up to sqrt(n)
+    int nprimes;
+    int span;                 // largest offset among the patterns
+
+    long long localct[MAX_NPATTERNS];   // local number of matches
+    long long globalct[MAX_NPATTERNS];  // overall number of matches
+    long long brutect[MAX_NPATTERNS];   // overall number of matches by brute force
+    int agree;
+    char buf[PATTERN_STRLEN];
+    tuple_data tdata;
+    int k;
+
+    /* Calculate the smallest odd number in the rank-th set, the largest number
+     * in the rank-th set, and the number of odd values in the set
+     */
+    local_set_params_ll(1, n, rank, size, &local_low, &local_high, &local_setsize);
+
+    /* Every process needs the primes up to sqrt(n) to sieve its set; they are
+     * found together and shared
+     */
+    nprimes = gather_sieving_primes((int) isqrt_ll(n), rank, size, &primes);
+
+    /* Sieve the local set along with a look-ahead region of span / 2 odd
+     * values, counting the tuples that start in the local set
+     */
+    span = tuple_span(patterns, npatterns);
+    tdata.patterns = patterns;
+    tdata.npatterns = npatterns;
+    sieve_range(local_low, local_high, n, SEG_NBITS, span / 2,
+		primes, nprimes, count_tuples_segment, &tdata);
+    free(primes);
+
+    for (k = 0; k < npatterns; k++) {
+	localct[k] = patterns[k].count;
+    }
+
+    printf("rank %d processor:\n", rank);
+    for (k = 0; k < npatterns; k++) {
+	sprint_tuple_pattern(buf, &patterns[k]);
+	printf("The number of %s tuples with smallest member between\n"
+	       "%lld and %lld (inclusive) is:  %lld\n",
+	       buf, local_low, local_high, localct[k]);
+    }
+    printf("\n");
+
+    // Collect local pattern counts
+    MPI_Reduce(localct, globalct, npatterns, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    // Count the tuples starting in the same local set again by brute force
+    if (check) {
+	for (k = 0; k < npatterns; k++) {
+	    localct[k] = count_tuples_brute(local_low, local_high, n, &patterns[k]);
+	}
+	MPI_Reduce(localct, brutect, npatterns, MPI_LONG_LONG, MPI_SUM, 0,
+		   MPI_COMM_WORLD);
+    }
 
     // Print result
     if (rank == 0) {
+	printf("--------------------------------------------------------\n");
+	for (k = 0; k < npatterns; k++) {
+	    sprint_tuple_pattern(buf, &patterns[k]);
+	    printf("The number of %s tuples of primes in\n"
+		   "2 to %lld (inclusive) is:  %lld%s\n",
+		   buf, n, globalct[k],
+		   check_admissible(&patterns[k]) ? "" : "  (pattern is not admissible)");
+	}
 	printf("--------------------------------------------------------\n"
-	       "The number of times that consecutive odd numbers between\n"
-	       "2 and %d (inclusive) are both prime is:  %d\n"
-	       "--------------------------------------------------------\n"
-	       "\n",
-	       n, globalct);
+	       "\n");
+	if (check) {
+	    agree = TRUE;
+	    for (k = 0; k < npatterns; k++) {
+		agree = agree && (globalct[k] == brutect[k]);
+	    }
+	    printf("The sieve and brute force counts %s\n"
+		   "\n",
+		   agree ? "agree" : "DO NOT AGREE");
+	}
     }
+}
 
-    return 0;
+
+
+
+/* Return the number of odd w in {startnum, ..., stopnum} such that every w +
+ * offsets[i] of the pattern is prime and at most n, checking each member
+ * with check_prime_mr.  Used to check the counts of the sieve.
+ */
+
+long long count_tuples_brute(long long startnum, long long stopnum, long long n,
+			     const tuple_pattern *pattern) {
+
+    long long count;
+    long long w;
+    int j;
+
+    if (!(startnum % 2)) {
+	startnum++;
+    }
+
+    count = 0;
+    for (w = startnum; (w <= stopnum) && (w + pattern->offsets[pattern->len - 1] <= n); w += 2) {
+	for (j = 0; (j < pattern->len) && check_prime_mr(w + pattern->offsets[j]); j++) {
+	    // noop
+	}
+	count += (j == pattern->len);
+    }
+
+    return count;
+}
+
+
+
+
+/* Parse user parameter specifications and set the appropriate variable values.
+ * Input of arguments is allowed following the usual UNIX conventions.
+ */
+
+void parse_tuple_args(int argc, char* argv[], long long *n, int *method,
+		      tuple_pattern *patterns, int *npatterns, int *sched,
+		      long long *chunk) {
+
+    int opt;        // argument type info
+    char* endptr;   // point to next char after int read (should point to '\0')
+
+    // To distinguish success / failure after a call to strtol or strtod
+    errno = 0;
+
+    while ((opt = getopt(argc, argv, "c:m:n:s:t:")) != -1) {
+	switch (opt) {
+	case 'c':
+	    *chunk = strtoll(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for c\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for c\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*chunk < 1) {
+		fprintf(stderr, "c must be >= 1\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'm':
+	    if (!strcmp(optarg, "sieve")) {
+		*method = METHOD_SIEVE;
+	    }
+	    else if (!strcmp(optarg, "trial")) {
+		*method = METHOD_TRIAL;
+	    }
+	    else if (!strcmp(optarg, "mr")) {
+		*method = METHOD_MR;
+	    }
+	    else if (!strcmp(optarg, "check")) {
+		*method = METHOD_CHECK;
+	    }
+	    else {
+		fprintf(stderr, "m must be one of sieve, trial, mr, or check\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'n':
+	    *n = strtoll(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*n > 4000000000000000000LL) {
+		fprintf(stderr, "n must be <= 4e18\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 's':
+	    if ((*sched = find_schedule(optarg)) < 0) {
+		fprintf(stderr, "s must be one of block, cost, or dynamic\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 't':
+	    if (*npatterns == MAX_NPATTERNS) {
+		fprintf(stderr, "at most %d patterns can be counted\n", MAX_NPATTERNS);
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    parse_tuple_pattern(optarg, &patterns[(*npatterns)++]);
+	    break;
+	case '?':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	case ':':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+    }
 }
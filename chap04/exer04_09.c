@@ -8,35 +8,83 @@
  */
 
 /* Accepts an argument "n" for the largest value up to which we should search
- * for all consecutive odd numbers that are prime.
+ * for all consecutive odd numbers that are prime, and an argument "m" for the
+ * method used to find the primes.
+ *
+ *     -m sieve  (default) sieve {1, ..., n} with the segmented bit sieve from
+ *               chap05
+ *     -m trial  check every odd number with check_prime
+ *     -m mr     check every odd number with the Miller-Rabin test
+ *               check_prime_mr
+ *
+ * With the sieve method two further outputs can be requested: "-g" prints the
+ * number of times that each gap length occurs, and "-r" prints every record
+ * gap, i.e. every gap that is larger than all of the gaps before it.
+ *
+ * With the trial and mr methods an argument "s" selects how the odd numbers
+ * are split among the processes, and "c" the number of odd numbers per chunk
+ * of the dynamic schedule (default 16384).
+ *
+ *     -s block    (default) contiguous blocks of equal length
+ *     -s cost     contiguous blocks of equal estimated cost, which shrink as
+ *                 the numbers grow for the trial method
+ *     -s dynamic  chunks taken from a shared counter until none are left
+ */
+
+/* In the sieve method the rank-th process sieves exactly the rank-th block of
+ * {1, ..., n}, so the work is the same for every process.  Each block is
+ * summarized by its first prime, its last prime, and its largest internal gap.
+ * The summaries are combined with a (non-commutative) MPI reduction that also
+ * considers the gap between the last prime of one block and the first prime of
+ * the next, so no process has to look past the end of its block.
  */
 
 #include <mpi.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <getopt.h>
+#include <errno.h>
 #include "prime_num_fcns.h"
-#include "parse_n.h"
+#include "segsieve_helper.h"
+#include "gap_fcns.h"
+#include "sched_fcns.h"
 
 #define FALSE    0
 #define TRUE     1
 
+#define METHOD_SIEVE  0
+#define METHOD_TRIAL  1
+#define METHOD_MR     2
 
-int main(int argc, char *argv[]) {
+void parse_gap_args(int argc, char* argv[], long long *n, int *method,
+		    int *want_hist, int *want_records, int *sched,
+		    long long *chunk);
 
-    int size;
-    int rank;
+void gaps_trial(int rank, int size, long long n, int method, int sched,
+		long long chunk);
 
-    int n;           // largest value to search for consec. odd primes
-    int startnum;    // the smallest number a process considers
-    int stopnum;     // the largest number a process considers
+long long max_gap_range(long long startnum, long long stopnum, long long n,
+			int method);
 
-    int last_prime;  // the most recent prime found in working set
-    int prime_diff;  // the length between the most recent and prev. prime
-    int k;
+void gaps_sieve(int rank, int size, long long n, int want_hist, int want_records);
 
-    int local_run;   // track the local maxnumber of pairs of primes
-    int global_run;  // track the overall number of pairs of primes
+void print_gap_extras(int size, long long *hist, gap_summary *summaries,
+		      int *nrecords, long long *records);
 
-    local_run = global_run = 0;
+
+int main(int argc, char *argv[]) {
+
+    int size;
+    int rank;
+
+    long long n;       // largest value to search for consec. odd primes
+    int method;        // METHOD_SIEVE, METHOD_TRIAL, or METHOD_MR
+    int want_hist;     // whether to print the histogram of gap lengths
+    int want_records;  // whether to print the record gaps
+    int sched;         // SCHED_* schedule of the trial and mr methods, or -1
+    long long chunk;   // odd numbers per chunk of the dynamic schedule, or 0
 
     // Initialize the MPI environment
     MPI_Init(&argc, &argv);
@@ -47,83 +95,474 @@ int main(int argc, char *argv[]) {
 
     /* Default value of the largest value to consider in search for consecutive
      * odd primes as given by the prompt.  If an argument for n is given as an
-     * option then this value is written to n in parse_args.
+     * option then this value is written to n in parse_gap_args.
      */
     n = 1e6;
-    parse_args(argc, argv, &n);
+    method = METHOD_SIEVE;
+    want_hist = FALSE;
+    want_records = FALSE;
+    sched = -1;
+    chunk = 0;
+    parse_gap_args(argc, argv, &n, &method, &want_hist, &want_records, &sched,
+		   &chunk);
     if (n < 2) {
 	fprintf(stderr, "n must be >= 2\n");
 	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
     }
 
-    /* Globally: split the numbers from 1 to n into size nearly evenly sized
-     * sets.  Locally: set startnum and stopnum to be the smallest and largest
-     * values of the rank-th set
+    if (method != METHOD_SIEVE) {
+	if (want_hist || want_records) {
+	    fprintf(stderr, "-g and -r require the sieve method\n");
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	else if ((method == METHOD_TRIAL) && (n > INT_MAX - 2)) {
+	    fprintf(stderr, "the trial method requires n <= %d\n", INT_MAX - 2);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	gaps_trial(rank, size, n, method, (sched < 0) ? SCHED_BLOCK : sched,
+		   chunk ? chunk : DEFAULT_CHUNK);
+    }
+    else if ((sched >= 0) || chunk) {
+	fprintf(stderr, "-s and -c require the trial or mr method\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    else {
+	gaps_sieve(rank, size, n, want_hist, want_records);
+    }
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+
+    return 0;
+}
+
+
+
+
+/* Find the largest gap between primes in {2, ..., n} by checking odd numbers
+ * with check_prime, or with check_prime_mr if method is METHOD_MR, and print
+ * the result.  The odd numbers are handed out to the processes with the
+ * schedule sched (see sched_fcns.h), and the busy time of each process is
+ * printed so that the balance of the schedule can be checked.
+ */
+
+void gaps_trial(int rank, int size, long long n, int method, int sched,
+		long long chunk) {
+
+    long long startnum;    // the smallest number of the current range
+    long long stopnum;     // the largest number of the current range
+    long long run;
+
+    long long local_run;   // track the local maxnumber of pairs of primes
+    long long global_run;  // track the overall number of pairs of primes
+
+    work_schedule ws;
+
+    local_run = global_run = 0;
+
+    /* Checking w by trial division takes about sqrt(w) steps when w is prime,
+     * while the Miller-Rabin test takes about the same time for every w
      */
-    find_process_set(rank, size, n, &startnum, &stopnum);
-
-    /* Each iteration checks an odd number to see if it is prime; if so, then
-     * the length of the run between prime numbers is compared to the previous
-     * largest, and if so then the largest run value is updated.
-     *
-     * Note that the loop typically ends once a prime has been found greater
-     * than the last number in the set.  This is so that a possible run that
-     * starts in one set and ends in the next does not get truncated
-     * prematurely.  However if we are in the last set, then we do want to
-     * truncate the run which is why we test for k <= n.
+    init_schedule(&ws, sched, n, (method == METHOD_MR) ? 0.0 : 0.5, chunk);
+
+    while (next_range(&ws, &startnum, &stopnum)) {
+	run = max_gap_range(startnum, stopnum, n, method);
+	if (run > local_run) {
+	    local_run = run;
+	}
+	end_range(&ws);
+    }
+
+    if (sched == SCHED_DYNAMIC) {
+	printf("rank %d processor:\n"
+	       "The number of chunks of %lld odd numbers checked is:  %lld\n"
+	       "\n",
+	       rank, chunk, ws.nranges);
+    }
+    else {
+	printf("rank %d processor:\n"
+	       "The largest run between prime numbers with the first prime number\n"
+	       "of the pair in the set from %lld to %lld (inclusive) is:  %lld\n"
+	       "\n",
+	       rank, startnum, stopnum, local_run);
+    }
+
+    // Collect local consecutive primes count
+    MPI_Reduce(&local_run, &global_run, 1, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+    print_busy_times(&ws);
+    free_schedule(&ws);
+
+    /* The algorithm doesn't work properly for n < 5 b/c we skip past even
+     * numbers and consequently we miss the run for 2 and 3.  If n == 2 then we
+     * just let global_run stay at 0.
      */
+    if ((n == 3) || (n == 4)) {
+	global_run = 1;
+    }
+
+    // Print result
+    if (rank == 0) {
+	printf("------------------------------------------------\n"
+	       "The largest run between prime numbers in the set\n"
+	       "2 and %lld (inclusive) is:  %lld\n"
+	       "------------------------------------------------\n"
+	       "\n",
+	       n, global_run);
+    }
+}
+
+
+
+
+/* Return the largest gap between consecutive primes p < q <= n with startnum
+ * <= p <= stopnum, where startnum is odd.
+ *
+ * Each iteration checks an odd number to see if it is prime; if so, then the
+ * length of the run between prime numbers is compared to the previous largest,
+ * and if so then the largest run value is updated.
+ *
+ * Note that the loop typically ends once a prime has been found greater than
+ * the last number in the range.  This is so that a possible run that starts in
+ * one range and ends in the next does not get truncated prematurely.  However
+ * if we are in the last range, then we do want to truncate the run which is
+ * why we test for k <= n.
+ */
+
+long long max_gap_range(long long startnum, long long stopnum, long long n,
+			int method) {
+
+    long long last_prime;  // the most recent prime found in the range
+    long long prime_diff;  // the length between the most recent and prev. prime
+    long long max_run;
+    long long k;
+
+    max_run = 0;
     last_prime = 0;
     for (k = startnum; last_prime <= stopnum && (k <= n); k += 2) {
 
-	if (check_prime(k)) {
+	if ((method == METHOD_MR) ? check_prime_mr(k) : check_prime((int) k)) {
 
-	    // case: first prime found in set (signaled by last_prime == 0)
+	    // case: first prime found in range (signaled by last_prime == 0)
 	    if (! last_prime) {
 		// noop
 	    }
-	    // case: not the first prime we've found in set; check run length
+	    // case: not the first prime we've found in range; check run length
 	    else {
 		prime_diff = k - last_prime;
-		if (prime_diff > local_run) {
-		    local_run = prime_diff;
+		if (prime_diff > max_run) {
+		    max_run = prime_diff;
 		}
 	    }
 
-	    // update value of the most recent prime found in set
+	    // update value of the most recent prime found in range
 	    last_prime = k;
 	}
     }
-		
+
+    return max_run;
+}
+
+
+
+
+/* Find the largest gap between primes in {2, ..., n} using the segmented sieve
+ * and print the result, along with the histogram of gap lengths and the record
+ * gaps if requested.
+ */
+
+void gaps_sieve(int rank, int size, long long n, int want_hist, int want_records) {
+
+    long long local_low;      // lowest odd value in local set
+    long long local_high;     // highest value in local set (can be even)
+    long long local_setsize;  // number of odd values in local set
+    long long prev_low;       // the same quantities for the previous set
+    long long prev_high;
+    long long prev_setsize;
+
+    int *primes;              // odd primes up to sqrt(n)
+    int nprimes;
+
+    gap_data gdata;           // summary of the primes in the local set
+    gap_summary global;       // summary of the primes in {2, ..., n}
+    MPI_Datatype summary_type;
+    MPI_Op summary_op;
+
+    long long *hist;          // global histogram of gap lengths
+    gap_summary *summaries;   // summary of each set, gathered on rank 0
+    int *nrecords;            // number of local record gaps of each set
+    int *displs;
+    long long *records;       // local record gaps of each set
+    int k;
+
+    local_set_params_ll(1, n, rank, size, &local_low, &local_high, &local_setsize);
+
+    /* The sieve only represents odd values, so the even prime 2 is added by
+     * hand by the process whose set contains it
+     */
+    init_gap_data(&gdata, want_hist, want_records);
+    if (rank) {
+	local_set_params_ll(1, n, rank - 1, size, &prev_low, &prev_high, &prev_setsize);
+    }
+    if ((local_high >= 2) && (!rank || (prev_high < 2))) {
+	add_prime(&gdata, 2);
+    }
+
+    // Sieve the local set and add each prime found to gdata
+    nprimes = gather_sieving_primes((int) isqrt_ll(n), rank, size, &primes);
+    sieve_range(local_low, local_high, local_high, SEG_NBITS, 0,
+		primes, nprimes, gaps_segment, &gdata);
+    free(primes);
+
     printf("rank %d processor:\n"
-	   "The largest run between prime numbers with the first prime number\n"
-	   "of the pair in the set from %d to %d (inclusive) is:  %d\n"
+	   "The largest run between consecutive prime numbers in the set\n"
+	   "from %lld to %lld (inclusive) is:  %lld\n"
 	   "\n",
-	   rank, startnum, stopnum, local_run);
-
-    // Collect local consecutive primes count
-    MPI_Reduce(&local_run, &global_run, 1, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+	   rank, local_low, local_high, gdata.summary.maxgap);
 
-    // Finalize the MPI environment.
-    MPI_Finalize();
+    // Stitch together the summaries of the sets in rank order
+    create_gap_summary_op(&summary_type, &summary_op);
+    MPI_Reduce(&gdata.summary, &global, 1, summary_type, summary_op, 0, MPI_COMM_WORLD);
 
-    /* The algorithm doesn't work properly for n < 5 b/c we skip past even
-     * numbers and consequently we miss the run for 2 and 3.  If n == 2 then we
-     * just let global_run stay at 0.
+    /* The gaps between sets are only known once the summaries of all of the
+     * sets are available, so rank 0 adds these to the histogram and to the list
+     * of record gaps
      */
-    if ((n == 3) || (n == 4)) {
-	global_run = 1;
+    hist = NULL;
+    summaries = NULL;
+    nrecords = NULL;
+    displs = NULL;
+    records = NULL;
+    if (want_hist || want_records) {
+	if (!rank) {
+	    summaries = malloc(size * sizeof(gap_summary));
+	    nrecords = calloc(size, sizeof(int));
+	    displs = calloc(size, sizeof(int));
+	    hist = calloc(MAX_GAP + 1, sizeof(long long));
+	    records = malloc(2 * size * MAX_RECORDS * sizeof(long long));
+	    if ((summaries == NULL) || (nrecords == NULL) || (displs == NULL)
+		|| (hist == NULL) || (records == NULL)) {
+		fprintf(stderr, "error allocating memory for gap results\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	    }
+	}
+	MPI_Gather(&gdata.summary, 1, summary_type, summaries, 1, summary_type,
+		   0, MPI_COMM_WORLD);
+    }
+    if (want_hist) {
+	MPI_Reduce(gdata.hist, hist, MAX_GAP + 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    }
+    if (want_records) {
+	gdata.nrecords *= 2;
+	MPI_Gather(&gdata.nrecords, 1, MPI_INT, nrecords, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	if (!rank) {
+	    for (k = 1; k < size; k++) {
+		displs[k] = displs[k - 1] + nrecords[k - 1];
+	    }
+	}
+	MPI_Gatherv(gdata.records, gdata.nrecords, MPI_LONG_LONG, records, nrecords,
+		    displs, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
     }
 
+    MPI_Op_free(&summary_op);
+    MPI_Type_free(&summary_type);
+    free_gap_data(&gdata);
+
     // Print result
     if (rank == 0) {
 	printf("------------------------------------------------\n"
 	       "The largest run between prime numbers in the set\n"
-	       "2 and %d (inclusive) is:  %d\n"
-	       "------------------------------------------------\n"
-	       "\n",
-	       n, global_run);
+	       "2 and %lld (inclusive) is:  %lld\n",
+	       n, global.maxgap);
+	if (global.maxgap) {
+	    printf("(first occurring between %lld and %lld)\n",
+		   global.maxgap_at, global.maxgap_at + global.maxgap);
+	}
+	printf("------------------------------------------------\n"
+	       "\n");
+
+	if (want_hist || want_records) {
+	    print_gap_extras(size, want_hist ? hist : NULL, summaries,
+			     nrecords, want_records ? records : NULL);
+	}
+	free(summaries);
+	free(nrecords);
+	free(displs);
+	free(hist);
+	free(records);
     }
+}
 
-    return 0;
+
+
+
+/* Add the gaps between consecutive sets to the histogram and merge the local
+ * record gaps of each set into the global record gaps, then print whichever of
+ * the two was requested (i.e. is not NULL).  nrecords[r] is the number of long
+ * longs, i.e. twice the number of record gaps, stored for the r-th set.
+ *
+ * A local record gap is larger than every earlier gap in its set, so it is a
+ * global record exactly when it is also larger than every gap in the earlier
+ * sets and between them.
+ */
+
+void print_gap_extras(int size, long long *hist, gap_summary *summaries,
+		      int *nrecords, long long *records) {
+
+    long long prev_last;    // last prime of the previous nonempty set
+    long long running_max;  // largest gap among the smaller primes
+    long long gap;
+    long long *rec;
+    int r;
+    int k;
+
+    if (records) {
+	printf("Record gaps:\n"
+	       "\n"
+	       "       gap  following the prime\n");
+    }
+
+    prev_last = 0;
+    running_max = 0;
+    rec = records;
+    for (r = 0; r < size; r++) {
+
+	// case: set has no primes
+	if (!summaries[r].first) {
+	    continue;
+	}
+
+	// The gap between the previous set and this one
+	if (prev_last) {
+	    gap = summaries[r].first - prev_last;
+	    if (hist) {
+		hist[(gap < MAX_GAP) ? gap : MAX_GAP]++;
+	    }
+	    if (records && (gap > running_max)) {
+		printf("    %6lld  %lld\n", gap, prev_last);
+	    }
+	    if (gap > running_max) {
+		running_max = gap;
+	    }
+	}
+
+	// The local record gaps
+	for (k = 0; records && (k < nrecords[r]); k += 2) {
+	    if (rec[k + 1] > running_max) {
+		running_max = rec[k + 1];
+		printf("    %6lld  %lld\n", rec[k + 1], rec[k]);
+	    }
+	}
+	if (records) {
+	    rec += nrecords[r];
+	}
+	if (summaries[r].maxgap > running_max) {
+	    running_max = summaries[r].maxgap;
+	}
+
+	prev_last = summaries[r].last;
+    }
+    if (records) {
+	printf("\n");
+    }
+
+    if (hist) {
+	printf("Number of occurrences of each gap length:\n"
+	       "\n"
+	       "       gap  count\n");
+	for (k = 0; k < MAX_GAP; k++) {
+	    if (hist[k]) {
+		printf("    %6d  %lld\n", k, hist[k]);
+	    }
+	}
+	if (hist[MAX_GAP]) {
+	    printf("   >=%5d  %lld\n", MAX_GAP, hist[MAX_GAP]);
+	}
+	printf("\n");
+    }
 }
 
+
+
+
+/* Parse user parameter specifications and set the appropriate variable values.
+ * Input of arguments is allowed following the usual UNIX conventions.
+ */
+
+void parse_gap_args(int argc, char* argv[], long long *n, int *method,
+		    int *want_hist, int *want_records, int *sched,
+		    long long *chunk) {
+
+    int opt;        // argument type info
+    char* endptr;   // point to next char after int read (should point to '\0')
+
+    // To distinguish success / failure after a call to strtol or strtod
+    errno = 0;
+
+    while ((opt = getopt(argc, argv, "c:gm:n:rs:")) != -1) {
+	switch (opt) {
+	case 'c':
+	    *chunk = strtoll(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for c\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for c\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*chunk < 1) {
+		fprintf(stderr, "c must be >= 1\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'g':
+	    *want_hist = TRUE;
+	    break;
+	case 'm':
+	    if (!strcmp(optarg, "sieve")) {
+		*method = METHOD_SIEVE;
+	    }
+	    else if (!strcmp(optarg, "trial")) {
+		*method = METHOD_TRIAL;
+	    }
+	    else if (!strcmp(optarg, "mr")) {
+		*method = METHOD_MR;
+	    }
+	    else {
+		fprintf(stderr, "m must be one of sieve, trial, or mr\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'n':
+	    *n = strtoll(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*n > 4000000000000000000LL) {
+		fprintf(stderr, "n must be <= 4e18\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'r':
+	    *want_records = TRUE;
+	    break;
+	case 's':
+	    if ((*sched = find_schedule(optarg)) < 0) {
+		fprintf(stderr, "s must be one of block, cost, or dynamic\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case '?':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	case ':':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+    }
+}
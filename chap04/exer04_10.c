@@ -14,26 +14,57 @@
  *    - The sum of the digits may not be 7, 11, or 13
  */
 
+/* Accepts the following arguments describing the ids to count; the defaults
+ * are those of the exercise.
+ *
+ *     -k len       number of characters in an id (default 6)
+ *     -a alphabet  the characters that may be used, where the value of a
+ *                  character is its position in alphabet (default "0123456789")
+ *     -l chars     characters that may not come first (default "0")
+ *     -p pairs     comma-separated pairs of characters that may not be adjacent,
+ *                  where "=" stands for every repeated character (default "=")
+ *     -s sums      comma-separated sums that the values may not add up to
+ *                  (default "7,11,13")
+ *     -m method    dp (default) counts by dynamic programming over the digits,
+ *                  brute checks every combination, and check does both and
+ *                  compares the results
+ *
+ * For example "-k 16 -a 0123456789ABCDEF -p =,AB,BA -s 0,1,2" counts 16
+ * character hexadecimal ids.
+ */
+
 #include <mpi.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include "id_fcns.h"
 
-#define NDIGITS       6  // number of digits in id
-#define MINNUM   101010  // smallest 6-digit number satisfying req's 
-#define MAXNUM   989898  // largest 6-digit number satisfying req's
-
-#define FALSE 0
-#define TRUE  1
+#define METHOD_DP     0
+#define METHOD_BRUTE  1
+#define METHOD_CHECK  2
 
-int check_satisfy(int val);
+void parse_id_args(int argc, char* argv[], int *len, char **alphabet,
+		   char **leading, char **pairs, char **sums, int *method);
 
 
 int main(int argc, char *argv[]) {
     
     int size;
     int rank;
-    int localct;
-    int globalct;
-    int k;
+
+    int len;         // number of characters in an id
+    char *alphabet;  // the characters that may be used
+    char *leading;   // the characters that may not come first
+    char *pairs;     // the pairs of characters that may not be adjacent
+    char *sums;      // the sums that the character values may not add up to
+    int method;      // METHOD_DP, METHOD_BRUTE, or METHOD_CHECK
+    id_rules rules;
+
+    uint128_t dpct;      // number of ids found by count_ids_dp
+    long long brutect;   // number of ids found by count_ids_brute
+    char buf[U128_STRLEN];
 
     // Initialize the MPI environment
     MPI_Init(&argc, &argv);
@@ -42,71 +73,114 @@ int main(int argc, char *argv[]) {
     // Get the rank of the process
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    /* Each iteration checks if the value satisfies the criteria and if so adds
-     * 1 to localct, or adds 0 otherwise.
+    /* The constraints given by the prompt.  If any arguments are given as
+     * options then these values are overwritten in parse_id_args.
      */
-    localct = 0;
-    for (k = rank + MINNUM; k <= MAXNUM; k += size) {
-	localct += check_satisfy(k);
+    len = 6;
+    alphabet = "0123456789";
+    leading = "0";
+    pairs = "=";
+    sums = "7,11,13";
+    method = METHOD_DP;
+    parse_id_args(argc, argv, &len, &alphabet, &leading, &pairs, &sums, &method);
+
+    init_id_rules(&rules, len, alphabet);
+    forbid_leading(&rules, leading);
+    forbid_pairs(&rules, pairs);
+    forbid_sums(&rules, sums);
+    check_id_rules(&rules, method != METHOD_DP);
+
+    dpct = 0;
+    brutect = 0;
+    if (method != METHOD_BRUTE) {
+	dpct = count_ids_dp(&rules, rank, size);
+    }
+    if (method != METHOD_DP) {
+	brutect = count_ids_brute(&rules, rank, size);
     }
-
-    // Collect local counts
-    MPI_Reduce(&localct, &globalct, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
 
     // Finalize the MPI environment.
     MPI_Finalize();
 
     // Print result
     if (rank == 0) {
+	sprint_u128(buf, (method == METHOD_BRUTE) ? (uint128_t) brutect : dpct);
     	printf("\n"
-    	       "The number of id combinations satisfying the criteria was:  %d\n"
+    	       "The number of id combinations satisfying the criteria was:  %s\n"
 	       "\n",
-    	       globalct);
+    	       buf);
+	if (method == METHOD_CHECK) {
+	    printf("The dynamic programming and brute force counts %s\n"
+		   "\n",
+		   (dpct == (uint128_t) brutect) ? "agree" : "DO NOT AGREE");
+	}
     }
 
     return 0;
 }
 
 
-/* Check that the last six digits of val neither (i) have consecutive digits of
- * the same value, nor (ii) the sum of the digits isn't 7, 11, or 13.
- *
- * Note that we are not checking that the first digit isn't a 1.
- */ 
 
-int check_satisfy(int val) {
 
-    int digits[6];  // store each digit in val
-    int digsum;     // sum of the digits
-    int i;
+/* Parse user parameter specifications and set the appropriate variable values.
+ * Input of arguments is allowed following the usual UNIX conventions.
+ */
 
-    /* Each iteration finds the value of the last digit of val and then strips
-     * val of that digit.  Note that this places the values stored in digits in
-     * the opposite order of the original value, however this does not matter
-     * for our problem.
-     */
-    digits[0] = val % 10;
-    val /= 10;
-    for (i = 1; i < NDIGITS; i++) {
-	digits[i] = val % 10;
-	val /= 10;
-
-	if (digits[i - 1] == digits[i]) {
-	    return FALSE;
+void parse_id_args(int argc, char* argv[], int *len, char **alphabet,
+		   char **leading, char **pairs, char **sums, int *method) {
+
+    int opt;        // argument type info
+    char* endptr;   // point to next char after int read (should point to '\0')
+
+    // To distinguish success / failure after a call to strtol or strtod
+    errno = 0;
+
+    while ((opt = getopt(argc, argv, "a:k:l:m:p:s:")) != -1) {
+	switch (opt) {
+	case 'a':
+	    *alphabet = optarg;
+	    break;
+	case 'k':
+	    *len = strtol(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for k\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for k\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'l':
+	    *leading = optarg;
+	    break;
+	case 'm':
+	    if (!strcmp(optarg, "dp")) {
+		*method = METHOD_DP;
+	    }
+	    else if (!strcmp(optarg, "brute")) {
+		*method = METHOD_BRUTE;
+	    }
+	    else if (!strcmp(optarg, "check")) {
+		*method = METHOD_CHECK;
+	    }
+	    else {
+		fprintf(stderr, "m must be one of dp, brute, or check\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'p':
+	    *pairs = optarg;
+	    break;
+	case 's':
+	    *sums = optarg;
+	    break;
+	case '?':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	case ':':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
 	}
     }
-
-    /* If we've made it this far then no two consecutive digits are equal.
-     * Check the sum of the digits.
-     */
-    digsum = 0;
-    for (i = 0; i < NDIGITS; i++) {
-	digsum += digits[i];
-    }
-    if ((digsum == 7) || (digsum == 11) || (digsum == 13)) {
-	return FALSE;
-    }
- 
-    // If we've made it this far then we've passed every criterion
-    return TRUE;
 }
@@ -16,14 +16,27 @@
  */
 
 /* Accepts an argument "n" for the number of intervals that we should
- * approximate the function with.
+ * approximate the function with, "f" for the name of the integrand (default
+ * "pi", the integrand of the exercise), and "m" for the method, which is one of
+ * "rect" (the default), "adapt-simpson", "adapt-gk", "romberg", "gauss", or
+ * "tanh-sinh".  The adaptive methods subdivide the interval only where an error
+ * estimate calls for it, aiming for a total error estimate below the tolerance
+ * given by the argument "e".  The engines romberg, gauss, and tanh-sinh instead
+ * refine the whole interval in levels until two successive levels agree to
+ * within "e".  If a method runs out of function evaluations or levels, or the
+ * intervals near a singularity become too narrow to split, before reaching the
+ * tolerance, then a warning says so.
  */
 
 #include <mpi.h>
 #include <stdio.h>
+#include <string.h>
 #include "parse_n.h"
+#include "mpi_helper.h"
+#include "quad_adapt.h"
+#include "quad_engines.h"
 
-double eval_fcn(double x);
+#define DEFAULT_TOL  1e-10  // default error tolerance of the adaptive methods and engines
 
 
 int main(int argc, char *argv[]) {
@@ -33,13 +46,22 @@ int main(int argc, char *argv[]) {
     
     double interval_len;  // size of each rectangle width
     double midpoint_len;  // 1/2 rect. width (i.e. where fcn is evaluated)
-    int n;                // number of rectangles to divide integral into
+    long long n;          // number of rectangles to divide integral into
+
+    const integrand_info *info;  // the integrand and its interval
+    const char *fcn_name;        // name of the integrand
+    const char *method;          // name of the integration method
+    int rule;                    // rule of the adaptive method, or -1
+    int engine;                  // higher-order engine, or -1
+    char label[64];              // label of the printed result
+    double tol;                  // error tolerance of the adaptive methods and engines
+    double errest;               // error estimate of the adaptive methods and engines
+    long long nevals;            // number of function evaluations
+    int converged;               // whether the tolerance was reached
 
     double local_area_unnorm;  // unnormalized sum of process rect. areas
     double global_area;        // global sum of rectangle areas
 
-    int k;
-
     // Initialize the MPI environment
     MPI_Init(&argc, &argv);
     // Get the number of the processes
@@ -47,53 +69,94 @@ int main(int argc, char *argv[]) {
     // Get the rank of the process
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    /* Default value of the number of intervals to break the integral into.  If
-     * an argument for n is given as an option then this value is written to *n
-     * in parse_args.
+    /* Default values of the parameters.  If an argument is given as an option
+     * then its value is written to the corresponding variable in
+     * parse_quad_args.
      */
     n = 1e6;
-    parse_args(argc, argv, &n);
+    fcn_name = "pi";
+    method = "rect";
+    tol = DEFAULT_TOL;
+    parse_quad_args(argc, argv, &n, &fcn_name, &method, &tol);
+
+    if ((info = find_integrand(fcn_name)) == NULL) {
+	if (rank == 0) {
+	    fprintf(stderr, "Invalid integrand \"%s\"\n", fcn_name);
+	    print_integrands();
+	}
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    rule = find_adapt_rule(method);
+    engine = find_engine(method);
+    if ((rule < 0) && (engine < 0) && strcmp(method, "rect")) {
+	fprintf(stderr, "Invalid method \"%s\"\n", method);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
 
-    /* Calculate the interval length and the length of the midpoint within the
-     * interval.  Note that we do not have to consider underflow b/c n has to be
-     * representable as an int.
-     */
-    interval_len = 1.0 / ((double) n);
-    midpoint_len = interval_len / 2.0;
-
-    /* Evaluates every size-th interval and adds the unnormalized area to
-     * local_area_unnorm.  It is unnormalized in the sense that each rectangle
-     * has area (end - start) * height, whereas what we need is ((end - start) /
-     * n) * height.  However we sum the unnormalized terms and normalize at the
-     * end.  Note: for this problem overflow is not an issue.
-     */
-    local_area_unnorm = 0;
-    for (k = rank; k < n; k += size) {
-	local_area_unnorm += eval_fcn((k * interval_len) + midpoint_len);
+    // The fixed rules have no tolerance to fall short of
+    converged = 1;
+
+    // case: an adaptive method
+    if (rule >= 0) {
+	converged = adapt_quad(info, rule, tol, ADAPT_MAX_EVALS, rank, size,
+			       &global_area, &errest, &nevals);
+    }
+    // case: a higher-order engine
+    else if (engine >= 0) {
+	converged = engine_quad(info, engine, tol, rank, size, &global_area, &errest,
+				&nevals);
+    }
+    // case: the rectangle rule
+    else {
+
+	/* Calculate the interval length and the length of the midpoint within
+	 * the interval
+	 */
+	interval_len = (info->ubnd - info->lbnd) / ((double) n);
+	midpoint_len = interval_len / 2.0;
+
+	/* Evaluates the rank-th contiguous block of intervals and adds the
+	 * unnormalized area to local_area_unnorm.  It is unnormalized in the sense
+	 * that each rectangle has area width * height, whereas what we are summing
+	 * is just the heights.  However we sum the unnormalized terms and
+	 * normalize at the end.  A contiguous block, as opposed to every size-th
+	 * interval, lets sum_fcn evaluate the integrand in vectorized batches.
+	 */
+	local_area_unnorm = sum_fcn(info, info->lbnd + midpoint_len, interval_len,
+				    BLOCK_LOW(rank, size, n), BLOCK_SIZE(rank, size, n));
+
+	// Sum the unnormalized processes areas
+	MPI_Reduce(&local_area_unnorm, &global_area, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+	// Normalize global area
+	global_area *= interval_len;
+	nevals = n;
     }
 
-    // Sum the unnormalized processes areas
-    MPI_Reduce(&local_area_unnorm, &global_area, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
     // Finalize the MPI environment
     MPI_Finalize();
 
-    // Normalize global area
-    global_area /= n;
-    
     // Print result
     if (rank == 0) {
-	printf("\n"
-	       "The value from summing the rectangles is:  %.14f\n"
-	       "The leading digits of pi is:               3.14159265358979\n"
+	if ((rule < 0) && (engine < 0)) {
+	    printf("\n"
+		   "The value from summing the rectangles is:  %.14f\n",
+		   global_area);
+	}
+	else {
+	    snprintf(label, sizeof(label), "The value from -m %s is:", method);
+	    printf("\n"
+		   "%-43s%.14f\n"
+		   "%-43s%.3e%s\n",
+		   label, global_area, "The estimated error is:", errest,
+		   converged ? "" : " (tolerance not reached)");
+	}
+	printf("The exact value of the integral is:        %.14f\n"
+	       "The actual error is:                       %.3e\n"
+	       "The number of function evaluations is:     %lld\n"
 	       "\n",
-	       global_area);
+	       info->exact, global_area - info->exact, nevals);
     }
     
     return 0;
 }
-
-
-double eval_fcn(double x) {
-    return 4 / (1 + (x * x));
-}
-
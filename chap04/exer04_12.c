@@ -12,17 +12,27 @@
  */
 
 /* Accepts an argument "n" for the number of intervals that we should
- * approximate the function with.
+ * approximate the function with, "f" for the name of the integrand (default
+ * "pi", the integrand of the exercise), and "m" for the method, which is one of
+ * "simpson" (the default), "adapt-simpson", "adapt-gk", "romberg", "gauss", or
+ * "tanh-sinh".  The adaptive methods subdivide the interval only where an
+ * error estimate calls for it, aiming for a total error estimate below the
+ * tolerance given by the argument "e".  The engines romberg, gauss, and
+ * tanh-sinh instead refine the whole interval in levels until two successive
+ * levels agree to within "e".  If a method runs out of function evaluations or
+ * levels, or the intervals near a singularity become too narrow to split,
+ * before reaching the tolerance, then a warning says so.
  */
 
 #include <mpi.h>
 #include <stdio.h>
+#include <string.h>
 #include "parse_n.h"
+#include "mpi_helper.h"
+#include "quad_adapt.h"
+#include "quad_engines.h"
 
-#define LBND 0  // lower bound of definite integral
-#define UBND 1  // upper bound of definite integral
-
-double eval_fcn(double x);
+#define DEFAULT_TOL  1e-10  // default error tolerance of the adaptive methods and engines
 
 
 int main(int argc, char *argv[]) {
@@ -31,13 +41,25 @@ int main(int argc, char *argv[]) {
     int size;
     
     double interval_len;  // size of interval
-    int n;                // number of intervals to divide domain into
+    long long n;          // number of intervals to divide domain into
+
+    const integrand_info *info;  // the integrand and its interval
+    const char *fcn_name;        // name of the integrand
+    const char *method;          // name of the integration method
+    int rule;                    // rule of the adaptive method, or -1
+    int engine;                  // higher-order engine, or -1
+    char label[64];              // label of the printed result
+    double tol;                  // error tolerance of the adaptive methods and engines
+    double errest;               // error estimate of the adaptive methods and engines
+    long long nevals;            // number of function evaluations
+    int converged;               // whether the tolerance was reached
 
     double local_area;   // local sum of process function evaluations
     double global_area;  // global sum of Simpson's rule terms
 
-    int k;
-    int halfn;
+    long long halfn;  // number of pairs of terms in the sum
+    long long low;    // first pair of terms of this process
+    long long count;  // number of pairs of terms of this process
 
     // Initialize the MPI environment
     MPI_Init(&argc, &argv);
@@ -46,53 +68,99 @@ int main(int argc, char *argv[]) {
     // Get the rank of the process
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    /* Default value of the number of intervals to break the integral into.  If
-     * an argument for n is given as an option then this value is written to *n
-     * in parse_args.
+    /* Default values of the parameters.  If an argument is given as an option
+     * then its value is written to the corresponding variable in
+     * parse_quad_args.
      */
     n = 50;
-    parse_args(argc, argv, &n);
+    fcn_name = "pi";
+    method = "simpson";
+    tol = DEFAULT_TOL;
+    parse_quad_args(argc, argv, &n, &fcn_name, &method, &tol);
+
+    if ((info = find_integrand(fcn_name)) == NULL) {
+	if (rank == 0) {
+	    fprintf(stderr, "Invalid integrand \"%s\"\n", fcn_name);
+	    print_integrands();
+	}
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    rule = find_adapt_rule(method);
+    engine = find_engine(method);
+    if ((rule < 0) && (engine < 0) && strcmp(method, "simpson")) {
+	fprintf(stderr, "Invalid method \"%s\"\n", method);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    else if ((rule < 0) && (engine < 0) && (n % 2)) {
+	fprintf(stderr, "n must be even for Simpson's rule\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
 
-    /* Calculate the interval length and the length of the midpoint within the
-     * interval.  Note that we do not have to consider underflow b/c n has to be
-     * representable as an int.
-     */
-    interval_len = 1.0 / ((double) n);
+    // The fixed rules have no tolerance to fall short of
+    converged = 1;
 
-    /* Evaluate every size-th pair of function evaluations in the sum portion of
-     * Simpson's rule.  The first term is 4*f(x_{2k - 1}) and the second term is
-     * 2*f(x_{2k}).
-     */
-    local_area = 0;
-    halfn = n / 2;
-    for (k = (rank + 1); k <= halfn; k += size) {
-	local_area += 4 * eval_fcn(((2 * k) - 1) * interval_len);
-	local_area += 2 * eval_fcn((2 * k) * interval_len);
+    // case: an adaptive method
+    if (rule >= 0) {
+	converged = adapt_quad(info, rule, tol, ADAPT_MAX_EVALS, rank, size,
+			       &global_area, &errest, &nevals);
+    }
+    // case: a higher-order engine
+    else if (engine >= 0) {
+	converged = engine_quad(info, engine, tol, rank, size, &global_area, &errest,
+				&nevals);
+    }
+    // case: Simpson's rule
+    else {
+
+	// Calculate the interval length
+	interval_len = (info->ubnd - info->lbnd) / ((double) n);
+
+	/* Evaluate the rank-th contiguous block of pairs of function
+	 * evaluations in the sum portion of Simpson's rule.  The first term is
+	 * 4*f(x_{2k - 1}) and the second term is 2*f(x_{2k}), for k from 1 to
+	 * n / 2.  As functions of k both abscissae have the step 2 *
+	 * interval_len, so each of the two sums is done in vectorized batches by
+	 * sum_fcn.
+	 */
+	halfn = n / 2;
+	low = BLOCK_LOW(rank, size, halfn) + 1;
+	count = BLOCK_SIZE(rank, size, halfn);
+	local_area = 4 * sum_fcn(info, info->lbnd - interval_len, 2 * interval_len, low, count);
+	local_area += 2 * sum_fcn(info, info->lbnd, 2 * interval_len, low, count);
+
+	// Sum the unnormalized processes areas
+	MPI_Reduce(&local_area, &global_area, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+	// Add first and last term and normalize
+	global_area += info->fcn(info->lbnd) - info->fcn(info->ubnd);
+	global_area *= interval_len / 3;
+	nevals = n + 1;
     }
 
-    // Sum the unnormalized processes areas
-    MPI_Reduce(&local_area, &global_area, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
     // Finalize the MPI environment.
     MPI_Finalize();
 
-    // Add first and last term and normalize
-    global_area += eval_fcn(LBND) - eval_fcn(UBND);
-    global_area /= 3 * n;
-    
     // Print result
     if (rank == 0) {
-	printf("\n"
-	       "The value obtained by Simpson's rule is:  %.14f\n"
-	       "The leading digits of pi is:              3.14159265358979\n"
+	if ((rule < 0) && (engine < 0)) {
+	    printf("\n"
+		   "The value obtained by Simpson's rule is:  %.14f\n",
+		   global_area);
+	}
+	else {
+	    snprintf(label, sizeof(label), "The value from -m %s is:", method);
+	    printf("\n"
+		   "%-42s%.14f\n"
+		   "%-42s%.3e%s\n",
+		   label, global_area, "The estimated error is:", errest,
+		   converged ? "" : " (tolerance not reached)");
+	}
+	printf("The exact value of the integral is:       %.14f\n"
+	       "The actual error is:                      %.3e\n"
+	       "The number of function evaluations is:    %lld\n"
 	       "\n",
-	       global_area);
+	       info->exact, global_area - info->exact, nevals);
     }
     
     return 0;
 }
-
-
-double eval_fcn(double x) {
-    return 4 / (1 + (x * x));
-}
-
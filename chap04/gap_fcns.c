@@ -0,0 +1,181 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "segsieve_helper.h"
+#include "gap_fcns.h"
+
+static void gap_prime(long long p, void *data);
+static void gap_summary_reduce(void *invec, void *inoutvec, int *len,
+			       MPI_Datatype *type);
+
+
+
+
+/* Initialize *gdata to describe an empty range, allocating the histogram and
+ * record arrays if they are wanted
+ */
+
+void init_gap_data(gap_data *gdata, int want_hist, int want_records) {
+
+    gdata->summary.first = 0;
+    gdata->summary.last = 0;
+    gdata->summary.maxgap = 0;
+    gdata->summary.maxgap_at = 0;
+    gdata->hist = NULL;
+    gdata->records = NULL;
+    gdata->nrecords = 0;
+
+    if (want_hist) {
+	gdata->hist = calloc(MAX_GAP + 1, sizeof(long long));
+    }
+    if (want_records) {
+	gdata->records = malloc(2 * MAX_RECORDS * sizeof(long long));
+    }
+    if ((want_hist && (gdata->hist == NULL)) || (want_records && (gdata->records == NULL))) {
+	fprintf(stderr, "error allocating memory for gap data\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+}
+
+
+
+
+void free_gap_data(gap_data *gdata) {
+    free(gdata->hist);
+    free(gdata->records);
+}
+
+
+
+
+/* Update *gdata with the prime p, where p is larger than every prime
+ * previously added
+ */
+
+void add_prime(gap_data *gdata, long long p) {
+
+    gap_summary *summary = &gdata->summary;
+    long long gap;
+
+    // case: first prime found in range (signaled by first == 0)
+    if (!summary->first) {
+	summary->first = p;
+	summary->last = p;
+	return;
+    }
+
+    gap = p - summary->last;
+    if (gap > summary->maxgap) {
+	summary->maxgap = gap;
+	summary->maxgap_at = summary->last;
+	if (gdata->records && (gdata->nrecords < MAX_RECORDS)) {
+	    gdata->records[2 * gdata->nrecords] = summary->last;
+	    gdata->records[(2 * gdata->nrecords) + 1] = gap;
+	    gdata->nrecords++;
+	}
+    }
+    if (gdata->hist) {
+	gdata->hist[(gap < MAX_GAP) ? gap : MAX_GAP]++;
+    }
+
+    summary->last = p;
+}
+
+
+
+
+/* Add each prime among the first nown values of a sieved segment to the
+ * gap_data pointed to by data
+ */
+
+void gaps_segment(const uint64_t *bits, long long seg_low,
+		  long long nown, long long nbits, void *data) {
+    for_each_prime(bits, seg_low, nown, gap_prime, data);
+}
+
+
+
+
+/* Combine the summaries of two adjacent ranges, where every value in the range
+ * described by lo is smaller than every value in the range described by hi.
+ * The gap from the last prime of lo to the first prime of hi is the one gap not
+ * seen by either range.  Ties are resolved in favor of the smaller primes.
+ */
+
+void combine_gap_summary(const gap_summary *lo, const gap_summary *hi,
+			 gap_summary *result) {
+
+    gap_summary tmp;
+    long long gap;
+
+    // case: one of the ranges has no primes; nothing to stitch
+    if (!hi->first) {
+	*result = *lo;
+	return;
+    }
+    else if (!lo->first) {
+	*result = *hi;
+	return;
+    }
+
+    tmp = *lo;
+    tmp.last = hi->last;
+
+    gap = hi->first - lo->last;
+    if (gap > tmp.maxgap) {
+	tmp.maxgap = gap;
+	tmp.maxgap_at = lo->last;
+    }
+    if (hi->maxgap > tmp.maxgap) {
+	tmp.maxgap = hi->maxgap;
+	tmp.maxgap_at = hi->maxgap_at;
+    }
+
+    *result = tmp;
+}
+
+
+
+
+/* Create the MPI datatype for a gap_summary and the MPI operation that combines
+ * them with combine_gap_summary.  The operation is not commutative, so MPI
+ * applies it in rank order, which is also the order of the ranges.
+ */
+
+void create_gap_summary_op(MPI_Datatype *type, MPI_Op *op) {
+    MPI_Type_contiguous(4, MPI_LONG_LONG, type);
+    MPI_Type_commit(type);
+    MPI_Op_create(gap_summary_reduce, 0, op);
+}
+
+
+
+
+/* Add the prime p to the gap_data pointed to by data; the prime_fcn passed to
+ * for_each_prime by gaps_segment
+ */
+
+static void gap_prime(long long p, void *data) {
+    add_prime(data, p);
+}
+
+
+
+
+/* MPI user function: invec holds the summaries of ranges below those in
+ * inoutvec
+ */
+
+static void gap_summary_reduce(void *invec, void *inoutvec, int *len,
+			       MPI_Datatype *type) {
+
+    gap_summary *lo = invec;
+    gap_summary *hi = inoutvec;
+    int k;
+
+    for (k = 0; k < *len; k++) {
+	combine_gap_summary(&lo[k], &hi[k], &hi[k]);
+    }
+}
@@ -0,0 +1,43 @@
+
+#include <mpi.h>
+#include <stdint.h>
+
+#define MAX_GAP      2048  // gaps >= MAX_GAP are tallied in the last bin
+#define MAX_RECORDS   256  // maximum number of record gaps tracked per range
+
+/* Summary of the primes in a range of values.  A range containing no primes
+ * has first == 0.  maxgap_at is the smaller prime of the first consecutive pair
+ * in the range whose gap is maxgap.
+ */
+typedef struct {
+    long long first;
+    long long last;
+    long long maxgap;
+    long long maxgap_at;
+} gap_summary;
+
+/* Data passed through sieve_range to gaps_segment.  If hist is not NULL then
+ * hist[g] counts the gaps of length g.  If records is not NULL then the gaps
+ * that are larger than every previous gap in the range are stored as the pairs
+ * (records[2i], records[2i + 1]) = (smaller prime, gap).
+ */
+typedef struct {
+    gap_summary summary;
+    long long *hist;
+    long long *records;
+    int nrecords;
+} gap_data;
+
+void init_gap_data(gap_data *gdata, int want_hist, int want_records);
+
+void free_gap_data(gap_data *gdata);
+
+void add_prime(gap_data *gdata, long long p);
+
+void gaps_segment(const uint64_t *bits, long long seg_low,
+		  long long nown, long long nbits, void *data);
+
+void combine_gap_summary(const gap_summary *lo, const gap_summary *hi,
+			 gap_summary *result);
+
+void create_gap_summary_op(MPI_Datatype *type, MPI_Op *op);
@@ -0,0 +1,413 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include "mpi_helper.h"
+#include "id_fcns.h"
+
+#define FALSE 0
+#define TRUE  1
+
+#define MAX_BRUTE_COMBOS  10000000000LL  // 1e10
+
+static int char_value(const id_rules *rules, char c);
+static void sum_u128(void *invec, void *inoutvec, int *len, MPI_Datatype *type);
+
+
+
+
+/* Initialize *rules for ids of len characters from the given alphabet, with
+ * every id allowed
+ */
+
+void init_id_rules(id_rules *rules, int len, const char *alphabet) {
+
+    int i;
+    int j;
+
+    if ((len < 1) || (len > MAX_ID_LEN)) {
+	fprintf(stderr, "the id length must be between 1 and %d\n", MAX_ID_LEN);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    else if ((strlen(alphabet) < 1) || (strlen(alphabet) > MAX_ALPHABET)) {
+	fprintf(stderr, "the alphabet must have between 1 and %d characters\n",
+		MAX_ALPHABET);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+
+    rules->len = len;
+    rules->nchars = strlen(alphabet);
+    strcpy(rules->alphabet, alphabet);
+
+    for (i = 0; i < rules->nchars; i++) {
+	if (strchr(alphabet + i + 1, alphabet[i])) {
+	    fprintf(stderr, "the character '%c' appears twice in the alphabet\n",
+		    alphabet[i]);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	rules->lead_ok[i] = TRUE;
+	for (j = 0; j < rules->nchars; j++) {
+	    rules->pair_ok[i][j] = TRUE;
+	}
+    }
+    for (i = 0; i <= MAX_DIGIT_SUM; i++) {
+	rules->sum_ok[i] = TRUE;
+    }
+}
+
+
+
+
+/* Forbid each character in chars from being the first character of an id */
+
+void forbid_leading(id_rules *rules, const char *chars) {
+
+    for (; *chars; chars++) {
+	rules->lead_ok[char_value(rules, *chars)] = FALSE;
+    }
+}
+
+
+
+
+/* Forbid each of the comma-separated pairs of adjacent characters in pairs,
+ * e.g. "13,31" forbids a 3 following a 1 and a 1 following a 3.  The special
+ * entry "=" forbids every character from following itself.
+ */
+
+void forbid_pairs(id_rules *rules, const char *pairs) {
+
+    const char *curr;  // start of the current entry
+    int k;
+
+    curr = pairs;
+    while (*curr) {
+
+	if ((curr[0] == '=') && ((curr[1] == ',') || (curr[1] == '\0'))) {
+	    for (k = 0; k < rules->nchars; k++) {
+		rules->pair_ok[k][k] = FALSE;
+	    }
+	    curr += 1;
+	}
+	else if (curr[0] && curr[1] && ((curr[2] == ',') || (curr[2] == '\0'))) {
+	    rules->pair_ok[char_value(rules, curr[0])][char_value(rules, curr[1])] = FALSE;
+	    curr += 2;
+	}
+	else {
+	    fprintf(stderr, "Invalid list of forbidden pairs \"%s\"\n", pairs);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+
+	// Skip the separating comma
+	if (*curr == ',') {
+	    curr++;
+	}
+    }
+}
+
+
+
+
+/* Forbid each of the comma-separated sums in sums, e.g. "7,11,13" */
+
+void forbid_sums(id_rules *rules, const char *sums) {
+
+    const char *curr;  // start of the sum currently being read
+    char *endptr;      // point to next char after int read
+    long val;
+
+    // To distinguish success / failure after a call to strtol
+    errno = 0;
+
+    curr = sums;
+    while (*curr) {
+
+	val = strtol(curr, &endptr, 10);
+	if ((endptr == curr) || ((*endptr != ',') && (*endptr != '\0'))
+	    || (errno != 0) || (val < 0)) {
+	    fprintf(stderr, "Invalid list of forbidden sums \"%s\"\n", sums);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+
+	// Sums larger than MAX_DIGIT_SUM can't occur anyway
+	if (val <= MAX_DIGIT_SUM) {
+	    rules->sum_ok[val] = FALSE;
+	}
+
+	curr = (*endptr == ',') ? endptr + 1 : endptr;
+    }
+}
+
+
+
+
+/* Abort if the number of possible ids could overflow the counters, or if brute
+ * is TRUE and there are too many possible ids to enumerate
+ */
+
+void check_id_rules(const id_rules *rules, int brute) {
+
+    double log2_combos = rules->len * log2(rules->nchars);
+
+    if (log2_combos >= 127) {
+	fprintf(stderr, "there are too many possible ids to count in 128 bits\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    else if (brute && (log2_combos > log2(MAX_BRUTE_COMBOS))) {
+	fprintf(stderr, "there are too many possible ids to enumerate\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+}
+
+
+
+
+/* Count the ids satisfying the rules by dynamic programming over the states
+ * (previous character, sum of the characters so far), one character position
+ * at a time.  If cnt_t[c][s] is the number of acceptable prefixes of length t
+ * ending in the character c with sum s, then
+ *
+ *     cnt_{t+1}[c][s] = \sum_{b : pair_ok[b][c]} cnt_t[b][s - c]
+ *
+ * and the answer is the sum of cnt_len[c][s] over all c and the allowed s.
+ * The cost is O(len * nchars^2 * maxsum) instead of O(nchars^len).
+ *
+ * The states of each position are split into size nearly even contiguous blocks
+ * of (c, s) pairs.  Each process computes its block of the next position from
+ * the full current position, after which the blocks are exchanged with
+ * MPI_Allgatherv.  The final sum is done with a user-defined MPI reduction
+ * since MPI has no 128-bit integer type.  The result is only valid on rank 0.
+ */
+
+uint128_t count_ids_dp(const id_rules *rules, int rank, int size) {
+
+    int maxsum;         // largest possible sum of the characters
+    int nsums;          // number of possible sums, i.e. maxsum + 1
+    int nstates;        // number of (c, s) pairs
+    int low;            // lowest index of the local block of states
+    int high;           // one past the highest index of the local block
+    int *counts;        // number of states in each process's block
+    int *displs;        // lowest index of each process's block
+
+    uint128_t *curr;    // counts for the current position
+    uint128_t *next;    // counts for the next position
+    uint128_t *tmp;
+    uint128_t total_local;
+    uint128_t total;
+
+    MPI_Datatype u128_type;
+    MPI_Op sum_op;
+    int idx;
+    int pos;
+    int b;
+    int c;
+    int s;
+
+    maxsum = (rules->nchars - 1) * rules->len;
+    nsums = maxsum + 1;
+    nstates = rules->nchars * nsums;
+
+    curr = calloc(nstates, sizeof(uint128_t));
+    next = calloc(nstates, sizeof(uint128_t));
+    counts = malloc(size * sizeof(int));
+    displs = malloc(size * sizeof(int));
+    if ((curr == NULL) || (next == NULL) || (counts == NULL) || (displs == NULL)) {
+	fprintf(stderr, "error allocating memory for id counts\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    for (idx = 0; idx < size; idx++) {
+	displs[idx] = BLOCK_LOW(idx, size, nstates);
+	counts[idx] = BLOCK_SIZE(idx, size, nstates);
+    }
+    low = displs[rank];
+    high = low + counts[rank];
+
+    MPI_Type_contiguous(sizeof(uint128_t), MPI_BYTE, &u128_type);
+    MPI_Type_commit(&u128_type);
+    MPI_Op_create(sum_u128, 1, &sum_op);
+
+    // The first position: a single character, which must be allowed to lead
+    for (c = 0; c < rules->nchars; c++) {
+	curr[(c * nsums) + c] = rules->lead_ok[c];
+    }
+
+    for (pos = 1; pos < rules->len; pos++) {
+
+	// Compute the local block of the next position
+	for (idx = low; idx < high; idx++) {
+	    c = idx / nsums;
+	    s = idx % nsums;
+	    next[idx] = 0;
+	    if (s < c) {
+		continue;
+	    }
+	    for (b = 0; b < rules->nchars; b++) {
+		if (rules->pair_ok[b][c]) {
+		    next[idx] += curr[(b * nsums) + s - c];
+		}
+	    }
+	}
+
+	// Share the blocks so that every process has the whole position
+	MPI_Allgatherv(MPI_IN_PLACE, 0, u128_type, next, counts, displs,
+		       u128_type, MPI_COMM_WORLD);
+
+	tmp = curr;
+	curr = next;
+	next = tmp;
+    }
+
+    // Sum the local block over the allowed sums
+    total_local = 0;
+    for (idx = low; idx < high; idx++) {
+	if (rules->sum_ok[idx % nsums]) {
+	    total_local += curr[idx];
+	}
+    }
+    total = 0;
+    MPI_Reduce(&total_local, &total, 1, u128_type, sum_op, 0, MPI_COMM_WORLD);
+
+    MPI_Op_free(&sum_op);
+    MPI_Type_free(&u128_type);
+    free(curr);
+    free(next);
+    free(counts);
+    free(displs);
+
+    return total;
+}
+
+
+
+
+/* Count the ids satisfying the rules by checking every possible combination of
+ * characters, each process checking every size-th combination.  This is only
+ * feasible for short ids but serves as a cross-check of count_ids_dp.  The
+ * result is only valid on rank 0.
+ */
+
+long long count_ids_brute(const id_rules *rules, int rank, int size) {
+
+    int digits[MAX_ID_LEN];  // value of each character in the combination
+    long long ncombos;       // nchars^len
+    long long localct;
+    long long globalct;
+    long long val;
+    long long k;
+    int i;
+
+    ncombos = 1;
+    for (i = 0; i < rules->len; i++) {
+	ncombos *= rules->nchars;
+    }
+
+    /* Each iteration writes the k-th combination as len base-nchars digits,
+     * checks if it satisfies the rules, and if so adds 1 to localct
+     */
+    localct = 0;
+    for (k = rank; k < ncombos; k += size) {
+	val = k;
+	for (i = rules->len - 1; i >= 0; i--) {
+	    digits[i] = val % rules->nchars;
+	    val /= rules->nchars;
+	}
+	localct += check_satisfy(rules, digits);
+    }
+
+    // Collect local counts
+    MPI_Reduce(&localct, &globalct, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    return globalct;
+}
+
+
+
+
+/* Check that the combination of characters with values digits[0], ...,
+ * digits[len - 1] neither (i) starts with a forbidden character, nor (ii) has a
+ * forbidden pair of adjacent characters, nor (iii) has a forbidden sum.
+ */
+
+int check_satisfy(const id_rules *rules, const int *digits) {
+
+    int digsum;     // sum of the digits
+    int i;
+
+    if (!rules->lead_ok[digits[0]]) {
+	return FALSE;
+    }
+
+    digsum = digits[0];
+    for (i = 1; i < rules->len; i++) {
+	if (!rules->pair_ok[digits[i - 1]][digits[i]]) {
+	    return FALSE;
+	}
+	digsum += digits[i];
+    }
+
+    // If we've made it this far then only the sum is left to check
+    return rules->sum_ok[digsum];
+}
+
+
+
+
+/* Write the decimal representation of val to buf, which must have room for
+ * U128_STRLEN characters
+ */
+
+void sprint_u128(char *buf, uint128_t val) {
+
+    char tmp[U128_STRLEN];
+    int len;
+    int k;
+
+    len = 0;
+    do {
+	tmp[len++] = '0' + (int) (val % 10);
+	val /= 10;
+    } while (val);
+
+    for (k = 0; k < len; k++) {
+	buf[k] = tmp[len - 1 - k];
+    }
+    buf[len] = '\0';
+}
+
+
+
+
+/* Return the value of the character c, i.e. its position in the alphabet */
+
+static int char_value(const id_rules *rules, char c) {
+
+    const char *pos = strchr(rules->alphabet, c);
+
+    if ((pos == NULL) || (c == '\0')) {
+	fprintf(stderr, "the character '%c' is not in the alphabet\n", c);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+
+    return pos - rules->alphabet;
+}
+
+
+
+
+/* MPI user function: element-wise sum of 128-bit unsigned integers */
+
+static void sum_u128(void *invec, void *inoutvec, int *len, MPI_Datatype *type) {
+
+    uint128_t *in = invec;
+    uint128_t *inout = inoutvec;
+    int k;
+
+    for (k = 0; k < *len; k++) {
+	inout[k] += in[k];
+    }
+}
@@ -0,0 +1,42 @@
+
+#define MAX_ALPHABET   64  // maximum number of characters in the alphabet
+#define MAX_ID_LEN     32  // maximum number of characters in an id
+#define MAX_DIGIT_SUM  ((MAX_ALPHABET - 1) * MAX_ID_LEN)
+#define U128_STRLEN    40  // buffer length for sprint_u128
+
+typedef unsigned __int128 uint128_t;
+
+/* The rules that an acceptable id must satisfy.  The value of a character is
+ * its position in the alphabet, so that for the default alphabet "0123456789"
+ * the value of each character is the digit that it represents.
+ *
+ *    - lead_ok[c] is nonzero if the c-th character may be the first character
+ *    - pair_ok[c][d] is nonzero if the d-th character may follow the c-th
+ *    - sum_ok[s] is nonzero if the values of the characters may sum to s
+ */
+typedef struct {
+    int len;
+    int nchars;
+    char alphabet[MAX_ALPHABET + 1];
+    char lead_ok[MAX_ALPHABET];
+    char pair_ok[MAX_ALPHABET][MAX_ALPHABET];
+    char sum_ok[MAX_DIGIT_SUM + 1];
+} id_rules;
+
+void init_id_rules(id_rules *rules, int len, const char *alphabet);
+
+void forbid_leading(id_rules *rules, const char *chars);
+
+void forbid_pairs(id_rules *rules, const char *pairs);
+
+void forbid_sums(id_rules *rules, const char *sums);
+
+void check_id_rules(const id_rules *rules, int brute);
+
+uint128_t count_ids_dp(const id_rules *rules, int rank, int size);
+
+long long count_ids_brute(const id_rules *rules, int rank, int size);
+
+int check_satisfy(const id_rules *rules, const int *digits);
+
+void sprint_u128(char *buf, uint128_t val);
@@ -0,0 +1,247 @@
+/* Grows the programs of exercises 4.6 and 4.7 into a microbenchmark of what
+ * every program here pays to the MPI library: the time of MPI_Init and
+ * MPI_Finalize, the latency of MPI_Barrier, and the latency and bandwidth of
+ * MPI_Reduce, MPI_Allreduce, MPI_Bcast, and MPI_Reduce_scatter for messages
+ * from a single int up to the size of a full sieve grid.
+ */
+
+/* Accepts an argument "b" for the largest message size in bytes (default 2^24,
+ * the odd-only bit grid of a sieve up to about 2.7e8), "r" for the number of
+ * timed repetitions of the smallest messages (default 1000; larger messages
+ * are repeated fewer times), and "o" for the name of the CSV file that the
+ * results are written to (default standard output).
+ *
+ * Each line of the CSV file holds the operation, the number of processes, the
+ * message size in bytes, the number of repetitions, the minimum, mean, and
+ * maximum over the processes of the mean time per operation in microseconds,
+ * and the bandwidth in MB/s found from the message size and the maximum time.
+ * MPI_Init is timed by every process with the system clock, and MPI_Finalize
+ * only by process 0, since no communication is possible afterwards.
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "parse_n.h"
+#include "mpi_helper.h"
+
+#define DEFAULT_MAX_BYTES  (1 << 24)
+#define DEFAULT_REPS       1000
+#define TARGET_BYTES       (1LL << 30)  // bytes moved per timed size and operation
+#define MIN_REPS           5
+#define NWARMUP            2
+
+#define OP_BARRIER         0
+#define OP_REDUCE          1
+#define OP_ALLREDUCE       2
+#define OP_BCAST           3
+#define OP_REDUCE_SCATTER  4
+#define NOPS               5
+
+static const char *op_names[NOPS] = {
+    "barrier", "reduce", "allreduce", "bcast", "reduce_scatter"
+};
+
+static double wall_time(void);
+static void run_op(int op, int *sendbuf, int *recvbuf, int count,
+		   const int *recvcounts);
+static void write_row(FILE *out, const char *op, int size, long long bytes,
+		      int reps, double local_time);
+
+
+int main(int argc, char *argv[]) {
+
+    int rank;
+    int size;
+
+    double init_time;      // time of MPI_Init on this process
+    double final_time;     // time of MPI_Finalize on process 0
+    double start;
+    long long max_bytes;   // largest message size
+    long long bytes;       // current message size
+    int reps;              // timed repetitions of the smallest messages
+    int nreps;             // timed repetitions of the current size
+    int count;             // number of ints in the current message
+    int *sendbuf;
+    int *recvbuf;
+    int *recvcounts;       // number of ints of each process for reduce_scatter
+    const char *out_name;  // name of the CSV file, or NULL for stdout
+    FILE *out;
+    int op;
+    int k;
+
+    // Initialize the MPI environment, timing it with the system clock
+    init_time = -wall_time();
+    MPI_Init(&argc, &argv);
+    init_time += wall_time();
+    // Get the number of the processes
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    // Get the rank of the process
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* Default values of the parameters.  If an argument is given as an option
+     * then its value is written to the corresponding variable in
+     * parse_bench_args.
+     */
+    max_bytes = DEFAULT_MAX_BYTES;
+    reps = DEFAULT_REPS;
+    out_name = NULL;
+    parse_bench_args(argc, argv, &max_bytes, &reps, &out_name);
+    if (max_bytes > (long long) sizeof(int) * 0x7fffffff) {
+	fprintf(stderr, "the largest message size must be < %lld\n",
+		(long long) sizeof(int) * 0x7fffffff);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+
+    out = stdout;
+    if (rank == 0) {
+	if ((out_name != NULL) && ((out = fopen(out_name, "w")) == NULL)) {
+	    fprintf(stderr, "error opening \"%s\" for writing\n", out_name);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	}
+	fprintf(out, "op,nprocs,bytes,reps,min_us,mean_us,max_us,bandwidth_MBps\n");
+    }
+
+    count = (max_bytes + sizeof(int) - 1) / sizeof(int);
+    sendbuf = malloc(count * sizeof(int));
+    recvbuf = malloc(count * sizeof(int));
+    recvcounts = malloc(size * sizeof(int));
+    if ((sendbuf == NULL) || (recvbuf == NULL) || (recvcounts == NULL)) {
+	fprintf(stderr, "error allocating memory for the message buffers\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    for (k = 0; k < count; k++) {
+	sendbuf[k] = rank + k;
+    }
+
+    write_row(out, "init", size, 0, 1, init_time);
+
+    // The barrier latency, then each collective for each message size
+    for (op = 0; op < NOPS; op++) {
+	for (bytes = sizeof(int); bytes <= max_bytes; bytes *= 2) {
+
+	    // case: the barrier has no message
+	    if ((op == OP_BARRIER) && (bytes > (long long) sizeof(int))) {
+		break;
+	    }
+
+	    count = bytes / sizeof(int);
+	    for (k = 0; k < size; k++) {
+		recvcounts[k] = BLOCK_SIZE(k, size, count);
+	    }
+	    nreps = TARGET_BYTES / bytes;
+	    nreps = (nreps < reps) ? nreps : reps;
+	    nreps = (nreps > MIN_REPS) ? nreps : MIN_REPS;
+
+	    for (k = 0; k < NWARMUP; k++) {
+		run_op(op, sendbuf, recvbuf, count, recvcounts);
+	    }
+	    MPI_Barrier(MPI_COMM_WORLD);
+	    start = MPI_Wtime();
+	    for (k = 0; k < nreps; k++) {
+		run_op(op, sendbuf, recvbuf, count, recvcounts);
+	    }
+	    write_row(out, op_names[op], size, (op == OP_BARRIER) ? 0 : bytes,
+		      nreps, (MPI_Wtime() - start) / nreps);
+	}
+    }
+
+    free(sendbuf);
+    free(recvbuf);
+    free(recvcounts);
+
+    // Finalize the MPI environment
+    final_time = -wall_time();
+    MPI_Finalize();
+    final_time += wall_time();
+
+    if (rank == 0) {
+	fprintf(out, "finalize,%d,0,1,%.3f,%.3f,%.3f,\n",
+		size, 1e6 * final_time, 1e6 * final_time, 1e6 * final_time);
+	if (out != stdout) {
+	    fclose(out);
+	}
+    }
+
+    return 0;
+}
+
+
+
+
+/* Return the time in seconds of a monotonic system clock, which unlike
+ * MPI_Wtime may be used before MPI_Init and after MPI_Finalize
+ */
+
+static double wall_time(void) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (1e-9 * ts.tv_nsec);
+}
+
+
+
+
+/* Perform one instance of the operation op on count ints of sendbuf, summing
+ * them where the operation is a reduction.  MPI_Reduce_scatter leaves
+ * recvcounts[rank] ints of the sum on each process.
+ */
+
+static void run_op(int op, int *sendbuf, int *recvbuf, int count,
+		   const int *recvcounts) {
+
+    switch (op) {
+    case OP_BARRIER:
+	MPI_Barrier(MPI_COMM_WORLD);
+	break;
+    case OP_REDUCE:
+	MPI_Reduce(sendbuf, recvbuf, count, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+	break;
+    case OP_ALLREDUCE:
+	MPI_Allreduce(sendbuf, recvbuf, count, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+	break;
+    case OP_BCAST:
+	MPI_Bcast(sendbuf, count, MPI_INT, 0, MPI_COMM_WORLD);
+	break;
+    case OP_REDUCE_SCATTER:
+	MPI_Reduce_scatter(sendbuf, recvbuf, recvcounts, MPI_INT, MPI_SUM,
+			   MPI_COMM_WORLD);
+	break;
+    }
+}
+
+
+
+
+/* Gather the minimum, mean, and maximum over the processes of local_time, the
+ * mean time of an operation on this process, and write them to out on process
+ * 0 as a line of the CSV file
+ */
+
+static void write_row(FILE *out, const char *op, int size, long long bytes,
+		      int reps, double local_time) {
+
+    double min_time;
+    double sum_time;
+    double max_time;
+    int rank;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Reduce(&local_time, &min_time, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&local_time, &sum_time, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&local_time, &max_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+	fprintf(out, "%s,%d,%lld,%d,%.3f,%.3f,%.3f,", op, size, bytes, reps,
+		1e6 * min_time, 1e6 * sum_time / size, 1e6 * max_time);
+	if (bytes > 0) {
+	    fprintf(out, "%.1f", bytes / max_time / 1e6);
+	}
+	fprintf(out, "\n");
+	fflush(out);
+    }
+}
@@ -44,3 +44,205 @@ void parse_args(int argc, char* argv[], int *n) {
 	}
     }
 }
+
+
+
+
+/* Parse user parameter specifications for the quadrature programs: a positive
+ * integer n for the number of intervals of the fixed rules, the name fcn of the
+ * integrand, the name method of the integration method, and the error
+ * tolerance tol of the adaptive methods.  Each is written only if given.
+ */
+
+void parse_quad_args(int argc, char* argv[], long long *n, const char **fcn,
+		     const char **method, double *tol) {
+
+    int opt;        // argument type info
+    char* endptr;   // point to next char after number read (should point to '\0')
+
+    // To distinguish success / failure after a call to strtoll or strtod
+    errno = 0;
+
+    while ((opt = getopt(argc, argv, "n:f:m:e:")) != -1) {
+	switch (opt) {
+	case 'n':
+	    *n = strtoll(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*n < 1) {
+		fprintf(stderr, "n must be >= 1\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'f':
+	    *fcn = optarg;
+	    break;
+	case 'm':
+	    *method = optarg;
+	    break;
+	case 'e':
+	    *tol = strtod(optarg, &endptr);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for the tolerance\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for the tolerance\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (!(*tol > 0)) {
+		fprintf(stderr, "the tolerance must be > 0\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case '?':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	case ':':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+    }
+}
+
+
+
+
+/* Parse user parameter specifications for the quasi-Monte Carlo program: the
+ * name fcn of the integrand, the dimension dim, the number npoints of points
+ * per replica, the number nreps of replicas, the name method of the point set,
+ * and the seed of the randomization.  Each is written only if given.
+ */
+
+void parse_qmc_args(int argc, char* argv[], const char **fcn, int *dim,
+		    long long *npoints, int *nreps, const char **method,
+		    unsigned long long *seed) {
+
+    int opt;        // argument type info
+    char* endptr;   // point to next char after number read (should point to '\0')
+
+    // To distinguish success / failure after a call to strtoll or strtoull
+    errno = 0;
+
+    while ((opt = getopt(argc, argv, "f:d:n:r:m:s:")) != -1) {
+	switch (opt) {
+	case 'f':
+	    *fcn = optarg;
+	    break;
+	case 'd':
+	    *dim = strtol(optarg, &endptr, 10);
+	    if ((*endptr != '\0') || (errno != 0)) {
+		fprintf(stderr, "Invalid argument for the dimension\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*dim < 1) {
+		fprintf(stderr, "the dimension must be >= 1\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'n':
+	    *npoints = strtoll(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*npoints < 1) {
+		fprintf(stderr, "n must be >= 1\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'r':
+	    *nreps = strtol(optarg, &endptr, 10);
+	    if ((*endptr != '\0') || (errno != 0)) {
+		fprintf(stderr, "Invalid argument for the number of replicas\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*nreps < 1) {
+		fprintf(stderr, "the number of replicas must be >= 1\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'm':
+	    *method = optarg;
+	    break;
+	case 's':
+	    *seed = strtoull(optarg, &endptr, 10);
+	    if ((*endptr != '\0') || (errno != 0)) {
+		fprintf(stderr, "Invalid argument for the seed\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case '?':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	case ':':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+    }
+}
+
+
+
+
+/* Parse user parameter specifications for the MPI microbenchmark: the largest
+ * message size max_bytes, the number reps of repetitions of the smallest
+ * messages, and the name out of the CSV file.  Each is written only if given.
+ */
+
+void parse_bench_args(int argc, char* argv[], long long *max_bytes, int *reps,
+		      const char **out) {
+
+    int opt;        // argument type info
+    char* endptr;   // point to next char after number read (should point to '\0')
+
+    // To distinguish success / failure after a call to strtoll or strtol
+    errno = 0;
+
+    while ((opt = getopt(argc, argv, "b:r:o:")) != -1) {
+	switch (opt) {
+	case 'b':
+	    *max_bytes = strtoll(optarg, &endptr, 10);
+	    if ((*endptr != '\0') || (errno != 0)) {
+		fprintf(stderr, "Invalid argument for the largest message size\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*max_bytes < (long long) sizeof(int)) {
+		fprintf(stderr, "the largest message size must be >= %d\n",
+			(int) sizeof(int));
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'r':
+	    *reps = strtol(optarg, &endptr, 10);
+	    if ((*endptr != '\0') || (errno != 0)) {
+		fprintf(stderr, "Invalid argument for the number of repetitions\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*reps < 1) {
+		fprintf(stderr, "the number of repetitions must be >= 1\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'o':
+	    *out = optarg;
+	    break;
+	case '?':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	case ':':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+    }
+}
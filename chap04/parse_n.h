@@ -1,2 +1,12 @@
 
 void parse_args(int argc, char* argv[], int *n);
+
+void parse_quad_args(int argc, char* argv[], long long *n, const char **fcn,
+		     const char **method, double *tol);
+
+void parse_qmc_args(int argc, char* argv[], const char **fcn, int *dim,
+		    long long *npoints, int *nreps, const char **method,
+		    unsigned long long *seed);
+
+void parse_bench_args(int argc, char* argv[], long long *max_bytes, int *reps,
+		      const char **out);
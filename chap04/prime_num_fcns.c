@@ -1,5 +1,6 @@
 
 #include <mpi.h>
+#include <stdint.h>
 #include <math.h>    // sqrt
 
 #define TOLERANCE 0.000000000001  // 1e-12
@@ -7,6 +8,12 @@
 #define FALSE    0
 #define TRUE     1
 
+typedef unsigned __int128 uint128_t;
+
+static uint64_t mont_mul(uint64_t a, uint64_t b, uint64_t n, uint64_t ninv);
+static int mr_witness(uint64_t a, uint64_t n, uint64_t d, int s, uint64_t ninv,
+		      uint64_t one, uint64_t r2);
+
 
 /* Split the numbers from 1 to n into size nearly evenly sized sets; *startnum
  * and *stopnum are the smallest and largest values of the rank-th set
@@ -30,6 +37,29 @@ void find_process_set(int rank, int size, int maxnum, int *startnum, int *stopnu
 
 
 
+/* The same as find_process_set but for a maximum number that may not be
+ * representable as an int.  Note that rank * maxnum can overflow, so we use
+ * floor(r * m / z) == r * (m / z) + floor(r * (m % z) / z) instead.
+ */
+
+void find_process_set_ll(int rank, int size, long long maxnum,
+			 long long *startnum, long long *stopnum) {
+
+    long long quot = maxnum / size;
+    long long rem = maxnum % size;
+
+    *startnum = (rank * quot) + ((rank * rem) / size) + 1;
+    *stopnum = ((rank + 1) * quot) + (((rank + 1) * rem) / size);
+
+    // case: startnum is an even number.  Advance to first odd number in set
+    if (((*startnum) % 2) == 0) {
+	(*startnum)++;
+    }
+}
+
+
+
+
 /* Return TRUE if w is prime, FALSE if either (i) not prime or if (ii) it is a
  * value < 2 and consequently is undefined.
  *
@@ -75,3 +105,158 @@ int check_prime(int w) {
     // If we've made it here then no factor exists
     return TRUE;
 }
+
+
+
+
+/* Return TRUE if w is prime and FALSE otherwise, for any 64-bit w.
+ *
+ * Small factors are first removed by trial division by the primes below 64,
+ * which also decides every w < 64^2.  The remaining values are checked with the
+ * Miller-Rabin test, which is deterministic for w < 2^64 when the bases are
+ * chosen from the sets below (the last is due to Jim Sinclair).  Arithmetic
+ * modulo w is done in Montgomery form, so that each modular multiplication
+ * costs two 64 x 64 -> 128 bit multiplications and no division.  As a result
+ * the cost is nearly independent of the magnitude of w, unlike check_prime
+ * whose cost grows with sqrt(w).
+ */
+
+int check_prime_mr(uint64_t w) {
+
+    static const uint64_t small_primes[] = {
+	2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61
+    };
+    static const uint64_t bases_32[] = { 2, 7, 61 };
+    static const uint64_t bases_64[] = {
+	2, 325, 9375, 28178, 450775, 9780504, 1795265022
+    };
+
+    const uint64_t *bases;
+    int nbases;
+    uint64_t d;      // w - 1 == d * 2^s with d odd
+    int s;
+    uint64_t ninv;   // w^(-1) mod 2^64
+    uint64_t one;    // 1 in Montgomery form, i.e. 2^64 mod w
+    uint64_t r2;     // 2^128 mod w
+    uint64_t a;
+    int k;
+
+    // Prime numbers are only defined for w >= 2
+    if (w <= 1) {
+	return FALSE;
+    }
+
+    // Trial division by the small primes
+    for (k = 0; k < (int) (sizeof(small_primes) / sizeof(uint64_t)); k++) {
+	if (w == small_primes[k]) {
+	    return TRUE;
+	}
+	else if (!(w % small_primes[k])) {
+	    return FALSE;
+	}
+    }
+    if (w < 64 * 64) {
+	return TRUE;
+    }
+
+    // Write w - 1 as d * 2^s
+    d = w - 1;
+    s = __builtin_ctzll(d);
+    d >>= s;
+
+    /* Find w^(-1) mod 2^64 by Newton's iteration; w * w == 1 mod 8 for odd w,
+     * and each iteration doubles the number of correct low-order bits
+     */
+    ninv = w;
+    for (k = 0; k < 5; k++) {
+	ninv *= 2 - (w * ninv);
+    }
+    one = (-w) % w;
+    r2 = (uint64_t) (((uint128_t) one * one) % w);
+
+    if (w < 4759123141ULL) {
+	bases = bases_32;
+	nbases = sizeof(bases_32) / sizeof(uint64_t);
+    }
+    else {
+	bases = bases_64;
+	nbases = sizeof(bases_64) / sizeof(uint64_t);
+    }
+
+    for (k = 0; k < nbases; k++) {
+	a = bases[k] % w;
+	// case: base is a multiple of w; it says nothing about w
+	if (!a) {
+	    continue;
+	}
+	if (mr_witness(a, w, d, s, ninv, one, r2)) {
+	    return FALSE;
+	}
+    }
+
+    // If we've made it here then no base is a witness to w being composite
+    return TRUE;
+}
+
+
+
+
+/* Return the Montgomery product a * b * 2^(-64) mod n, for a, b < n and n odd.
+ *
+ * With T = a * b and m = T * n^(-1) mod 2^64, T - m * n is divisible by 2^64
+ * and the low halves of T and m * n are equal, so the result is the difference
+ * of the high halves (plus n if that difference is negative).  Unlike the
+ * textbook T + m * (-n^(-1)) form this cannot overflow for n >= 2^63.
+ */
+
+static uint64_t mont_mul(uint64_t a, uint64_t b, uint64_t n, uint64_t ninv) {
+
+    uint128_t t = (uint128_t) a * b;
+    uint64_t m = (uint64_t) t * ninv;
+    uint64_t t_hi = (uint64_t) (t >> 64);
+    uint64_t mn_hi = (uint64_t) (((uint128_t) m * n) >> 64);
+
+    return (t_hi < mn_hi) ? (t_hi - mn_hi + n) : (t_hi - mn_hi);
+}
+
+
+
+
+/* Return TRUE if a is a Miller-Rabin witness to the compositeness of the odd
+ * number n, where n - 1 == d * 2^s, ninv == n^(-1) mod 2^64, one == 2^64 mod n
+ * and r2 == 2^128 mod n.
+ */
+
+static int mr_witness(uint64_t a, uint64_t n, uint64_t d, int s, uint64_t ninv,
+		      uint64_t one, uint64_t r2) {
+
+    uint64_t minus_one = n - one;  // -1 in Montgomery form
+    uint64_t base;
+    uint64_t x;
+    int k;
+
+    // Compute x = a^d in Montgomery form by binary exponentiation
+    base = mont_mul(a, r2, n, ninv);
+    x = one;
+    while (d) {
+	if (d & 1) {
+	    x = mont_mul(x, base, n, ninv);
+	}
+	base = mont_mul(base, base, n, ninv);
+	d >>= 1;
+    }
+
+    if ((x == one) || (x == minus_one)) {
+	return FALSE;
+    }
+
+    // Square up to s - 1 times looking for -1
+    for (k = 1; k < s; k++) {
+	x = mont_mul(x, x, n, ninv);
+	if (x == minus_one) {
+	    return FALSE;
+	}
+    }
+
+    return TRUE;
+}
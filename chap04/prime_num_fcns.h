@@ -1,4 +1,9 @@
 
+#include <stdint.h>
+
 void find_process_set(int rank, int size, int maxnum, int *startnum, int *stopnum);
+void find_process_set_ll(int rank, int size, long long maxnum,
+			 long long *startnum, long long *stopnum);
 int check_prime(int w);
+int check_prime_mr(uint64_t w);
 void parse_args(int argc, char* argv[], int *n);
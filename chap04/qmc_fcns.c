@@ -0,0 +1,465 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+
+#include "mpi_helper.h"
+#include "qmc_fcns.h"
+
+#define GAUSS_WIDTH  2.0   // the "gauss" integrand is exp(-(2 |x - 1/2|)^2)
+#define OSC_PHASE    0.3   // the "oscill" integrand is cos(2 pi 0.3 + sum x_j)
+
+static uint64_t splitmix64(uint64_t *state);
+static double uniform(uint64_t seed, uint64_t idx);
+static void tensor_points(int k, int dim, long long first, int len, double *x);
+static void batch_gfun(const double *x, double *y, int len, int dim);
+static void batch_gauss(const double *x, double *y, int len, int dim);
+static void batch_oscill(const double *x, double *y, int len, int dim);
+static double exact_gfun(int dim);
+static double exact_gauss(int dim);
+static double exact_oscill(int dim);
+
+static const qmc_integrand integrands[] = {
+    { "gfun",   "prod_j (|4 x_j - 2| + j) / (1 + j)",
+      batch_gfun,   exact_gfun },
+    { "gauss",  "exp(-4 sum_j (x_j - 1/2)^2)",
+      batch_gauss,  exact_gauss },
+    { "oscill", "cos(0.6 pi + sum_j x_j)",
+      batch_oscill, exact_oscill }
+};
+
+/* Sobol direction numbers of Joe and Kuo for dimensions 2 to QMC_MAX_DIM:
+ * the degree s of the primitive polynomial, its inner coefficients a, and the
+ * initial values m_1, ..., m_s.  The first dimension is the van der Corput
+ * sequence, with every m_i = 1.
+ */
+static const struct {
+    int s;
+    int a;
+    int m[6];
+} sobol_table[QMC_MAX_DIM - 1] = {
+    { 1,  0, { 1 } },
+    { 2,  1, { 1, 3 } },
+    { 3,  1, { 1, 3, 1 } },
+    { 3,  2, { 1, 1, 1 } },
+    { 4,  1, { 1, 1, 3, 3 } },
+    { 4,  4, { 1, 3, 5, 13 } },
+    { 5,  2, { 1, 1, 5, 5, 17 } },
+    { 5,  4, { 1, 1, 5, 5, 5 } },
+    { 5,  7, { 1, 1, 7, 11, 19 } },
+    { 5, 11, { 1, 1, 5, 1, 1 } },
+    { 5, 13, { 1, 1, 1, 3, 11 } },
+    { 5, 14, { 1, 3, 5, 5, 31 } },
+    { 6,  1, { 1, 3, 3, 9, 7, 49 } },
+    { 6, 13, { 1, 1, 1, 15, 21, 21 } },
+    { 6, 16, { 1, 3, 1, 13, 27, 49 } }
+};
+
+
+
+
+/* Return the integrand with the given name, or NULL if there is none */
+
+const qmc_integrand *find_qmc_integrand(const char *name) {
+
+    int k;
+
+    for (k = 0; k < (int) (sizeof(integrands) / sizeof(qmc_integrand)); k++) {
+	if (!strcmp(name, integrands[k].name)) {
+	    return &integrands[k];
+	}
+    }
+
+    return NULL;
+}
+
+
+
+
+/* Print the name and description of each integrand to stderr */
+
+void print_qmc_integrands(void) {
+
+    int k;
+
+    fprintf(stderr, "The available integrands are:\n");
+    for (k = 0; k < (int) (sizeof(integrands) / sizeof(qmc_integrand)); k++) {
+	fprintf(stderr, "    %-8s  %s\n", integrands[k].name, integrands[k].desc);
+    }
+}
+
+
+
+
+/* Return the QMC_* constant of the method with the given name, or -1 if there
+ * is none
+ */
+
+int find_qmc_method(const char *method) {
+
+    if (!strcmp(method, "sobol")) {
+	return QMC_SOBOL;
+    }
+    else if (!strcmp(method, "mc")) {
+	return QMC_MC;
+    }
+    else if (!strcmp(method, "tensor")) {
+	return QMC_TENSOR;
+    }
+
+    return -1;
+}
+
+
+
+
+/* Initialize *gen with the direction numbers of the first dim dimensions of the
+ * Sobol sequence, randomized with the seed by a linear matrix scrambling and a
+ * digital shift.
+ *
+ * The direction number v_i of a dimension holds the i-th column of its
+ * generator matrix, with the first digit in the most significant bit.  The
+ * scrambling replaces the matrix C by L C for a random lower triangular L with
+ * unit diagonal, i.e. digit i of each column becomes the XOR of digits 1, ...,
+ * i selected by row i of L.  This keeps the net properties of the sequence
+ * while making every point uniformly distributed, so that the average over a
+ * replica is an unbiased estimate of the integral.
+ */
+
+void init_sobol(sobol_gen *gen, int dim, uint64_t seed) {
+
+    uint32_t rows[QMC_BITS];   // rows of L; row i has bit 31 - i on the diagonal
+    uint32_t orig;
+    uint32_t scrambled;
+    uint64_t state;
+    int s;
+    int a;
+    int i;
+    int j;
+    int k;
+
+    gen->dim = dim;
+    state = seed;
+
+    for (j = 0; j < dim; j++) {
+
+	// The unscrambled direction numbers
+	if (j == 0) {
+	    for (i = 0; i < QMC_BITS; i++) {
+		gen->v[j][i] = 1U << (QMC_BITS - 1 - i);
+	    }
+	}
+	else {
+	    s = sobol_table[j - 1].s;
+	    a = sobol_table[j - 1].a;
+	    for (i = 0; i < s; i++) {
+		gen->v[j][i] = (uint32_t) sobol_table[j - 1].m[i] << (QMC_BITS - 1 - i);
+	    }
+	    for (i = s; i < QMC_BITS; i++) {
+		gen->v[j][i] = gen->v[j][i - s] ^ (gen->v[j][i - s] >> s);
+		for (k = 1; k < s; k++) {
+		    if ((a >> (s - 1 - k)) & 1) {
+			gen->v[j][i] ^= gen->v[j][i - k];
+		    }
+		}
+	    }
+	}
+
+	// A random lower triangular L with unit diagonal
+	for (i = 0; i < QMC_BITS; i++) {
+	    rows[i] = (uint32_t) splitmix64(&state);
+	    rows[i] &= (i == 0) ? 0 : ~((1U << (QMC_BITS - i)) - 1);
+	    rows[i] |= 1U << (QMC_BITS - 1 - i);
+	}
+	for (k = 0; k < QMC_BITS; k++) {
+	    orig = gen->v[j][k];
+	    scrambled = 0;
+	    for (i = 0; i < QMC_BITS; i++) {
+		scrambled |= (uint32_t) __builtin_parity(rows[i] & orig) << (QMC_BITS - 1 - i);
+	    }
+	    gen->v[j][k] = scrambled;
+	}
+
+	gen->shift[j] = (uint32_t) splitmix64(&state);
+    }
+}
+
+
+
+
+/* Write the points first, ..., first + len - 1 of the randomized Sobol
+ * sequence to x, point k in x[k * dim], ..., x[(k * dim) + dim - 1].
+ *
+ * The points are generated in Gray code order: point i is the XOR of the
+ * direction numbers selected by the bits of i ^ (i >> 1).  The first point is
+ * found directly, which lets each process start anywhere in the sequence, and
+ * each following point differs from the previous one by a single direction
+ * number, the one indexed by the number of trailing zeros of its index.
+ */
+
+void sobol_points(const sobol_gen *gen, uint32_t first, int len, double *x) {
+
+    uint32_t curr[QMC_MAX_DIM];
+    uint32_t gray;
+    uint32_t idx;
+    int bit;
+    int j;
+    int k;
+
+    gray = first ^ (first >> 1);
+    for (j = 0; j < gen->dim; j++) {
+	curr[j] = 0;
+	for (bit = 0; bit < QMC_BITS; bit++) {
+	    if ((gray >> bit) & 1) {
+		curr[j] ^= gen->v[j][bit];
+	    }
+	}
+    }
+
+    idx = first;
+    for (k = 0; k < len; k++) {
+	for (j = 0; j < gen->dim; j++) {
+	    x[(k * gen->dim) + j] = ((curr[j] ^ gen->shift[j]) + 0.5) / 4294967296.0;
+	}
+	if (k == len - 1) {
+	    break;
+	}
+	idx++;
+	bit = __builtin_ctz(idx);
+	for (j = 0; j < gen->dim; j++) {
+	    curr[j] ^= gen->v[j][bit];
+	}
+    }
+}
+
+
+
+
+/* Estimate the integral of f over the dim-dimensional unit cube with nreps
+ * independent replicas of npoints points each, and write the mean of the
+ * replicas and its standard error to *mean and *stderror on rank 0.
+ *
+ * The points of each replica are split into size contiguous blocks, and each
+ * process generates its block directly from the index of its first point, so
+ * that there is no communication until the per-replica sums are combined with
+ * a single MPI_Reduce.  With QMC_SOBOL every replica is a differently scrambled
+ * Sobol sequence; with QMC_MC the points are pseudo-random, found from a hash
+ * of the seed, replica, and point index so that the result does not depend on
+ * the number of processes.  QMC_TENSOR is the tensor product of the midpoint
+ * rule with the largest k such that k^dim <= npoints, for comparison; it has no
+ * error estimate, so *stderror is set to -1.
+ */
+
+void qmc_integrate(const qmc_integrand *f, int method, int dim, long long npoints,
+		   int nreps, uint64_t seed, int rank, int size,
+		   double *mean, double *stderror, long long *nevals) {
+
+    double x[QMC_BATCH * QMC_MAX_DIM];   // the points of the current batch
+    double y[QMC_BATCH];                 // f at the points
+    double *local;       // the local sum of each replica
+    double *global;      // the sum of each replica
+    double batchsum;
+    double var;
+    sobol_gen gen;
+    uint64_t repseed;
+    long long npts;      // number of points per replica
+    long long low;       // first point of this process
+    long long high;      // one past the last point of this process
+    long long idx;
+    int ntensor;         // points per dimension of the tensor rule
+    int len;
+    int r;
+    int j;
+    int k;
+
+    // The tensor rule is a single replica of ntensor^dim points
+    ntensor = 0;
+    if (method == QMC_TENSOR) {
+	nreps = 1;
+	ntensor = floor(pow(npoints, 1.0 / dim) + 1e-9);
+	for (npts = 1, j = 0; j < dim; j++) {
+	    npts *= ntensor;
+	}
+    }
+    else {
+	npts = npoints;
+    }
+
+    local = calloc(nreps, sizeof(double));
+    global = calloc(nreps, sizeof(double));
+    if ((local == NULL) || (global == NULL)) {
+	fprintf(stderr, "error allocating memory for the replica sums\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    low = BLOCK_LOW(rank, size, npts);
+    high = BLOCK_LOW(rank + 1, size, npts);
+
+    for (r = 0; r < nreps; r++) {
+
+	repseed = seed + r;
+	if (method == QMC_SOBOL) {
+	    init_sobol(&gen, dim, splitmix64(&repseed));
+	}
+
+	for (idx = low; idx < high; idx += len) {
+	    len = ((high - idx) < QMC_BATCH) ? (high - idx) : QMC_BATCH;
+
+	    if (method == QMC_SOBOL) {
+		sobol_points(&gen, idx, len, x);
+	    }
+	    else if (method == QMC_MC) {
+		for (k = 0; k < len * dim; k++) {
+		    x[k] = uniform(repseed, ((idx * dim) + k));
+		}
+	    }
+	    else {
+		tensor_points(ntensor, dim, idx, len, x);
+	    }
+
+	    f->batch(x, y, len, dim);
+	    batchsum = 0;
+	    for (k = 0; k < len; k++) {
+		batchsum += y[k];
+	    }
+	    local[r] += batchsum;
+	}
+    }
+
+    MPI_Reduce(local, global, nreps, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    // The mean of the replica estimates and the standard error of the mean
+    *mean = 0;
+    for (r = 0; r < nreps; r++) {
+	global[r] /= npts;
+	*mean += global[r];
+    }
+    *mean /= nreps;
+    var = 0;
+    for (r = 0; r < nreps; r++) {
+	var += (global[r] - *mean) * (global[r] - *mean);
+    }
+    *stderror = (nreps > 1) ? sqrt(var / (nreps - 1) / nreps) : -1;
+    *nevals = npts * nreps;
+
+    free(local);
+    free(global);
+}
+
+
+
+
+/* Write the points first, ..., first + len - 1 of the tensor product of the
+ * k-point midpoint rules to x, the last coordinate varying fastest
+ */
+
+static void tensor_points(int k, int dim, long long first, int len, double *x) {
+
+    long long idx;
+    int i;
+    int j;
+
+    for (i = 0; i < len; i++) {
+	idx = first + i;
+	for (j = dim - 1; j >= 0; j--) {
+	    x[(i * dim) + j] = ((idx % k) + 0.5) / k;
+	    idx /= k;
+	}
+    }
+}
+
+
+
+
+/* Advance the state and return the next output of the SplitMix64 generator */
+
+static uint64_t splitmix64(uint64_t *state) {
+
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+
+
+
+/* Return a uniform value in (0, 1) that depends only on the seed and idx */
+
+static double uniform(uint64_t seed, uint64_t idx) {
+
+    uint64_t state = seed ^ (idx * 0xd1b54a32d192ed03ULL);
+
+    return ((splitmix64(&state) >> 11) + 0.5) / 9007199254740992.0;
+}
+
+
+
+
+static void batch_gfun(const double *x, double *y, int len, int dim) {
+
+    int j;
+    int k;
+
+    for (k = 0; k < len; k++) {
+	y[k] = 1;
+	for (j = 0; j < dim; j++) {
+	    y[k] *= (fabs((4 * x[(k * dim) + j]) - 2) + j + 1) / (j + 2);
+	}
+    }
+}
+
+
+static void batch_gauss(const double *x, double *y, int len, int dim) {
+
+    double sum;
+    double t;
+    int j;
+    int k;
+
+    for (k = 0; k < len; k++) {
+	sum = 0;
+	for (j = 0; j < dim; j++) {
+	    t = GAUSS_WIDTH * (x[(k * dim) + j] - 0.5);
+	    sum += t * t;
+	}
+	y[k] = exp(-sum);
+    }
+}
+
+
+static void batch_oscill(const double *x, double *y, int len, int dim) {
+
+    double sum;
+    int j;
+    int k;
+
+    for (k = 0; k < len; k++) {
+	sum = 2 * M_PI * OSC_PHASE;
+	for (j = 0; j < dim; j++) {
+	    sum += x[(k * dim) + j];
+	}
+	y[k] = cos(sum);
+    }
+}
+
+
+static double exact_gfun(int dim) {
+    return 1;
+}
+
+
+// Each factor integrates to sqrt(pi) erf(w / 2) / w
+static double exact_gauss(int dim) {
+    return pow(sqrt(M_PI) * erf(GAUSS_WIDTH / 2) / GAUSS_WIDTH, dim);
+}
+
+
+// The real part of exp(i 2 pi 0.3) ((exp(i) - 1) / i)^dim
+static double exact_oscill(int dim) {
+    return creal(cexp(I * 2 * M_PI * OSC_PHASE) * cpow((cexp(I) - 1) / I, dim));
+}
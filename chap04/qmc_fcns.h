@@ -0,0 +1,49 @@
+
+#include <stdint.h>
+
+#define QMC_MAX_DIM  16   // largest dimension with Sobol direction numbers
+#define QMC_BITS     32   // bits of each coordinate of a Sobol point
+#define QMC_BATCH   256   // number of points evaluated per batch
+
+#define QMC_SOBOL   0     // scrambled Sobol points
+#define QMC_MC      1     // pseudo-random points
+#define QMC_TENSOR  2     // tensor product of 1-D midpoint rules
+
+/* Write f(x_k) to y[k] for k = 0, ..., len - 1, where x_k is the point x[k *
+ * dim], ..., x[(k * dim) + dim - 1] of the unit cube
+ */
+typedef void (*qmc_batch_fcn)(const double *x, double *y, int len, int dim);
+
+/* An integrand over the dim-dimensional unit cube along with the exact value
+ * of its integral as a function of dim
+ */
+typedef struct {
+    const char *name;
+    const char *desc;
+    qmc_batch_fcn batch;
+    double (*exact)(int dim);
+} qmc_integrand;
+
+/* The generator matrices of a randomized Sobol sequence, stored as the
+ * direction numbers of each dimension after a random linear scrambling,
+ * together with a random digital shift
+ */
+typedef struct {
+    int dim;
+    uint32_t v[QMC_MAX_DIM][QMC_BITS];
+    uint32_t shift[QMC_MAX_DIM];
+} sobol_gen;
+
+const qmc_integrand *find_qmc_integrand(const char *name);
+
+void print_qmc_integrands(void);
+
+int find_qmc_method(const char *method);
+
+void init_sobol(sobol_gen *gen, int dim, uint64_t seed);
+
+void sobol_points(const sobol_gen *gen, uint32_t first, int len, double *x);
+
+void qmc_integrate(const qmc_integrand *f, int method, int dim, long long npoints,
+		   int nreps, uint64_t seed, int rank, int size,
+		   double *mean, double *stderror, long long *nevals);
@@ -0,0 +1,117 @@
+/* Extends the quadrature programs of exercises 4.11 and 4.12 to integrals over
+ * the d-dimensional unit cube.  A tensor product of 1-D rules with k points per
+ * dimension needs k^d function evaluations, so its cost grows exponentially
+ * with d, whereas the error of a quasi-Monte Carlo rule with N points of a
+ * low-discrepancy sequence shrinks roughly like (log N)^d / N.
+ */
+
+/* Accepts an argument "f" for the name of the integrand (default "gfun"), "d"
+ * for the dimension (default 8, at most QMC_MAX_DIM), "n" for the number of
+ * points per replica (default 2^16), "r" for the number of independently
+ * randomized replicas (default 8), "m" for the point set, which is one of
+ * "sobol" (the default), "mc", or "tensor", and "s" for the seed of the
+ * randomization.  The spread of the replica estimates gives the standard error
+ * of their mean.
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include "parse_n.h"
+#include "qmc_fcns.h"
+
+#define DEFAULT_DIM       8
+#define DEFAULT_NPOINTS  65536
+#define DEFAULT_NREPS     8
+#define MAX_NPOINTS      4294967295LL  // Sobol points are indexed by 32 bits
+
+
+int main(int argc, char *argv[]) {
+
+    int rank;
+    int size;
+
+    const qmc_integrand *f;      // the integrand
+    const char *fcn_name;        // name of the integrand
+    const char *method_name;     // name of the point set
+    int method;                  // QMC_* constant of the point set
+    int dim;                     // dimension of the unit cube
+    long long npoints;           // number of points per replica
+    int nreps;                   // number of replicas
+    unsigned long long seed;     // seed of the randomization
+
+    double mean;                 // mean of the replica estimates
+    double stderror;             // standard error of the mean
+    double exact;                // exact value of the integral
+    long long nevals;            // number of function evaluations
+    double elapsed;              // wall-clock time of the integration
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+    // Get the number of the processes
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    // Get the rank of the process
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* Default values of the parameters.  If an argument is given as an option
+     * then its value is written to the corresponding variable in
+     * parse_qmc_args.
+     */
+    fcn_name = "gfun";
+    dim = DEFAULT_DIM;
+    npoints = DEFAULT_NPOINTS;
+    nreps = DEFAULT_NREPS;
+    method_name = "sobol";
+    seed = 1;
+    parse_qmc_args(argc, argv, &fcn_name, &dim, &npoints, &nreps, &method_name, &seed);
+
+    if ((f = find_qmc_integrand(fcn_name)) == NULL) {
+	if (rank == 0) {
+	    fprintf(stderr, "Invalid integrand \"%s\"\n", fcn_name);
+	    print_qmc_integrands();
+	}
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    if ((method = find_qmc_method(method_name)) < 0) {
+	fprintf(stderr, "Invalid method \"%s\"\n", method_name);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    if (dim > QMC_MAX_DIM) {
+	fprintf(stderr, "the dimension must be <= %d\n", QMC_MAX_DIM);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    if (npoints > MAX_NPOINTS) {
+	fprintf(stderr, "n must be <= %lld\n", MAX_NPOINTS);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    elapsed = -MPI_Wtime();
+
+    qmc_integrate(f, method, dim, npoints, nreps, seed, rank, size,
+		  &mean, &stderror, &nevals);
+
+    elapsed += MPI_Wtime();
+
+    // Finalize the MPI environment
+    MPI_Finalize();
+
+    // Print result
+    if (rank == 0) {
+	exact = f->exact(dim);
+	printf("\n"
+	       "The value from -m %-6s in %2d dimensions is:  %.14f\n",
+	       method_name, dim, mean);
+	if (stderror >= 0) {
+	    printf("The standard error of %2d replicas is:         %.3e\n",
+		   nreps, stderror);
+	}
+	printf("The exact value of the integral is:           %.14f\n"
+	       "The actual error is:                          %.3e\n"
+	       "The number of function evaluations is:        %lld\n"
+	       "The elapsed time is:                          %.3f s\n"
+	       "\n",
+	       exact, mean - exact, nevals, elapsed);
+    }
+
+    return 0;
+}
@@ -0,0 +1,556 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "quad_adapt.h"
+
+#define TAG_WORK      1      // tag for messages carrying intervals
+#define MIN_WIDTH     1e-12  // relative width below which we stop splitting
+#define INTERVAL_LEN  7      // number of doubles in an interval
+
+#define FALSE  0
+#define TRUE   1
+
+/* A subinterval [a, b] with its integral estimate val and error estimate err.
+ * fa, fm, and fb are the function values at a, (a + b) / 2, and b; they are only
+ * used by Simpson's rule, which reuses them when the interval is split.  The
+ * struct is sent between processes as INTERVAL_LEN doubles.
+ */
+typedef struct {
+    double a;
+    double b;
+    double val;
+    double err;
+    double fa;
+    double fm;
+    double fb;
+} interval;
+
+/* The local state of the adaptive integration.  The pending intervals are kept
+ * in a binary heap ordered by error estimate, so that the interval that is
+ * refined next is always the one contributing the most error.
+ */
+typedef struct {
+    const integrand_info *info;
+    int rule;
+    double tol;
+    interval *heap;
+    int len;
+    int cap;
+    double pending_err;   // sum of the errors of the pending intervals
+    double accepted_val;  // sum of the integrals of the accepted intervals
+    double accepted_cmp;  // compensation term for accepted_val
+    double accepted_err;  // sum of the errors of the accepted intervals
+    long long nlimited;   // number of intervals accepted only for their width
+    long long nevals;     // number of function evaluations done locally
+} adapt_state;
+
+/* The progress of one process, as exchanged at every check.  Stored as doubles
+ * so that the exchange is a single MPI_Iallgather.
+ */
+typedef struct {
+    double npending;
+    double pending_err;
+    double accepted_err;
+    double nevals;
+} adapt_progress;
+
+static void eval_interval(adapt_state *state, interval *iv);
+static void add_interval(adapt_state *state, interval *iv);
+static void heap_push(adapt_state *state, interval *iv);
+static void heap_pop(adapt_state *state, interval *iv);
+static void refine_worst(adapt_state *state);
+static void rebalance(adapt_state *state, adapt_progress *all, int rank, int size);
+
+
+
+
+/* Return the rule of the adaptive method with the given name, i.e. RULE_SIMPSON
+ * for "adapt-simpson" and RULE_GK15 for "adapt-gk", or -1 if method is not the
+ * name of an adaptive method
+ */
+
+int find_adapt_rule(const char *method) {
+
+    if (!strcmp(method, "adapt-simpson")) {
+	return RULE_SIMPSON;
+    }
+    else if (!strcmp(method, "adapt-gk")) {
+	return RULE_GK15;
+    }
+
+    return -1;
+}
+
+
+
+
+/* Integrate the integrand described by info over its interval with an adaptive
+ * rule, stopping once the estimated error is below tol or after about
+ * max_evals function evaluations.  The results are only valid on rank 0.
+ * Return TRUE on rank 0 if the tolerance was met, and otherwise print a warning
+ * and return FALSE.  The tolerance is not met if the evaluations run out, or if
+ * an interval narrower than MIN_WIDTH times the whole interval has to be
+ * accepted with an error above its share of tol, as happens near a
+ * singularity; in either case *errest still holds the estimated error.
+ *
+ * Each process starts with the rank-th of size equal pieces of the interval.
+ * A subinterval is accepted once its error estimate is below its share of tol,
+ * i.e. tol * (b - a) / (ubnd - lbnd), and otherwise it is split in two.  Since
+ * the integrand may be smooth in one piece and steep in another, some processes
+ * run out of work long before others.
+ *
+ * To even this out, every process periodically posts its progress with a
+ * nonblocking MPI_Iallgather and continues refining until the exchange has
+ * completed.  Every process then knows the global error and the amount of
+ * pending work of every other process.  If the error is below tol, or there is
+ * no pending work anywhere, then every process stops.  Otherwise each idle
+ * process is paired with one of the most loaded processes, which hands over
+ * half of its pending intervals (the ones with the largest errors).  Since all
+ * of the processes make the same decisions from the same data, no further
+ * coordination is needed, and no interval is ever in transit while progress is
+ * being measured.
+ */
+
+int adapt_quad(const integrand_info *info, int rule, double tol,
+	       double max_evals, int rank, int size,
+	       double *result, double *errest, long long *nevals) {
+
+    adapt_state state;
+    adapt_progress mine;   // local progress as of the last exchange
+    adapt_progress *all;   // progress of every process
+    MPI_Request req;
+    interval iv;
+    double total_err;
+    double total_evals;
+    double total_pending;
+    double local[4];
+    double global[4];
+    long long nlimited;    // number of intervals accepted only for their width
+    int converged;
+    int done;
+    int flag;
+    int k;
+
+    state.info = info;
+    state.rule = rule;
+    state.tol = tol;
+    state.len = 0;
+    state.cap = 1024;
+    state.heap = malloc(state.cap * sizeof(interval));
+    all = malloc(size * sizeof(adapt_progress));
+    if ((state.heap == NULL) || (all == NULL)) {
+	fprintf(stderr, "error allocating memory for adaptive quadrature\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    state.pending_err = 0;
+    state.accepted_val = 0;
+    state.accepted_cmp = 0;
+    state.accepted_err = 0;
+    state.nlimited = 0;
+    state.nevals = 0;
+
+    // Evaluate the local share of the interval
+    iv.a = info->lbnd + (rank * (info->ubnd - info->lbnd) / size);
+    iv.b = info->lbnd + ((rank + 1) * (info->ubnd - info->lbnd) / size);
+    if (rule == RULE_SIMPSON) {
+	iv.fa = info->fcn(iv.a);
+	iv.fm = info->fcn((iv.a + iv.b) / 2);
+	iv.fb = info->fcn(iv.b);
+	state.nevals += 3;
+    }
+    eval_interval(&state, &iv);
+    add_interval(&state, &iv);
+
+    req = MPI_REQUEST_NULL;
+    done = 0;
+    while (!done) {
+
+	// Refine the worst intervals
+	for (k = 0; (k < ADAPT_BATCH) && state.len; k++) {
+	    refine_worst(&state);
+	}
+
+	// case: no exchange in progress; post the current progress
+	if (req == MPI_REQUEST_NULL) {
+	    mine.npending = state.len;
+	    mine.pending_err = state.pending_err;
+	    mine.accepted_err = state.accepted_err;
+	    mine.nevals = state.nevals;
+	    MPI_Iallgather(&mine, 4, MPI_DOUBLE, all, 4, MPI_DOUBLE, MPI_COMM_WORLD, &req);
+	}
+
+	/* Keep working while the exchange is in progress; with nothing left to do
+	 * we may as well block
+	 */
+	if (state.len) {
+	    MPI_Test(&req, &flag, MPI_STATUS_IGNORE);
+	}
+	else {
+	    MPI_Wait(&req, MPI_STATUS_IGNORE);
+	    flag = 1;
+	}
+
+	// case: exchange completed; decide whether to stop or rebalance
+	if (flag) {
+	    total_err = 0;
+	    total_evals = 0;
+	    total_pending = 0;
+	    for (k = 0; k < size; k++) {
+		total_err += all[k].pending_err + all[k].accepted_err;
+		total_evals += all[k].nevals;
+		total_pending += all[k].npending;
+	    }
+
+	    if ((total_pending == 0) || (total_err <= tol) || (total_evals >= max_evals)) {
+		done = 1;
+	    }
+	    else {
+		rebalance(&state, all, rank, size);
+	    }
+	}
+    }
+
+    // Whatever is still pending contributes its current estimate
+    while (state.len) {
+	heap_pop(&state, &iv);
+	state.accepted_val += iv.val;
+	state.accepted_err += iv.err;
+    }
+
+    local[0] = state.accepted_val + state.accepted_cmp;
+    local[1] = state.accepted_err;
+    local[2] = state.nevals;
+    local[3] = state.nlimited;
+    MPI_Reduce(local, global, 4, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    *result = global[0];
+    *errest = global[1];
+    *nevals = (long long) global[2];
+    nlimited = (long long) global[3];
+
+    converged = TRUE;
+    if ((rank == 0) && (nlimited || (*errest > tol))) {
+	fprintf(stderr, "Warning: tolerance %.3e not reached (estimated error %.3e)\n",
+		tol, *errest);
+	if (nlimited) {
+	    fprintf(stderr, "%lld intervals were too narrow to split but not within "
+		    "their share of the tolerance\n", nlimited);
+	}
+	converged = FALSE;
+    }
+
+    free(state.heap);
+    free(all);
+
+    return converged;
+}
+
+
+
+
+/* Compute the integral and error estimates of *iv with the rule of state.  For
+ * Simpson's rule the values fa, fm, and fb must already be filled in.
+ */
+
+static void eval_interval(adapt_state *state, interval *iv) {
+
+    /* Nodes and weights of the 15-point Kronrod rule on [-1, 1] (only the
+     * nonnegative nodes are given, in decreasing order), and the weights of the
+     * embedded 7-point Gauss rule at the odd-indexed nodes
+     */
+    static const double xgk[8] = {
+	0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+	0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+	0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+	0.207784955007898467600689403773245, 0.000000000000000000000000000000000
+    };
+    static const double wgk[8] = {
+	0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+	0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+	0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+	0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+    };
+    static const double wg[4] = {
+	0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+	0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+    };
+
+    double half;    // half of the interval length
+    double center;
+    double flm;     // function value at the left quarter point
+    double frm;     // function value at the right quarter point
+    double s1;      // Simpson's rule on the whole interval
+    double s2;      // Simpson's rule on each half
+    double kronrod;
+    double gauss;
+    double f1;
+    double f2;
+    int k;
+
+    if (state->rule == RULE_SIMPSON) {
+	flm = state->info->fcn((3 * iv->a + iv->b) / 4);
+	frm = state->info->fcn((iv->a + 3 * iv->b) / 4);
+	state->nevals += 2;
+
+	s1 = (iv->b - iv->a) * (iv->fa + 4 * iv->fm + iv->fb) / 6;
+	s2 = (iv->b - iv->a) * (iv->fa + 4 * flm + 2 * iv->fm + 4 * frm + iv->fb) / 12;
+
+	// Richardson extrapolation of the two estimates
+	iv->val = s2 + ((s2 - s1) / 15);
+	iv->err = fabs(s2 - s1) / 15;
+    }
+    else {
+	half = (iv->b - iv->a) / 2;
+	center = (iv->a + iv->b) / 2;
+
+	f1 = state->info->fcn(center);
+	kronrod = wgk[7] * f1;
+	gauss = wg[3] * f1;
+	for (k = 0; k < 7; k++) {
+	    f1 = state->info->fcn(center - half * xgk[k]);
+	    f2 = state->info->fcn(center + half * xgk[k]);
+	    kronrod += wgk[k] * (f1 + f2);
+	    if (k % 2) {
+		gauss += wg[k / 2] * (f1 + f2);
+	    }
+	}
+	state->nevals += 15;
+
+	iv->val = kronrod * half;
+	iv->err = fabs((kronrod - gauss) * half);
+    }
+}
+
+
+
+
+/* Either accept the evaluated interval *iv or add it to the pending intervals.
+ * An interval that is too narrow to split is accepted whatever its error, but
+ * is counted in nlimited if its error is above its share of tol.
+ */
+
+static void add_interval(adapt_state *state, interval *iv) {
+
+    double width = state->info->ubnd - state->info->lbnd;
+    double y;
+    double t;
+    int within_tol;
+
+    within_tol = (iv->err <= state->tol * ((iv->b - iv->a) / width));
+    if (within_tol || ((iv->b - iv->a) < MIN_WIDTH * width)) {
+
+	if (!within_tol) {
+	    state->nlimited++;
+	}
+
+	// Compensated (Kahan) summation of the accepted integrals
+	y = iv->val - state->accepted_cmp;
+	t = state->accepted_val + y;
+	state->accepted_cmp = (t - state->accepted_val) - y;
+	state->accepted_val = t;
+	state->accepted_err += iv->err;
+    }
+    else {
+	heap_push(state, iv);
+    }
+}
+
+
+
+
+/* Split the pending interval with the largest error in half and evaluate the
+ * two halves
+ */
+
+static void refine_worst(adapt_state *state) {
+
+    interval iv;
+    interval left;
+    interval right;
+    double mid;
+
+    heap_pop(state, &iv);
+    mid = (iv.a + iv.b) / 2;
+
+    left.a = iv.a;
+    left.b = mid;
+    right.a = mid;
+    right.b = iv.b;
+
+    // The three Simpson points of each half were found when evaluating iv
+    if (state->rule == RULE_SIMPSON) {
+	left.fa = iv.fa;
+	left.fb = iv.fm;
+	left.fm = state->info->fcn((left.a + left.b) / 2);
+	right.fa = iv.fm;
+	right.fb = iv.fb;
+	right.fm = state->info->fcn((right.a + right.b) / 2);
+	state->nevals += 2;
+    }
+
+    eval_interval(state, &left);
+    eval_interval(state, &right);
+    add_interval(state, &left);
+    add_interval(state, &right);
+}
+
+
+
+
+/* Pair each idle process (as of the last exchange) with one of the processes
+ * with the most pending intervals, and move half of the intervals of the latter
+ * to the former
+ */
+
+static void rebalance(adapt_state *state, adapt_progress *all, int rank, int size) {
+
+    int *idle;     // the idle processes, in increasing rank order
+    int *donors;   // the processes with pending work, most work first
+    int nidle;
+    int ndonors;
+    int npairs;
+    int partner;
+    int nsend;
+    int count;
+    interval *buf;
+    MPI_Status status;
+    int tmp;
+    int i;
+    int k;
+
+    idle = malloc(size * sizeof(int));
+    donors = malloc(size * sizeof(int));
+    if ((idle == NULL) || (donors == NULL)) {
+	fprintf(stderr, "error allocating memory for adaptive quadrature\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    nidle = 0;
+    ndonors = 0;
+    for (k = 0; k < size; k++) {
+	if (all[k].npending == 0) {
+	    idle[nidle++] = k;
+	}
+	else if (all[k].npending >= 2) {
+	    // Insertion sort by decreasing amount of pending work
+	    for (i = ndonors++; (i > 0) && (all[donors[i - 1]].npending < all[k].npending); i--) {
+		donors[i] = donors[i - 1];
+	    }
+	    donors[i] = k;
+	}
+    }
+
+    npairs = (nidle < ndonors) ? nidle : ndonors;
+    for (k = 0; k < npairs; k++) {
+
+	// case: this process hands over work
+	if (donors[k] == rank) {
+	    partner = idle[k];
+	    nsend = state->len / 2;
+	    buf = malloc((nsend + 1) * sizeof(interval));
+	    if (buf == NULL) {
+		fprintf(stderr, "error allocating memory for adaptive quadrature\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	    }
+	    for (i = 0; i < nsend; i++) {
+		heap_pop(state, &buf[i]);
+	    }
+	    MPI_Send(buf, nsend * INTERVAL_LEN, MPI_DOUBLE, partner, TAG_WORK, MPI_COMM_WORLD);
+	    free(buf);
+	}
+	// case: this process receives work
+	else if (idle[k] == rank) {
+	    partner = donors[k];
+	    MPI_Probe(partner, TAG_WORK, MPI_COMM_WORLD, &status);
+	    MPI_Get_count(&status, MPI_DOUBLE, &count);
+	    tmp = count / INTERVAL_LEN;
+	    buf = malloc((tmp + 1) * sizeof(interval));
+	    if (buf == NULL) {
+		fprintf(stderr, "error allocating memory for adaptive quadrature\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	    }
+	    MPI_Recv(buf, count, MPI_DOUBLE, partner, TAG_WORK, MPI_COMM_WORLD,
+		     MPI_STATUS_IGNORE);
+	    for (i = 0; i < tmp; i++) {
+		heap_push(state, &buf[i]);
+	    }
+	    free(buf);
+	}
+    }
+
+    free(idle);
+    free(donors);
+}
+
+
+
+
+/* Add *iv to the heap of pending intervals */
+
+static void heap_push(adapt_state *state, interval *iv) {
+
+    interval tmp;
+    int k;
+
+    // case: out of room; double the size of the heap
+    if (state->len == state->cap) {
+	state->cap *= 2;
+	state->heap = realloc(state->heap, state->cap * sizeof(interval));
+	if (state->heap == NULL) {
+	    fprintf(stderr, "error allocating memory for adaptive quadrature\n");
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	}
+    }
+
+    // Sift the new interval up to its place
+    k = state->len++;
+    state->heap[k] = *iv;
+    while (k && (state->heap[(k - 1) / 2].err < state->heap[k].err)) {
+	tmp = state->heap[k];
+	state->heap[k] = state->heap[(k - 1) / 2];
+	state->heap[(k - 1) / 2] = tmp;
+	k = (k - 1) / 2;
+    }
+
+    state->pending_err += iv->err;
+}
+
+
+
+
+/* Remove the pending interval with the largest error and store it in *iv */
+
+static void heap_pop(adapt_state *state, interval *iv) {
+
+    interval tmp;
+    int child;
+    int k;
+
+    *iv = state->heap[0];
+    state->heap[0] = state->heap[--state->len];
+
+    // Sift the moved interval down to its place
+    k = 0;
+    while ((child = (2 * k) + 1) < state->len) {
+	if ((child + 1 < state->len) && (state->heap[child + 1].err > state->heap[child].err)) {
+	    child++;
+	}
+	if (state->heap[k].err >= state->heap[child].err) {
+	    break;
+	}
+	tmp = state->heap[k];
+	state->heap[k] = state->heap[child];
+	state->heap[child] = tmp;
+	k = child;
+    }
+
+    state->pending_err -= iv->err;
+    // case: nothing left; reset to avoid accumulating rounding error
+    if (!state->len) {
+	state->pending_err = 0;
+    }
+}
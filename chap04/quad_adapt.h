@@ -0,0 +1,14 @@
+
+#include "quad_fcns.h"
+
+#define RULE_SIMPSON  0  // adaptive Simpson's rule
+#define RULE_GK15     1  // 7-point Gauss / 15-point Kronrod pair
+
+#define ADAPT_BATCH        32  // intervals refined between progress checks
+#define ADAPT_MAX_EVALS  1e8   // default limit on the function evaluations
+
+int find_adapt_rule(const char *method);
+
+int adapt_quad(const integrand_info *info, int rule, double tol,
+	       double max_evals, int rank, int size,
+	       double *result, double *errest, long long *nevals);
@@ -0,0 +1,403 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "mpi_helper.h"
+#include "quad_engines.h"
+
+#define ROMBERG_MIN_LEVEL  4  // don't trust agreement at coarser levels
+#define TS_MIN_LEVEL       3  // don't trust agreement at coarser levels
+
+#define FALSE  0
+#define TRUE   1
+
+static void romberg(const integrand_info *info, double tol, int rank, int size,
+		    double *result, double *errest, long long *nevals);
+static void gauss_panels(const integrand_info *info, double tol, int rank, int size,
+			 double *result, double *errest, long long *nevals);
+static void tanh_sinh(const integrand_info *info, double tol, int rank, int size,
+		      double *result, double *errest, long long *nevals);
+static void gauss_legendre_nodes(int order, double *nodes, double *weights);
+static double ts_sum(const integrand_info *info, double t0, double step,
+		     long long first, long long count, long long *nevals);
+
+
+
+
+/* Return the engine with the given name, i.e. ENGINE_ROMBERG for "romberg",
+ * ENGINE_GAUSS for "gauss", and ENGINE_TANH_SINH for "tanh-sinh", or -1 if
+ * method is not the name of an engine
+ */
+
+int find_engine(const char *method) {
+
+    if (!strcmp(method, "romberg")) {
+	return ENGINE_ROMBERG;
+    }
+    else if (!strcmp(method, "gauss")) {
+	return ENGINE_GAUSS;
+    }
+    else if (!strcmp(method, "tanh-sinh")) {
+	return ENGINE_TANH_SINH;
+    }
+
+    return -1;
+}
+
+
+
+
+/* Integrate the integrand described by info over its interval with the given
+ * engine, refining until two successive estimates agree to within tol.  Every
+ * engine refines in levels; the points of a level are split into size nearly
+ * even contiguous blocks, and the sums of the blocks are combined with
+ * MPI_Allreduce so that every process takes the same decision to stop.  The
+ * number of function evaluations of all of the processes is written to
+ * *nevals.
+ *
+ * Return TRUE if the tolerance was met.  Every engine stops early only once
+ * its error estimate is within tol, so if the estimate is still above tol then
+ * the finest level was reached without converging; rank 0 then prints a
+ * warning and FALSE is returned, and *nevals is not the number of evaluations
+ * needed to reach tol.
+ */
+
+int engine_quad(const integrand_info *info, int engine, double tol, int rank,
+		int size, double *result, double *errest, long long *nevals) {
+
+    switch (engine) {
+    case ENGINE_ROMBERG:
+	romberg(info, tol, rank, size, result, errest, nevals);
+	break;
+    case ENGINE_GAUSS:
+	gauss_panels(info, tol, rank, size, result, errest, nevals);
+	break;
+    case ENGINE_TANH_SINH:
+	tanh_sinh(info, tol, rank, size, result, errest, nevals);
+	break;
+    default:
+	fprintf(stderr, "invalid quadrature engine %d\n", engine);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+
+    if (*errest <= tol) {
+	return TRUE;
+    }
+
+    if (rank == 0) {
+	fprintf(stderr, "Warning: tolerance %.3e not reached (estimated error %.3e) "
+		"at the finest level, after %lld function evaluations\n",
+		tol, *errest, *nevals);
+    }
+    return FALSE;
+}
+
+
+
+
+/* Romberg integration.  Level j is the trapezoid rule with 2^j intervals,
+ *
+ *     T_j = T_{j-1} / 2 + h_j \sum_{i=1}^{2^{j-1}} f(a + (2i - 1) h_j),
+ *
+ * where h_j = (b - a) / 2^j, so that each level only evaluates the 2^{j-1} new
+ * midpoints and reuses every earlier function value through T_{j-1}.  The
+ * trapezoid errors are a series in even powers of h_j, and the row
+ *
+ *     R_{j,k} = R_{j,k-1} + (R_{j,k-1} - R_{j-1,k-1}) / (4^k - 1)
+ *
+ * eliminates them one power at a time by Richardson extrapolation.  The new
+ * midpoints of a level are summed in vectorized batches by sum_fcn.
+ */
+
+static void romberg(const integrand_info *info, double tol, int rank, int size,
+		    double *result, double *errest, long long *nevals) {
+
+    double prev[ROMBERG_MAX_LEVEL + 1];  // the previous row of the table
+    double curr[ROMBERG_MAX_LEVEL + 1];  // the current row of the table
+    double local[2];    // local sum of f and number of evaluations
+    double global[2];   // global sum of f and number of evaluations
+    double h;           // the current step
+    double err;
+    long long nmid;     // number of new midpoints of the current level
+    long long total;    // total number of evaluations
+    int j;
+    int k;
+
+    // Level 0: the endpoints, which rank 0 evaluates
+    h = info->ubnd - info->lbnd;
+    local[0] = (rank == 0) ? info->fcn(info->lbnd) + info->fcn(info->ubnd) : 0;
+    local[1] = (rank == 0) ? 2 : 0;
+    MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    prev[0] = h * global[0] / 2;
+    total = global[1];
+
+    err = INFINITY;
+    for (j = 1; j <= ROMBERG_MAX_LEVEL; j++) {
+
+	h /= 2;
+	nmid = 1LL << (j - 1);
+
+	// The midpoints a + (2i - 1) h for i in the local block of 1, ..., nmid
+	local[0] = sum_fcn(info, info->lbnd - h, 2 * h, BLOCK_LOW(rank, size, nmid) + 1,
+			   BLOCK_SIZE(rank, size, nmid));
+	local[1] = BLOCK_SIZE(rank, size, nmid);
+	MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	total += global[1];
+
+	// Extrapolate
+	curr[0] = (prev[0] / 2) + (h * global[0]);
+	for (k = 1; k <= j; k++) {
+	    curr[k] = curr[k - 1] + ((curr[k - 1] - prev[k - 1]) / (pow(4, k) - 1));
+	}
+
+	err = fabs(curr[j] - prev[j - 1]);
+	memcpy(prev, curr, (j + 1) * sizeof(double));
+	if ((j >= ROMBERG_MIN_LEVEL) && (err <= tol)) {
+	    break;
+	}
+    }
+
+    *result = prev[(j <= ROMBERG_MAX_LEVEL) ? j : ROMBERG_MAX_LEVEL];
+    *errest = err;
+    *nevals = total;
+}
+
+
+
+
+/* Composite Gauss-Legendre quadrature with GAUSS_ORDER nodes per panel.  The
+ * number of panels starts at one per process and doubles until two successive
+ * estimates agree to within tol.  Since the nodes of successive levels are not
+ * nested every level is evaluated from scratch, but the rule is exact for
+ * polynomials of degree 2 * GAUSS_ORDER - 1, so that few levels are needed for
+ * smooth integrands.
+ */
+
+static void gauss_panels(const integrand_info *info, double tol, int rank, int size,
+			 double *result, double *errest, long long *nevals) {
+
+    double nodes[GAUSS_ORDER];
+    double weights[GAUSS_ORDER];
+    double x[GAUSS_ORDER];     // the nodes of the current panel
+    double y[GAUSS_ORDER];     // the function values at x
+    double local;
+    double estimate;
+    double prev;
+    double err;
+    double width;              // width of each panel
+    double panel;
+    long long npanels;
+    long long low;             // first panel of this process
+    long long high;            // one past the last panel of this process
+    long long total;           // total number of evaluations
+    long long p;
+    int k;
+
+    gauss_legendre_nodes(GAUSS_ORDER, nodes, weights);
+
+    prev = 0;
+    err = INFINITY;
+    total = 0;
+    for (npanels = size; ; npanels *= 2) {
+
+	width = (info->ubnd - info->lbnd) / npanels;
+	low = BLOCK_LOW(rank, size, npanels);
+	high = BLOCK_LOW(rank + 1, size, npanels);
+
+	// Map the nodes onto each local panel and evaluate them as a batch
+	local = 0;
+	for (p = low; p < high; p++) {
+	    for (k = 0; k < GAUSS_ORDER; k++) {
+		x[k] = info->lbnd + (width * (p + ((1 + nodes[k]) / 2)));
+	    }
+	    info->batch(x, y, GAUSS_ORDER);
+	    panel = 0;
+	    for (k = 0; k < GAUSS_ORDER; k++) {
+		panel += weights[k] * y[k];
+	    }
+	    local += panel * width / 2;
+	}
+	MPI_Allreduce(&local, &estimate, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	total += npanels * GAUSS_ORDER;
+
+	// case: not the first level; compare with the previous one
+	if (npanels > size) {
+	    err = fabs(estimate - prev);
+	    if ((err <= tol) || (2 * npanels > GAUSS_MAX_PANELS)) {
+		break;
+	    }
+	}
+	prev = estimate;
+    }
+
+    *result = estimate;
+    *errest = err;
+    *nevals = total;
+}
+
+
+
+
+/* Tanh-sinh quadrature.  The substitution x = c + r tanh((pi / 2) sinh(t)),
+ * where c and r are the center and half-width of the interval, maps the real
+ * line onto the interval with a Jacobian that decays double exponentially as
+ * |t| grows.  The trapezoid rule in t therefore converges very quickly, even
+ * if the integrand has an integrable singularity at an endpoint.  Level j uses
+ * the step h_j = 2^-j on [-TS_TMAX, TS_TMAX] and, as with Romberg, only
+ * evaluates the points at the odd multiples of h_j.  Each level roughly doubles
+ * the number of correct digits, so the difference of two successive levels is a
+ * generous estimate of the error of the finer one.
+ */
+
+static void tanh_sinh(const integrand_info *info, double tol, int rank, int size,
+		      double *result, double *errest, long long *nevals) {
+
+    double local[2];    // local sum of w f and number of evaluations
+    double global[2];   // global sum of w f and number of evaluations
+    double estimate;
+    double prev;
+    double err;
+    double h;           // the current step
+    long long npoints;  // number of new points of the current level
+    long long half;     // number of new points on each side of t = 0
+    long long evals;    // number of local evaluations of the current level
+    long long total;    // total number of evaluations
+    int j;
+
+    // Level 0: the points t = -half, ..., half
+    h = 1;
+    half = (long long) TS_TMAX;
+    npoints = (2 * half) + 1;
+    local[0] = ts_sum(info, -half, h, BLOCK_LOW(rank, size, npoints),
+		      BLOCK_SIZE(rank, size, npoints), &evals);
+    local[1] = evals;
+    MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    estimate = h * global[0];
+    total = global[1];
+
+    err = INFINITY;
+    for (j = 1; j <= TS_MAX_LEVEL; j++) {
+
+	h /= 2;
+
+	// The odd multiples of h in [-TS_TMAX, TS_TMAX]: -(2 half - 1) h, ...
+	half = (long long) (((TS_TMAX / h) + 1) / 2);
+	npoints = 2 * half;
+	local[0] = ts_sum(info, -((2 * half) - 1) * h, 2 * h, BLOCK_LOW(rank, size, npoints),
+			  BLOCK_SIZE(rank, size, npoints), &evals);
+	local[1] = evals;
+	MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	total += global[1];
+
+	prev = estimate;
+	estimate = (prev / 2) + (h * global[0]);
+	err = fabs(estimate - prev);
+	if ((j >= TS_MIN_LEVEL) && (err <= tol)) {
+	    break;
+	}
+    }
+
+    *result = estimate;
+    *errest = err;
+    *nevals = total;
+}
+
+
+
+
+/* Return the sum of w(t) f(x(t)) over t = t0 + (k * step) for k = first, ...,
+ * first + count - 1, where x(t) is the tanh-sinh substitution and w(t) its
+ * Jacobian, and write the number of function evaluations to *nevals.
+ *
+ * To keep the abscissae accurate near the endpoints they are found from their
+ * distance to the nearer endpoint, (b - a) / (exp(2 |u|) + 1) with u = (pi / 2)
+ * sinh(t), rather than from tanh(u), which rounds to +/-1.  Points that still
+ * round onto an endpoint are skipped, since their weight is negligible and the
+ * integrand may be infinite there.
+ */
+
+static double ts_sum(const integrand_info *info, double t0, double step,
+		     long long first, long long count, long long *nevals) {
+
+    double x[QUAD_BLOCK];   // abscissae of the current block
+    double w[QUAD_BLOCK];   // weights of the current block
+    double y[QUAD_BLOCK];   // integrand values of the current block
+    double width;
+    double sum;
+    double t;
+    double u;
+    double dist;            // distance of x to the nearer endpoint
+    int len;
+    int k;
+
+    width = info->ubnd - info->lbnd;
+    sum = 0;
+    *nevals = 0;
+    while (count > 0) {
+
+	len = 0;
+	for (k = 0; (k < QUAD_BLOCK) && (k < count); k++) {
+	    t = t0 + ((first + k) * step);
+	    u = M_PI_2 * sinh(t);
+	    dist = width / (exp(2 * fabs(u)) + 1);
+	    x[len] = (t < 0) ? info->lbnd + dist : info->ubnd - dist;
+	    if ((x[len] > info->lbnd) && (x[len] < info->ubnd)) {
+		w[len++] = (width / 2) * M_PI_2 * cosh(t) / (cosh(u) * cosh(u));
+	    }
+	}
+	info->batch(x, y, len);
+
+	for (k = 0; k < len; k++) {
+	    sum += w[k] * y[k];
+	}
+
+	*nevals += len;
+	first += QUAD_BLOCK;
+	count -= QUAD_BLOCK;
+    }
+
+    return sum;
+}
+
+
+
+
+/* Compute the nodes on [-1, 1] and the weights of the Gauss-Legendre rule with
+ * order nodes, by Newton's method on the Legendre polynomial P_order starting
+ * from the usual asymptotic approximations of its roots
+ */
+
+static void gauss_legendre_nodes(int order, double *nodes, double *weights) {
+
+    double x;
+    double dx;
+    double p0;   // P_{k-1}(x) in the recurrence
+    double p1;   // P_k(x) in the recurrence
+    double p2;   // P_{k+1}(x) in the recurrence
+    double dp;   // P_{order}'(x)
+    int i;
+    int k;
+
+    for (i = 0; i < order; i++) {
+	x = cos(M_PI * (i + 0.75) / (order + 0.5));
+	do {
+	    // Evaluate P_order(x) by the three-term recurrence
+	    p0 = 1;
+	    p1 = x;
+	    for (k = 2; k <= order; k++) {
+		p2 = (((2 * k - 1) * x * p1) - ((k - 1) * p0)) / k;
+		p0 = p1;
+		p1 = p2;
+	    }
+	    // Here p1 = P_order(x) and p0 = P_{order-1}(x)
+	    dp = order * ((x * p1) - p0) / ((x * x) - 1);
+	    dx = p1 / dp;
+	    x -= dx;
+	} while (fabs(dx) > 1e-15);
+
+	nodes[i] = x;
+	weights[i] = 2 / ((1 - (x * x)) * dp * dp);
+    }
+}
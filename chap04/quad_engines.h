@@ -0,0 +1,17 @@
+
+#include "quad_fcns.h"
+
+#define ENGINE_ROMBERG    0  // Romberg extrapolation of the trapezoid rule
+#define ENGINE_GAUSS      1  // composite Gauss-Legendre panels
+#define ENGINE_TANH_SINH  2  // tanh-sinh (double exponential) quadrature
+
+#define ROMBERG_MAX_LEVEL   28  // at most 2^28 + 1 function evaluations
+#define GAUSS_ORDER         16  // number of Gauss-Legendre nodes per panel
+#define GAUSS_MAX_PANELS  1e7   // largest number of panels tried
+#define TS_MAX_LEVEL        16  // smallest step of tanh-sinh is 2^-16
+#define TS_TMAX            4.0  // tanh-sinh sums over t in [-TS_TMAX, TS_TMAX]
+
+int find_engine(const char *method);
+
+int engine_quad(const integrand_info *info, int engine, double tol, int rank,
+		int size, double *result, double *errest, long long *nevals);
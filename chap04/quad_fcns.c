@@ -0,0 +1,208 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "quad_fcns.h"
+
+#define PEAK_LOC   0.3   // location of the peak of the "peak" integrand
+#define PEAK_EPS   1e-3  // half-width of the peak of the "peak" integrand
+
+/* Define a function batch of type integrand_batch that applies the scalar
+ * integrand fcn to each element.  The loop is a plain map so that, with the
+ * scalar function inlined, the compiler can vectorize it.
+ */
+#define DEFINE_BATCH(batch, fcn)					\
+    static void batch(const double *x, double *y, int len) {		\
+	int k;								\
+	_Pragma("omp simd")						\
+	for (k = 0; k < len; k++) {					\
+	    y[k] = fcn(x[k]);						\
+	}								\
+    }
+
+static inline double eval_pi(double x);
+static inline double eval_peak(double x);
+static inline double eval_sqrt(double x);
+static inline double eval_invsqrt(double x);
+static inline double eval_log(double x);
+
+static void batch_pi(const double *x, double *y, int len);
+static void batch_peak(const double *x, double *y, int len);
+static void batch_sqrt(const double *x, double *y, int len);
+static void batch_invsqrt(const double *x, double *y, int len);
+static void batch_log(const double *x, double *y, int len);
+
+/* The integrands that can be selected by name.  The first is the integrand of
+ * the exercises; the remaining ones have a sharp peak or an endpoint
+ * singularity, and are meant to exercise the adaptive and higher-order rules.
+ * Integrands that are infinite at an endpoint return 0 there so that the
+ * rules which evaluate the endpoints stay finite.
+ */
+static const integrand_info integrands[] = {
+    { "pi",      "4 / (1 + x^2) on [0, 1]",
+      eval_pi,      batch_pi,      0, 1, M_PI },
+    { "peak",    "1 / ((x - 0.3)^2 + 1e-6) on [0, 1]",
+      eval_peak,    batch_peak,    0, 1,
+      (atan((1 - PEAK_LOC) / PEAK_EPS) + atan(PEAK_LOC / PEAK_EPS)) / PEAK_EPS },
+    { "sqrt",    "sqrt(x) on [0, 1]",
+      eval_sqrt,    batch_sqrt,    0, 1, 2.0 / 3.0 },
+    { "invsqrt", "1 / sqrt(x) on [0, 1]",
+      eval_invsqrt, batch_invsqrt, 0, 1, 2 },
+    { "log",     "-log(x) on [0, 1]",
+      eval_log,     batch_log,     0, 1, 1 }
+};
+
+
+
+
+/* Return the integrand with the given name, or NULL if there is none */
+
+const integrand_info *find_integrand(const char *name) {
+
+    int k;
+
+    for (k = 0; k < (int) (sizeof(integrands) / sizeof(integrand_info)); k++) {
+	if (!strcmp(name, integrands[k].name)) {
+	    return &integrands[k];
+	}
+    }
+
+    return NULL;
+}
+
+
+
+
+/* Print the name and description of each integrand to stderr */
+
+void print_integrands(void) {
+
+    int k;
+
+    fprintf(stderr, "The available integrands are:\n");
+    for (k = 0; k < (int) (sizeof(integrands) / sizeof(integrand_info)); k++) {
+	fprintf(stderr, "    %-8s  %s\n", integrands[k].name, integrands[k].desc);
+    }
+}
+
+
+
+
+/* Return the sum of f(x0 + (k * step)) over k = first, ..., first + count - 1.
+ *
+ * The abscissae are generated and evaluated QUAD_BLOCK at a time through the
+ * batch form of the integrand, so that the evaluation loop vectorizes and the
+ * block never leaves the L1 cache.  Each block is summed into QUAD_LANES
+ * independent partial sums, which both lets the additions vectorize and breaks
+ * the dependency chain of a single accumulator.  The block sums are then
+ * combined pairwise: partial[level] holds the sum of 2^level consecutive
+ * blocks, and adding a block works like incrementing a binary counter.  The
+ * rounding error thus grows like log(count) instead of count, which matters
+ * when count is in the billions.
+ */
+
+double sum_fcn(const integrand_info *info, double x0, double step,
+	       long long first, long long count) {
+
+    double x[QUAD_BLOCK];       // abscissae of the current block
+    double y[QUAD_BLOCK];       // integrand values of the current block
+    double lanes[QUAD_LANES];   // partial sums of the current block
+    double partial[63];         // pairwise partial sums of the blocks
+    double blocksum;
+    long long nblocks;          // number of blocks summed so far
+    int level;
+    int len;
+    int j;
+    int k;
+
+    nblocks = 0;
+    while (count > 0) {
+
+	len = (count < QUAD_BLOCK) ? count : QUAD_BLOCK;
+
+	// Evaluate the block
+#pragma omp simd
+	for (k = 0; k < len; k++) {
+	    x[k] = x0 + ((double) (first + k) * step);
+	}
+	info->batch(x, y, len);
+
+	// Sum the block into the lanes, and the lanes pairwise
+	for (j = 0; j < QUAD_LANES; j++) {
+	    lanes[j] = 0;
+	}
+	for (k = 0; k + QUAD_LANES <= len; k += QUAD_LANES) {
+#pragma omp simd
+	    for (j = 0; j < QUAD_LANES; j++) {
+		lanes[j] += y[k + j];
+	    }
+	}
+	for (j = 0; k < len; j++, k++) {
+	    lanes[j] += y[k];
+	}
+	for (j = QUAD_LANES / 2; j > 0; j /= 2) {
+	    for (k = 0; k < j; k++) {
+		lanes[k] += lanes[k + j];
+	    }
+	}
+	blocksum = lanes[0];
+
+	// Merge the block sum with the partial sums of equally many blocks
+	for (level = 0; nblocks & (1LL << level); level++) {
+	    blocksum += partial[level];
+	}
+	partial[level] = blocksum;
+	nblocks++;
+
+	first += len;
+	count -= len;
+    }
+
+    // Add up the partial sums that remain, smallest first
+    blocksum = 0;
+    for (level = 0; level < 63; level++) {
+	if (nblocks & (1LL << level)) {
+	    blocksum += partial[level];
+	}
+    }
+
+    return blocksum;
+}
+
+
+
+
+static inline double eval_pi(double x) {
+    return 4 / (1 + (x * x));
+}
+
+
+static inline double eval_peak(double x) {
+    return 1 / (((x - PEAK_LOC) * (x - PEAK_LOC)) + (PEAK_EPS * PEAK_EPS));
+}
+
+
+static inline double eval_sqrt(double x) {
+    return sqrt(x);
+}
+
+
+static inline double eval_invsqrt(double x) {
+    return (x > 0) ? 1 / sqrt(x) : 0;
+}
+
+
+static inline double eval_log(double x) {
+    return (x > 0) ? -log(x) : 0;
+}
+
+
+
+
+DEFINE_BATCH(batch_pi, eval_pi)
+DEFINE_BATCH(batch_peak, eval_peak)
+DEFINE_BATCH(batch_sqrt, eval_sqrt)
+DEFINE_BATCH(batch_invsqrt, eval_invsqrt)
+DEFINE_BATCH(batch_log, eval_log)
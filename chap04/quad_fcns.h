@@ -0,0 +1,33 @@
+
+#ifndef QUAD_FCNS_H
+#define QUAD_FCNS_H
+
+#define QUAD_BLOCK  256  // number of abscissae evaluated per batch
+#define QUAD_LANES  8    // number of independent partial sums per batch
+
+typedef double (*integrand_fcn)(double x);
+
+// Write f(x[k]) to y[k] for k = 0, ..., len - 1
+typedef void (*integrand_batch)(const double *x, double *y, int len);
+
+/* An integrand along with the interval to integrate it over and the exact
+ * value of the integral
+ */
+typedef struct {
+    const char *name;
+    const char *desc;
+    integrand_fcn fcn;
+    integrand_batch batch;
+    double lbnd;
+    double ubnd;
+    double exact;
+} integrand_info;
+
+const integrand_info *find_integrand(const char *name);
+
+void print_integrands(void);
+
+double sum_fcn(const integrand_info *info, double x0, double step,
+	       long long first, long long count);
+
+#endif
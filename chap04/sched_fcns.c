@@ -0,0 +1,224 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sched_fcns.h"
+#include "prime_num_fcns.h"
+
+#define FALSE    0
+#define TRUE     1
+
+static long long cost_boundary(int r, int size, long long maxnum, double alpha);
+
+
+
+
+/* Return the SCHED_* constant of the schedule with the given name, or -1 if
+ * there is none
+ */
+
+int find_schedule(const char *name) {
+
+    if (!strcmp(name, "block")) {
+	return SCHED_BLOCK;
+    }
+    else if (!strcmp(name, "cost")) {
+	return SCHED_COST;
+    }
+    else if (!strcmp(name, "dynamic")) {
+	return SCHED_DYNAMIC;
+    }
+
+    return -1;
+}
+
+
+
+
+/* The same as find_process_set_ll, but with the sets chosen so that checking
+ * each of them costs about the same when checking w costs w^alpha: the rank-th
+ * set ends at the b with integral_0^b w^alpha dw = (rank + 1) / size of the
+ * integral up to maxnum, i.e. b = maxnum ((rank + 1) / size)^{1 / (1 + alpha)}.
+ * For trial division alpha = 1/2, so the sets shrink as the values grow, and
+ * for alpha = 0 the sets are those of find_process_set_ll.
+ */
+
+void find_process_set_cost(int rank, int size, long long maxnum, double alpha,
+			   long long *startnum, long long *stopnum) {
+
+    *startnum = cost_boundary(rank, size, maxnum, alpha) + 1;
+    *stopnum = cost_boundary(rank + 1, size, maxnum, alpha);
+
+    // case: startnum is an even number.  Advance to first odd number in set
+    if (((*startnum) % 2) == 0) {
+	(*startnum)++;
+    }
+}
+
+
+
+
+/* Set up *ws to hand out the odd numbers in {1, ..., maxnum} to the processes
+ * of MPI_COMM_WORLD with the schedule kind.  alpha is used by SCHED_COST and
+ * chunk by SCHED_DYNAMIC.  Must be called by every process.
+ */
+
+void init_schedule(work_schedule *ws, int kind, long long maxnum, double alpha,
+		   long long chunk) {
+
+    memset(ws, 0, sizeof(work_schedule));
+    ws->kind = kind;
+    ws->maxnum = maxnum;
+    ws->alpha = alpha;
+    // A chunk longer than the whole set would only risk overflow below
+    ws->chunk = (chunk < (maxnum + 1) / 2) ? chunk : ((maxnum + 1) / 2) + 1;
+    ws->nchunks = (((maxnum + 1) / 2) + ws->chunk - 1) / ws->chunk;
+    MPI_Comm_rank(MPI_COMM_WORLD, &ws->rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ws->size);
+
+    if (kind == SCHED_DYNAMIC) {
+	MPI_Win_allocate(ws->rank ? 0 : sizeof(long long), sizeof(long long),
+			 MPI_INFO_NULL, MPI_COMM_WORLD, &ws->counter, &ws->win);
+	if (!ws->rank) {
+	    *ws->counter = 0;
+	}
+	// Make sure that the counter is set before anyone takes a chunk
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Win_lock_all(0, ws->win);
+    }
+}
+
+
+
+
+/* Write the next range of this process to *startnum and *stopnum and start
+ * timing it, or return FALSE if there are none left.  As with
+ * find_process_set_ll, *startnum is odd and the range may be empty.
+ *
+ * In the dynamic schedule chunk number c covers the odd numbers 2 c chunk + 1,
+ * ..., 2 (c + 1) chunk - 1, and the chunks are handed out from the last one
+ * down, so that the costliest chunks are taken first and the cheap ones fill
+ * in the gaps at the end.
+ */
+
+int next_range(work_schedule *ws, long long *startnum, long long *stopnum) {
+
+    long long one = 1;
+    long long taken;  // number of chunks taken before this one
+    long long c;
+
+    if (ws->kind == SCHED_DYNAMIC) {
+	MPI_Fetch_and_op(&one, &taken, MPI_LONG_LONG, 0, 0, MPI_SUM, ws->win);
+	MPI_Win_flush(0, ws->win);
+	if (taken >= ws->nchunks) {
+	    return FALSE;
+	}
+	c = ws->nchunks - 1 - taken;
+	*startnum = (2 * c * ws->chunk) + 1;
+	*stopnum = (2 * (c + 1) * ws->chunk < ws->maxnum) ? 2 * (c + 1) * ws->chunk : ws->maxnum;
+    }
+    // case: static schedule; there is a single range
+    else if (ws->nranges) {
+	return FALSE;
+    }
+    else if (ws->kind == SCHED_COST) {
+	find_process_set_cost(ws->rank, ws->size, ws->maxnum, ws->alpha,
+			      startnum, stopnum);
+    }
+    else {
+	find_process_set_ll(ws->rank, ws->size, ws->maxnum, startnum, stopnum);
+    }
+
+    ws->nranges++;
+    ws->range_start = MPI_Wtime();
+    return TRUE;
+}
+
+
+
+
+/* Add the time since the start of the current range to the busy time */
+
+void end_range(work_schedule *ws) {
+    ws->busy += MPI_Wtime() - ws->range_start;
+}
+
+
+
+
+/* Release the chunk counter of the dynamic schedule.  Must be called by every
+ * process.
+ */
+
+void free_schedule(work_schedule *ws) {
+    if (ws->kind == SCHED_DYNAMIC) {
+	MPI_Win_unlock_all(ws->win);
+	MPI_Win_free(&ws->win);
+    }
+}
+
+
+
+
+/* Gather the busy time and the number of ranges of every process on process 0
+ * and print them, along with the ratio of the largest busy time to the mean,
+ * which is 1 for a perfectly balanced schedule
+ */
+
+void print_busy_times(const work_schedule *ws) {
+
+    double *busy = NULL;
+    long long *nranges = NULL;
+    double sum;
+    double max;
+    int r;
+
+    if (!ws->rank) {
+	busy = malloc(ws->size * sizeof(double));
+	nranges = malloc(ws->size * sizeof(long long));
+	if ((busy == NULL) || (nranges == NULL)) {
+	    fprintf(stderr, "error allocating memory for the busy times\n");
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	}
+    }
+    MPI_Gather(&ws->busy, 1, MPI_DOUBLE, busy, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Gather(&ws->nranges, 1, MPI_LONG_LONG, nranges, 1, MPI_LONG_LONG, 0,
+	       MPI_COMM_WORLD);
+
+    if (!ws->rank) {
+	printf("Busy time of each process:\n"
+	       "\n"
+	       "    rank    ranges   seconds\n");
+	sum = max = 0;
+	for (r = 0; r < ws->size; r++) {
+	    printf("    %4d  %8lld  %8.3f\n", r, nranges[r], busy[r]);
+	    sum += busy[r];
+	    max = (busy[r] > max) ? busy[r] : max;
+	}
+	printf("\n"
+	       "max / mean busy time:  %.3f\n"
+	       "\n",
+	       (sum > 0) ? max * ws->size / sum : 1.0);
+	free(busy);
+	free(nranges);
+    }
+}
+
+
+
+
+/* Return the r-th boundary of find_process_set_cost, with the 0-th at 0 and the
+ * size-th at maxnum
+ */
+
+static long long cost_boundary(int r, int size, long long maxnum, double alpha) {
+
+    if (r >= size) {
+	return maxnum;
+    }
+
+    return (long long) (maxnum * powl((long double) r / size, 1.0L / (1 + alpha)));
+}
@@ -0,0 +1,45 @@
+
+#include <mpi.h>
+
+#define SCHED_BLOCK    0  // contiguous blocks of equal length
+#define SCHED_COST     1  // contiguous blocks of equal estimated cost
+#define SCHED_DYNAMIC  2  // chunks handed out on demand, largest values first
+
+#define DEFAULT_CHUNK  16384  // odd numbers per chunk in the dynamic schedule
+
+/* The assignment of the odd numbers in {1, ..., maxnum} to the processes.  In
+ * the static schedules each process gets a single range, and in the dynamic
+ * schedule the processes take chunks of chunk odd numbers in turn from a shared
+ * counter on process 0, until there are none left.  busy accumulates the
+ * seconds that the process spends working on its ranges (see end_range).
+ */
+typedef struct {
+    int kind;
+    int rank;
+    int size;
+    long long maxnum;
+    double alpha;          // the cost of checking w is taken to be w^alpha
+    long long chunk;
+    long long nchunks;
+    long long nranges;     // number of ranges handed out to this process
+    double busy;
+    double range_start;    // MPI_Wtime at the start of the current range
+    MPI_Win win;           // window holding the chunk counter
+    long long *counter;
+} work_schedule;
+
+int find_schedule(const char *name);
+
+void find_process_set_cost(int rank, int size, long long maxnum, double alpha,
+			   long long *startnum, long long *stopnum);
+
+void init_schedule(work_schedule *ws, int kind, long long maxnum, double alpha,
+		   long long chunk);
+
+int next_range(work_schedule *ws, long long *startnum, long long *stopnum);
+
+void end_range(work_schedule *ws);
+
+void free_schedule(work_schedule *ws);
+
+void print_busy_times(const work_schedule *ws);
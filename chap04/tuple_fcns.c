@@ -0,0 +1,208 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "segsieve_helper.h"
+#include "tuple_fcns.h"
+
+#define FALSE    0
+#define TRUE     1
+
+
+
+
+/* Parse a comma-separated list of offsets such as "0,2,6" into *pattern.  The
+ * offsets are shifted so that the first is 0, and must be strictly increasing
+ * and even, since a pattern with an odd offset can only match tuples that
+ * include 2.
+ */
+
+void parse_tuple_pattern(const char *str, tuple_pattern *pattern) {
+
+    const char *curr;  // start of the offset currently being read
+    char *endptr;      // point to next char after int read
+    long val;
+    int k;
+
+    // To distinguish success / failure after a call to strtol
+    errno = 0;
+
+    pattern->len = 0;
+    pattern->count = 0;
+    curr = str;
+    while (1) {
+
+	val = strtol(curr, &endptr, 10);
+	if ((endptr == curr) || ((*endptr != ',') && (*endptr != '\0'))) {
+	    fprintf(stderr, "Invalid offset list \"%s\"\n", str);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	else if ((errno != 0) || (val < 0) || (val > 1000000)) {
+	    fprintf(stderr, "Offsets in \"%s\" must be between 0 and 1000000\n", str);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	else if (pattern->len == MAX_TUPLE_LEN) {
+	    fprintf(stderr, "Patterns can have at most %d offsets\n", MAX_TUPLE_LEN);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	pattern->offsets[pattern->len++] = (int) val;
+
+	if (*endptr == '\0') {
+	    break;
+	}
+	curr = endptr + 1;
+    }
+
+    // Shift the offsets so that the pattern starts at 0
+    for (k = pattern->len - 1; k >= 0; k--) {
+	pattern->offsets[k] -= pattern->offsets[0];
+    }
+
+    for (k = 1; k < pattern->len; k++) {
+	if (pattern->offsets[k] <= pattern->offsets[k - 1]) {
+	    fprintf(stderr, "Offsets in \"%s\" must be strictly increasing\n", str);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	else if (pattern->offsets[k] % 2) {
+	    fprintf(stderr, "Offsets in \"%s\" must all be even\n", str);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+    }
+}
+
+
+
+
+/* Return the largest offset among the patterns, i.e. how far past its smallest
+ * member a tuple can extend
+ */
+
+int tuple_span(const tuple_pattern *patterns, int npatterns) {
+
+    int span;
+    int k;
+
+    span = 0;
+    for (k = 0; k < npatterns; k++) {
+	if (patterns[k].offsets[patterns[k].len - 1] > span) {
+	    span = patterns[k].offsets[patterns[k].len - 1];
+	}
+    }
+
+    return span;
+}
+
+
+
+
+/* Return TRUE if the pattern is admissible, i.e. for every prime q there is a
+ * residue class mod q not hit by any offset.  Only primes q <= len need to be
+ * checked.  A pattern that is not admissible, such as {0, 2, 4}, has only
+ * finitely many matches since one of its members is always divisible by q.
+ */
+
+int check_admissible(const tuple_pattern *pattern) {
+
+    static const int small_primes[] = { 2, 3, 5, 7, 11, 13 };
+    char hit[13];  // whether each residue class is hit by an offset
+    int nhit;
+    int q;
+    int i;
+    int k;
+
+    for (i = 0; i < (int) (sizeof(small_primes) / sizeof(int)); i++) {
+
+	q = small_primes[i];
+	if (q > pattern->len) {
+	    break;
+	}
+
+	for (k = 0; k < q; k++) {
+	    hit[k] = FALSE;
+	}
+	nhit = 0;
+	for (k = 0; k < pattern->len; k++) {
+	    if (!hit[pattern->offsets[k] % q]) {
+		hit[pattern->offsets[k] % q] = TRUE;
+		nhit++;
+	    }
+	}
+
+	if (nhit == q) {
+	    return FALSE;
+	}
+    }
+
+    return TRUE;
+}
+
+
+
+
+/* Write the pattern to buf in the form "{0, 2, 6}".  buf must have room for
+ * PATTERN_STRLEN characters.
+ */
+
+void sprint_tuple_pattern(char *buf, const tuple_pattern *pattern) {
+
+    int pos;
+    int k;
+
+    pos = sprintf(buf, "{");
+    for (k = 0; k < pattern->len; k++) {
+	pos += sprintf(buf + pos, (k ? ", %d" : "%d"), pattern->offsets[k]);
+    }
+    sprintf(buf + pos, "}");
+}
+
+
+
+
+/* Count the tuples whose smallest member is among the first nown values of a
+ * sieved segment, for each pattern in the tuple_data pointed to by data.
+ *
+ * A tuple starting at bit i requires that bits i + offsets[j] / 2 are all set,
+ * so 64 starting positions at a time are tested by ANDing together the grid
+ * shifted down by each offset.  Members of a tuple that are past the end of the
+ * segment are found in the look-ahead region, which must therefore be at least
+ * as long as half of the largest offset.  Bits past the look-ahead region are
+ * always 0, so tuples that extend past the largest value sieved are not counted.
+ */
+
+void count_tuples_segment(const uint64_t *bits, long long seg_low,
+			  long long nown, long long nbits, void *data) {
+
+    tuple_data *tdata = data;
+    tuple_pattern *pattern;
+    uint64_t word;    // bit i set if a tuple starts at bit (64 * w) + i
+    long long nwords;
+    long long w;
+    int shift;
+    int j;
+    int k;
+
+    nwords = SEG_NWORDS(nown);
+
+    for (k = 0; k < tdata->npatterns; k++) {
+
+	pattern = &tdata->patterns[k];
+
+	for (w = 0; w < nwords; w++) {
+
+	    word = bits[w];
+	    for (j = 1; word && (j < pattern->len); j++) {
+		shift = pattern->offsets[j] / 2;
+		word &= SEG_SHIFTED_WORD(bits, w, shift);
+	    }
+
+	    // case: last word; ignore tuples starting past nown
+	    if (w == nwords - 1) {
+		word &= SEG_TAIL_MASK(nown);
+	    }
+
+	    pattern->count += __builtin_popcountll(word);
+	}
+    }
+}
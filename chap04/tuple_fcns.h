@@ -0,0 +1,34 @@
+
+#include <stdint.h>
+
+#define MAX_TUPLE_LEN   16  // maximum number of offsets in a prime pattern
+#define MAX_NPATTERNS   16  // maximum number of patterns counted in one pass
+#define PATTERN_STRLEN 256  // buffer length for sprint_tuple_pattern
+
+/* A prime pattern (k-tuple) is given by its offsets from the smallest member,
+ * e.g. twin primes are {0, 2}, cousin primes {0, 4}, sexy primes {0, 6}, and
+ * prime quadruplets {0, 2, 6, 8}.  count tracks the number of values w such
+ * that every w + offsets[i] is prime.
+ */
+typedef struct {
+    int len;
+    int offsets[MAX_TUPLE_LEN];
+    long long count;
+} tuple_pattern;
+
+/* Data passed through sieve_range to count_tuples_segment */
+typedef struct {
+    tuple_pattern *patterns;
+    int npatterns;
+} tuple_data;
+
+void parse_tuple_pattern(const char *str, tuple_pattern *pattern);
+
+int tuple_span(const tuple_pattern *patterns, int npatterns);
+
+int check_admissible(const tuple_pattern *pattern);
+
+void sprint_tuple_pattern(char *buf, const tuple_pattern *pattern);
+
+void count_tuples_segment(const uint64_t *bits, long long seg_low,
+			  long long nown, long long nbits, void *data);
@@ -0,0 +1,216 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "segsieve_helper.h"
+#include "aggregate_helper.h"
+
+#define POW10_19  10000000000000000000ULL
+
+static void compensated_add(double *sum, double *comp, double x);
+static void aggregate_prime(long long p, void *data);
+static void aggregate_reduce(void *invec, void *inoutvec, int *len,
+			     MPI_Datatype *type);
+
+
+
+
+/* Initialize *agg to describe an empty range */
+
+void init_aggregate(prime_aggregate *agg) {
+    memset(agg, 0, sizeof(prime_aggregate));
+}
+
+
+
+
+/* Add the prime p, which must be larger than every prime already in *agg */
+
+void add_prime_aggregate(prime_aggregate *agg, long long p) {
+
+    uint128_t sq = (uint128_t) p * p;
+
+    if (!agg->first) {
+	agg->first = p;
+    }
+    else if (p - agg->last == 2) {
+	agg->ntwins++;
+	compensated_add(&agg->twin, &agg->twin_comp, 1.0 / agg->last);
+	compensated_add(&agg->twin, &agg->twin_comp, 1.0 / p);
+    }
+    agg->last = p;
+    agg->count++;
+
+    agg->sum += p;
+    agg->sum2 += sq;
+    // case: the low 128 bits wrapped around; carry into the high word
+    if (agg->sum2 < sq) {
+	agg->sum2_hi++;
+    }
+    compensated_add(&agg->recip, &agg->recip_comp, 1.0 / p);
+}
+
+
+
+
+/* Add the primes among the values that the segment is responsible for to the
+ * prime_aggregate pointed to by data.  May be passed to sieve_range or
+ * atkin_range.
+ */
+
+void aggregate_segment(const uint64_t *bits, long long seg_low,
+		       long long nown, long long nbits, void *data) {
+    for_each_prime(bits, seg_low, nown, aggregate_prime, data);
+}
+
+
+
+
+/* Write to *result the aggregate of the union of the ranges described by *lo
+ * and *hi, where every value in the range of *lo is below every value in the
+ * range of *hi.  result may be the same as lo or hi.
+ */
+
+void combine_aggregate(const prime_aggregate *lo, const prime_aggregate *hi,
+		       prime_aggregate *result) {
+
+    prime_aggregate comb;
+
+    comb = *lo;
+    if (!hi->first) {
+	*result = comb;
+	return;
+    }
+    if (!lo->first) {
+	*result = *hi;
+	return;
+    }
+
+    // The twin pair, if any, that straddles the two ranges
+    if (hi->first - lo->last == 2) {
+	comb.ntwins++;
+	compensated_add(&comb.twin, &comb.twin_comp, 1.0 / lo->last);
+	compensated_add(&comb.twin, &comb.twin_comp, 1.0 / hi->first);
+    }
+    comb.last = hi->last;
+    comb.count += hi->count;
+    comb.ntwins += hi->ntwins;
+
+    comb.sum += hi->sum;
+    comb.sum2 += hi->sum2;
+    comb.sum2_hi += hi->sum2_hi + (comb.sum2 < hi->sum2);
+    compensated_add(&comb.recip, &comb.recip_comp, hi->recip);
+    comb.recip_comp += hi->recip_comp;
+    compensated_add(&comb.twin, &comb.twin_comp, hi->twin);
+    comb.twin_comp += hi->twin_comp;
+
+    *result = comb;
+}
+
+
+
+
+/* Create the MPI type of a prime_aggregate and a reduction operator that
+ * combines the aggregates of consecutive ranges.  The operator is not
+ * commutative since the twin pairs between ranges depend on their order, so
+ * the ranges must be in rank order.  Both should be freed by the caller.
+ */
+
+void create_aggregate_op(MPI_Datatype *type, MPI_Op *op) {
+    MPI_Type_contiguous(sizeof(prime_aggregate), MPI_BYTE, type);
+    MPI_Type_commit(type);
+    MPI_Op_create(aggregate_reduce, 0, op);
+}
+
+
+
+
+/* Write the 192-bit number hi * 2^128 + lo to buf in decimal.  buf must have
+ * room for U192_STRLEN characters.
+ *
+ * The number is divided by 10^19 repeatedly, from the most significant word
+ * down, and the remainders are the groups of 19 digits from the right.
+ */
+
+void sprint_u192(char *buf, uint64_t hi, uint128_t lo) {
+
+    uint64_t words[3];   // most significant first
+    uint64_t groups[4];  // groups of 19 digits, least significant first
+    uint128_t rem;
+    int ngroups;
+    int len;
+    int i;
+
+    words[0] = hi;
+    words[1] = (uint64_t) (lo >> 64);
+    words[2] = (uint64_t) lo;
+
+    ngroups = 0;
+    do {
+	rem = 0;
+	for (i = 0; i < 3; i++) {
+	    rem = (rem << 64) | words[i];
+	    words[i] = (uint64_t) (rem / POW10_19);
+	    rem %= POW10_19;
+	}
+	groups[ngroups++] = (uint64_t) rem;
+    } while (words[0] || words[1] || words[2]);
+
+    len = sprintf(buf, "%llu", (unsigned long long) groups[ngroups - 1]);
+    for (i = ngroups - 2; i >= 0; i--) {
+	len += sprintf(buf + len, "%019llu", (unsigned long long) groups[i]);
+    }
+}
+
+
+
+
+/* Add x to the compensated sum *sum + *comp, by Neumaier's variant of Kahan
+ * summation, which also handles terms larger than the running sum
+ */
+
+static void compensated_add(double *sum, double *comp, double x) {
+
+    double t = *sum + x;
+
+    if (((*sum >= 0) ? *sum : -*sum) >= ((x >= 0) ? x : -x)) {
+	*comp += (*sum - t) + x;
+    }
+    else {
+	*comp += (x - t) + *sum;
+    }
+    *sum = t;
+}
+
+
+
+
+/* MPI user function: invec holds the aggregates of ranges below those in
+ * inoutvec
+ */
+
+static void aggregate_reduce(void *invec, void *inoutvec, int *len,
+			     MPI_Datatype *type) {
+
+    prime_aggregate *lo = invec;
+    prime_aggregate *hi = inoutvec;
+    int k;
+
+    for (k = 0; k < *len; k++) {
+	combine_aggregate(&lo[k], &hi[k], &hi[k]);
+    }
+}
+
+
+
+
+/* Add the prime p to the prime_aggregate pointed to by data; the prime_fcn
+ * passed to for_each_prime by aggregate_segment
+ */
+
+static void aggregate_prime(long long p, void *data) {
+    add_prime_aggregate(data, p);
+}
@@ -0,0 +1,42 @@
+#include <mpi.h>
+#include <stdint.h>
+
+#define U192_STRLEN  60  // buffer length for sprint_u192
+
+typedef unsigned __int128 uint128_t;
+
+/* Aggregates of the primes in a range of values, computed without storing the
+ * primes.  A range containing no primes has first == 0.  The sum of squares
+ * needs more than 128 bits for n past about 1e13, so it is kept as the 192-bit
+ * number sum2_hi * 2^128 + sum2.  The reciprocal sums are compensated sums: the
+ * value is sum + comp, where comp collects the rounding errors of the
+ * additions.  The twin reciprocal sum adds 1 / p + 1 / (p + 2) for every pair
+ * of primes p, p + 2 in the range, whose limit is Brun's constant.
+ */
+typedef struct {
+    long long first;
+    long long last;
+    long long count;
+    long long ntwins;
+    uint128_t sum;
+    uint128_t sum2;
+    uint64_t sum2_hi;
+    double recip;
+    double recip_comp;
+    double twin;
+    double twin_comp;
+} prime_aggregate;
+
+void init_aggregate(prime_aggregate *agg);
+
+void add_prime_aggregate(prime_aggregate *agg, long long p);
+
+void aggregate_segment(const uint64_t *bits, long long seg_low,
+		       long long nown, long long nbits, void *data);
+
+void combine_aggregate(const prime_aggregate *lo, const prime_aggregate *hi,
+		       prime_aggregate *result);
+
+void create_aggregate_op(MPI_Datatype *type, MPI_Op *op);
+
+void sprint_u192(char *buf, uint64_t hi, uint128_t lo);
@@ -0,0 +1,226 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "atkin_helper.h"
+
+static void toggle_forms(uint64_t *bits, long long seg_low, long long seg_high);
+static void clear_square_multiples(uint64_t *bits, long long seg_low,
+				   long long nbits, const int *primes, int nprimes);
+static long long ceil_sqrt_ll(long long n);
+
+/* The residues mod 60 for which a value is toggled by each quadratic form.
+ * Every other residue is even, divisible by 3 or 5, or belongs to another form.
+ */
+static const char form1_class[60] = {
+    [1] = 1, [13] = 1, [17] = 1, [29] = 1, [37] = 1, [41] = 1, [49] = 1, [53] = 1
+};
+static const char form2_class[60] = {
+    [7] = 1, [19] = 1, [31] = 1, [43] = 1
+};
+static const char form3_class[60] = {
+    [11] = 1, [23] = 1, [47] = 1, [59] = 1
+};
+
+
+
+
+/* Sieve the odd values in {low, ..., high} with the Sieve of Atkin, a segment
+ * of seg_nbits values at a time, and call fcn after each segment has been
+ * sieved.  The segments have the same bit layout as those of sieve_range, with
+ * no look-ahead region, so the two engines can be used interchangeably.
+ *
+ * Rather than crossing off the multiples of each prime, the Sieve of Atkin
+ * toggles a value once for each solution of one of three binary quadratic
+ * forms, chosen by the value's residue mod 60.  A squarefree value is prime
+ * exactly if it has an odd number of solutions, so the values left set are the
+ * primes and the multiples of squares of primes, and the latter are then
+ * cleared.  The primes 3 and 5 divide 60 and are added by hand.
+ *
+ * Every segment has to loop over all of the x of each form, about 1.6
+ * sqrt(high) of them, whatever its length, so segments are made at least
+ * sqrt(high) odd values long to keep that overhead in proportion.  Unlike the
+ * Sieve of Eratosthenes the memory therefore grows like sqrt(high).
+ *
+ * PRE: primes contains every odd prime up to sqrt(high) in increasing order
+ */
+
+void atkin_range(long long low, long long high, long long seg_nbits,
+		 const int *primes, int nprimes, segment_fcn fcn, void *data) {
+
+    uint64_t *bits;      // bit grid for the current segment
+    long long seg_low;   // lowest odd value in the current segment
+    long long seg_high;  // largest value in the current segment
+    long long nleft;     // number of odd values left in {low, ..., high}
+    long long nbits;     // number of odd values in the current segment
+
+    // Advance to the first odd number in the range
+    if (low < 1) {
+	low = 1;
+    }
+    if (!(low % 2)) {
+	low++;
+    }
+    if (high < low) {
+	return;
+    }
+
+    if (seg_nbits < isqrt_ll(high)) {
+	seg_nbits = isqrt_ll(high);
+    }
+    bits = alloc_segment(seg_nbits);
+
+    seg_low = low;
+    nleft = ((high - low) / 2) + 1;
+    while (nleft > 0) {
+
+	nbits = (nleft < seg_nbits) ? nleft : seg_nbits;
+	seg_high = seg_low + (2 * (nbits - 1));
+	memset(bits, 0, (SEG_NWORDS(nbits) + 1) * sizeof(uint64_t));
+
+	toggle_forms(bits, seg_low, seg_high);
+	clear_square_multiples(bits, seg_low, nbits, primes, nprimes);
+
+	// The primes that divide 60 have no quadratic form
+	if ((seg_low <= 3) && (seg_high >= 3)) {
+	    bits[0] |= (uint64_t) 1 << ((3 - seg_low) / 2);
+	}
+	if ((seg_low <= 5) && (seg_high >= 5)) {
+	    bits[0] |= (uint64_t) 1 << ((5 - seg_low) / 2);
+	}
+
+	fcn(bits, seg_low, nbits, nbits, data);
+
+	seg_low += 2 * nbits;
+	nleft -= nbits;
+    }
+
+    free(bits);
+}
+
+
+
+
+/* Toggle the bit of each odd value v in {seg_low, ..., seg_high} once for every
+ * solution with positive x and y of
+ *
+ *     4x^2 + y^2 = v,        v mod 60 in {1, 13, 17, 29, 37, 41, 49, 53}
+ *     3x^2 + y^2 = v,        v mod 60 in {7, 19, 31, 43}
+ *     3x^2 - y^2 = v, x > y, v mod 60 in {11, 23, 47, 59}
+ *
+ * For each x the range of y whose value falls in the segment is found with
+ * integer square roots, and y then steps by 2 since only odd values are kept:
+ * y must be odd in the first form and of the opposite parity to x in the
+ * others.  The value is updated incrementally from (y + 2)^2 - y^2 = 4y + 4.
+ */
+
+static void toggle_forms(uint64_t *bits, long long seg_low, long long seg_high) {
+
+    long long x;
+    long long y;
+    long long ymax;
+    long long xsq;   // x^2
+    long long v;
+    long long k;
+
+    // 4x^2 + y^2, y odd
+    for (x = 1; 4 * x * x < seg_high; x++) {
+	xsq = 4 * x * x;
+	y = (seg_low > xsq) ? ceil_sqrt_ll(seg_low - xsq) : 1;
+	y += !(y % 2);
+	ymax = isqrt_ll(seg_high - xsq);
+	for (v = xsq + (y * y); y <= ymax; v += (4 * y) + 4, y += 2) {
+	    if (form1_class[v % 60]) {
+		k = (v - seg_low) >> 1;
+		bits[k >> 6] ^= (uint64_t) 1 << (k & 63);
+	    }
+	}
+    }
+
+    // 3x^2 + y^2, x + y odd
+    for (x = 1; 3 * x * x < seg_high; x++) {
+	xsq = 3 * x * x;
+	y = (seg_low > xsq) ? ceil_sqrt_ll(seg_low - xsq) : 1;
+	y += !((x + y) % 2);
+	ymax = isqrt_ll(seg_high - xsq);
+	for (v = xsq + (y * y); y <= ymax; v += (4 * y) + 4, y += 2) {
+	    if (form2_class[v % 60]) {
+		k = (v - seg_low) >> 1;
+		bits[k >> 6] ^= (uint64_t) 1 << (k & 63);
+	    }
+	}
+    }
+
+    /* 3x^2 - y^2, x > y, x + y odd.  The smallest value for a given x is at y =
+     * x - 1, namely 2x^2 + 2x - 1, so x stops once that exceeds the segment.
+     * Here y steps downwards from its largest value.
+     */
+    for (x = 1; (2 * x * x) + (2 * x) - 1 <= seg_high; x++) {
+	xsq = 3 * x * x;
+	if (xsq - 1 < seg_low) {
+	    continue;
+	}
+	ymax = isqrt_ll(xsq - seg_low);
+	if (ymax > x - 1) {
+	    ymax = x - 1;
+	}
+	ymax -= !((x + ymax) % 2);
+	y = (xsq > seg_high) ? ceil_sqrt_ll(xsq - seg_high) : 1;
+	for (v = xsq - (ymax * ymax); ymax >= y; v += (4 * ymax) - 4, ymax -= 2) {
+	    if (form3_class[v % 60]) {
+		k = (v - seg_low) >> 1;
+		bits[k >> 6] ^= (uint64_t) 1 << (k & 63);
+	    }
+	}
+    }
+}
+
+
+
+
+/* Clear the bits of the odd multiples of p^2 in the segment for each prime p >=
+ * 7 with p^2 <= the largest value in the segment.  Together with the parity of
+ * the number of solutions this leaves exactly the primes set.
+ */
+
+static void clear_square_multiples(uint64_t *bits, long long seg_low,
+				   long long nbits, const int *primes, int nprimes) {
+
+    long long seg_high = seg_low + (2 * (nbits - 1));
+    long long sq;      // p^2
+    long long first;   // first odd multiple of p^2 that is >= seg_low
+    long long k;
+    int i;
+
+    for (i = 0; i < nprimes; i++) {
+	sq = (long long) primes[i] * primes[i];
+	if (sq > seg_high) {
+	    break;
+	}
+	if (primes[i] < 7) {
+	    continue;
+	}
+	first = ((seg_low + sq - 1) / sq) * sq;
+	// case: even multiple; the next multiple is odd
+	if (!(first % 2)) {
+	    first += sq;
+	}
+	for (k = (first - seg_low) / 2; k < nbits; k += sq) {
+	    bits[k >> 6] &= ~((uint64_t) 1 << (k & 63));
+	}
+    }
+}
+
+
+
+
+// Return ceil( sqrt(n) ) for n >= 0
+static long long ceil_sqrt_ll(long long n) {
+
+    long long r = isqrt_ll(n);
+
+    return (r * r < n) ? r + 1 : r;
+}
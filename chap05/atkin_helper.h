@@ -0,0 +1,4 @@
+#include "segsieve_helper.h"
+
+void atkin_range(long long low, long long high, long long seg_nbits,
+		 const int *primes, int nprimes, segment_fcn fcn, void *data);
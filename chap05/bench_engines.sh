@@ -0,0 +1,56 @@
+#!/bin/sh
+#
+# Time the prime-counting engines of this chapter at several n and write the
+# results as CSV to standard output:
+#
+#     program,engine,nprocs,n,count,seconds
+#
+# The engines are the segmented Sieve of Eratosthenes and the segmented Sieve
+# of Atkin of sieve_seg, and, for n that fit in an int, the cache-blocked char
+# grid of exer05_08.  Each run is repeated and the fastest time is kept.
+#
+# Usage: ./bench_engines.sh [-p nprocs] [-r repeats] [n ...]
+#
+# The default n are 1e6 to 1e9 by powers of 10.  Set MPIRUN to change how the
+# programs are launched, e.g. MPIRUN="mpirun --oversubscribe".
+
+nprocs=4
+repeats=3
+MPIRUN=${MPIRUN:-mpirun}
+
+while getopts "p:r:" opt; do
+    case $opt in
+	p) nprocs=$OPTARG ;;
+	r) repeats=$OPTARG ;;
+	*) echo "usage: $0 [-p nprocs] [-r repeats] [n ...]" >&2; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+nlist=${*:-"1000000 10000000 100000000 1000000000"}
+
+make -s sieve_seg exer05_08 || exit 1
+
+# Run a program $repeats times and print "count,seconds" for the fastest run
+time_run() {
+    best=""
+    count=""
+    i=0
+    while [ $i -lt "$repeats" ]; do
+	out=$($MPIRUN -np "$nprocs" "$@") || exit 1
+	count=$(echo "$out" | sed -n 's/^\([0-9]*\) primes are less.*/\1/p')
+	secs=$(echo "$out" | sed -n 's/^Total elapsed time: *//p')
+	best=$(awk -v s="$secs" -v b="$best" 'BEGIN { print (b == "" || s < b) ? s : b }')
+	i=$((i + 1))
+    done
+    echo "$count,$best"
+}
+
+echo "program,engine,nprocs,n,count,seconds"
+for n in $nlist; do
+    for engine in erat atkin; do
+	echo "sieve_seg,$engine,$nprocs,$n,$(time_run ./sieve_seg -n "$n" -e "$engine")"
+    done
+    if [ "$n" -le 2147483647 ]; then
+	echo "exer05_08,blocked,$nprocs,$n,$(time_run ./exer05_08 -n "$n")"
+    fi
+done
@@ -0,0 +1,365 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "bigfix_helper.h"
+
+#define LIMB_MASK  0xffffffffULL
+
+typedef unsigned __int128 uint128_t;
+
+static void sum_bigfix(void *invec, void *inoutvec, int *len, MPI_Datatype *type);
+
+
+
+
+/* Return the number of fraction limbs needed to get d correct decimal digits
+ * after the point from a sum of values, each of which is truncated in the last
+ * limb.  Since log2(10) < 3.322, a bit more than 3.322 d bits are needed for
+ * the digits, fewer than 64 bits are lost to the truncation errors of fewer
+ * than 2^64 terms, and another limb is kept as a guard.
+ */
+
+int bigfix_nfrac(int d) {
+
+    long long nbits = ((3322LL * d) / 1000) + 1 + 64 + 32;
+
+    return (nbits + 31) / 32;
+}
+
+
+
+
+/* Allocate an accumulator with nfrac fraction limbs, initialized to 0 */
+
+uint64_t *bigfix_alloc_acc(int nfrac) {
+
+    uint64_t *acc = calloc(nfrac + 1, sizeof(uint64_t));
+
+    if (acc == NULL) {
+	fprintf(stderr, "error allocating memory for a fixed-point number\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    return acc;
+}
+
+
+
+
+/* Add 1 / k, truncated to nfrac fraction limbs, to the accumulator acc.  The
+ * limbs are found by schoolbook long division by the single limb k: the
+ * remainder r < k is shifted up by a limb, and the quotient and remainder of
+ * the division by k are the next limb and the new remainder.  Each limb is
+ * added without propagating the carry, see BIGFIX_LAZY_TERMS.
+ */
+
+void bigfix_add_recip(uint64_t *acc, int nfrac, uint32_t k) {
+
+    uint64_t r;   // current remainder
+    int i;
+
+    // case: k = 1; the value is exactly 1
+    if (k == 1) {
+	acc[0] += 1;
+	return;
+    }
+
+    r = 1;
+    for (i = 1; i <= nfrac; i++) {
+	r <<= 32;
+	acc[i] += r / k;
+	r %= k;
+
+	// case: exact division; the remaining limbs are 0
+	if (r == 0) {
+	    break;
+	}
+    }
+}
+
+
+
+
+/* Propagate the carries of the accumulator acc, so that each fraction limb is
+ * less than 2^32 again
+ */
+
+void bigfix_normalize(uint64_t *acc, int nfrac) {
+
+    int i;
+
+    for (i = nfrac; i > 0; i--) {
+	acc[i - 1] += acc[i] >> 32;
+	acc[i] &= LIMB_MASK;
+    }
+}
+
+
+
+
+/* Write the value of the accumulator acc to the fixed-point number x.  The
+ * integer part is assumed to fit in a limb.
+ */
+
+void bigfix_from_acc(uint32_t *x, const uint64_t *acc, int nfrac) {
+
+    uint64_t carry;
+    int i;
+
+    carry = 0;
+    for (i = nfrac; i >= 0; i--) {
+	carry += acc[i];
+	x[i] = carry & LIMB_MASK;
+	carry >>= 32;
+    }
+}
+
+
+
+
+/* Add y to x */
+
+void bigfix_add(uint32_t *x, const uint32_t *y, int nfrac) {
+
+    uint64_t carry;
+    int i;
+
+    carry = 0;
+    for (i = nfrac; i >= 0; i--) {
+	carry += (uint64_t) x[i] + y[i];
+	x[i] = carry & LIMB_MASK;
+	carry >>= 32;
+    }
+}
+
+
+
+
+/* Subtract y from x */
+
+void bigfix_sub(uint32_t *x, const uint32_t *y, int nfrac) {
+
+    uint64_t borrow;
+    uint64_t diff;
+    int i;
+
+    borrow = 0;
+    for (i = nfrac; i >= 0; i--) {
+	diff = (uint64_t) x[i] - y[i] - borrow;
+	x[i] = diff & LIMB_MASK;
+	borrow = (diff >> 63) & 1;
+    }
+}
+
+
+
+
+/* Replace x by x a / b, truncated.  The product is formed from the least
+ * significant limb up, keeping the part that overflows the integer limb, and is
+ * then divided from the most significant limb down with 128-bit remainders, so
+ * that no precision is lost in between.  The result must be less than 2^32.
+ */
+
+void bigfix_muldiv_u64(uint32_t *x, int nfrac, uint64_t a, uint64_t b) {
+
+    uint128_t carry;
+    uint128_t r;
+    int i;
+
+    carry = 0;
+    for (i = nfrac; i >= 0; i--) {
+	carry += (uint128_t) x[i] * a;
+	x[i] = carry & LIMB_MASK;
+	carry >>= 32;
+    }
+
+    // The overflow, in units of the integer limb, is less than a
+    r = carry % b;
+    for (i = 0; i <= nfrac; i++) {
+	r = (r << 32) | x[i];
+	x[i] = r / b;
+	r %= b;
+    }
+}
+
+
+
+
+/* Write x shifted down by nbits bits, i.e. x / 2^nbits truncated, to dst */
+
+void bigfix_shr(uint32_t *dst, const uint32_t *x, int nfrac, long long nbits) {
+
+    long long nlimbs = nbits / 32;
+    int nrem = nbits % 32;
+    long long src;
+    int i;
+
+    for (i = nfrac; i >= 0; i--) {
+	src = i - nlimbs;
+	if (src < 0) {
+	    dst[i] = 0;
+	}
+	else if (nrem == 0) {
+	    dst[i] = x[src];
+	}
+	else {
+	    dst[i] = (x[src] >> nrem) | ((src > 0) ? x[src - 1] << (32 - nrem) : 0);
+	}
+    }
+}
+
+
+
+
+/* Return whether x is 0 */
+
+int bigfix_is_zero(const uint32_t *x, int nfrac) {
+
+    int i;
+
+    for (i = 0; i <= nfrac; i++) {
+	if (x[i]) {
+	    return 0;
+	}
+    }
+
+    return 1;
+}
+
+
+
+
+/* Write atanh(a / b) for 0 <= a < b to result, by the series
+ *
+ *     atanh(z) = z + z^3 / 3 + z^5 / 5 + ...
+ *
+ * whose terms are found with multiplications and divisions by a, b, and 2i + 1
+ * only.  The series converges quickly when a / b is small, e.g. ln(2) = 2
+ * atanh(1 / 3) gains a digit per term.
+ */
+
+void bigfix_atanh(uint32_t *result, int nfrac, uint64_t a, uint64_t b) {
+
+    uint32_t *power;   // (a / b)^{2i + 1}
+    uint32_t *term;    // (a / b)^{2i + 1} / (2i + 1)
+    long long i;
+
+    power = calloc(nfrac + 1, sizeof(uint32_t));
+    term = malloc((nfrac + 1) * sizeof(uint32_t));
+    if ((power == NULL) || (term == NULL)) {
+	fprintf(stderr, "error allocating memory for a fixed-point number\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    power[0] = 1;
+    bigfix_muldiv_u64(power, nfrac, a, b);
+    memcpy(result, power, (nfrac + 1) * sizeof(uint32_t));
+
+    for (i = 1; ; i++) {
+	bigfix_muldiv_u64(power, nfrac, a, b);
+	bigfix_muldiv_u64(power, nfrac, a, b);
+	if (bigfix_is_zero(power, nfrac)) {
+	    break;
+	}
+	memcpy(term, power, (nfrac + 1) * sizeof(uint32_t));
+	bigfix_muldiv_u64(term, nfrac, 1, (2 * i) + 1);
+	bigfix_add(result, term, nfrac);
+    }
+
+    free(power);
+    free(term);
+}
+
+
+
+
+/* Create the MPI type of a fixed-point number with nfrac fraction limbs and a
+ * reduction operator that adds them.  Both should be freed by the caller.
+ */
+
+void bigfix_create_sum_op(int nfrac, MPI_Datatype *type, MPI_Op *op) {
+
+    MPI_Type_contiguous(nfrac + 1, MPI_UINT32_T, type);
+    MPI_Type_commit(type);
+    MPI_Op_create(sum_bigfix, 1, op);
+}
+
+
+
+
+/* Write x to buf as a decimal number with d digits after the point, truncating
+ * the remaining digits.  buf must have room for d + 12 characters.
+ *
+ * Each pass multiplies the fraction by 10^9 limb by limb, from the least
+ * significant limb up, and the part that overflows the fraction is the next
+ * nine digits.
+ */
+
+void sprint_bigfix(char *buf, const uint32_t *x, int nfrac, int d) {
+
+    uint32_t *frac;   // copy of the fraction, destroyed by the conversion
+    uint64_t carry;
+    char digits[10];
+    int len;
+    int ndig;
+    int i;
+
+    frac = malloc((nfrac + 1) * sizeof(uint32_t));
+    if (frac == NULL) {
+	fprintf(stderr, "error allocating memory for a fixed-point number\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    memcpy(frac, x, (nfrac + 1) * sizeof(uint32_t));
+
+    len = sprintf(buf, "%u", x[0]);
+    if (d > 0) {
+	buf[len++] = '.';
+    }
+
+    while (d > 0) {
+	carry = 0;
+	for (i = nfrac; i > 0; i--) {
+	    carry += (uint64_t) frac[i] * 1000000000ULL;
+	    frac[i] = carry & LIMB_MASK;
+	    carry >>= 32;
+	}
+
+	// The next nine digits, of which we may need fewer
+	sprintf(digits, "%09u", (uint32_t) carry);
+	ndig = (d < 9) ? d : 9;
+	memcpy(buf + len, digits, ndig);
+	len += ndig;
+	d -= ndig;
+    }
+    buf[len] = '\0';
+
+    free(frac);
+}
+
+
+
+
+/* MPI user function: element-wise sum of fixed-point numbers, whose number of
+ * limbs is found from the size of the type
+ */
+
+static void sum_bigfix(void *invec, void *inoutvec, int *len, MPI_Datatype *type) {
+
+    uint32_t *in = invec;
+    uint32_t *inout = inoutvec;
+    int nlimbs;
+    int k;
+
+    MPI_Type_size(*type, &nlimbs);
+    nlimbs /= sizeof(uint32_t);
+
+    for (k = 0; k < *len; k++) {
+	bigfix_add(inout, in, nlimbs - 1);
+	in += nlimbs;
+	inout += nlimbs;
+    }
+}
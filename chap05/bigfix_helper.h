@@ -0,0 +1,48 @@
+
+#include <mpi.h>
+#include <stdint.h>
+
+/* A fixed-point number is stored as nfrac + 1 base 2^32 limbs, most significant
+ * first: limb 0 is the integer part and limbs 1, ..., nfrac are the fraction,
+ * so that the value is \sum_i x[i] 2^{-32 i}.
+ *
+ * Accumulators use 64-bit limbs with the same weights, so that up to
+ * BIGFIX_LAZY_TERMS values of at most one limb each can be added to every limb
+ * before the carries need to be propagated.
+ */
+
+#define BIGFIX_LAZY_TERMS  (1LL << 30)
+
+// Largest denominator supported by bigfix_add_recip
+#define BIGFIX_MAX_DENOM  4294967295LL
+
+/* Fixed-point arithmetic is modulo 2^32 in the integer part, so that negative
+ * intermediate values can be handled in two's complement as long as the final
+ * result is nonnegative
+ */
+
+int bigfix_nfrac(int d);
+
+uint64_t *bigfix_alloc_acc(int nfrac);
+
+void bigfix_add_recip(uint64_t *acc, int nfrac, uint32_t k);
+
+void bigfix_normalize(uint64_t *acc, int nfrac);
+
+void bigfix_from_acc(uint32_t *x, const uint64_t *acc, int nfrac);
+
+void bigfix_add(uint32_t *x, const uint32_t *y, int nfrac);
+
+void bigfix_sub(uint32_t *x, const uint32_t *y, int nfrac);
+
+void bigfix_muldiv_u64(uint32_t *x, int nfrac, uint64_t a, uint64_t b);
+
+void bigfix_shr(uint32_t *dst, const uint32_t *x, int nfrac, long long nbits);
+
+int bigfix_is_zero(const uint32_t *x, int nfrac);
+
+void bigfix_atanh(uint32_t *result, int nfrac, uint64_t a, uint64_t b);
+
+void bigfix_create_sum_op(int nfrac, MPI_Datatype *type, MPI_Op *op);
+
+void sprint_bigfix(char *buf, const uint32_t *x, int nfrac, int d);
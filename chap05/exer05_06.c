@@ -93,7 +93,7 @@ int main(int argc, char *argv[]) {
     nprime_local = count_primes(grid_local, local_setsize);
 
     // Free data
-    free(grid_local);
+    free_grid(grid_local);
     
     // Find the sum of the primes found in each process
     MPI_Reduce(&nprime_local, &nprime_global, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
@@ -38,6 +38,7 @@ int main(int argc, char *argv[]) {
     int local_setsize;  // number of odd values in local set
 
     char *grid_rootn;   // track if odd vals in {1, ..., rootn} have factors
+    MPI_Win rootn_win;  // node-shared window holding grid_rootn
     char *grid_local;   // track if odd vals in local set have factors
 
     int nprime_rootn;   // number of prime numbers in {2, ..., rootn}
@@ -86,16 +87,16 @@ int main(int argc, char *argv[]) {
      */
     local_set_params(rootn + 1, n, rank, size, &local_low, &local_high, &local_setsize);
 
-    /* Allocate memory for prime number grids and set each element in each grid to 
+    /* Allocate memory for the local prime number grid and set each element to
      * not having a factor state
      */
-    initialize_grid(&grid_rootn, rootn_setsize);
     initialize_grid(&grid_local, local_setsize);
 
     /* Walk through prime number grid from {1, ..., rootn} and mark elements
-     * for which a factor is found
+     * for which a factor is found.  The grid is computed once per node, split
+     * among the processes of the node, and shared by all of them.
      */
-    fill_grid_rootn(grid_rootn, rootn, rootn_setsize);
+    fill_grid_rootn_shared(&grid_rootn, rootn, rootn_setsize, &rootn_win);
 
     /* Walk through prime number grid from {local_low, ..., local_high} and mark
      * elements for which a factor is found
@@ -112,8 +113,8 @@ int main(int argc, char *argv[]) {
     nprime_global += nprime_rootn;
 
     // Free data
-    free(grid_local);
-    free(grid_rootn);
+    free_grid(grid_local);
+    MPI_Win_free(&rootn_win);
 
     // Print the number of primes found in the local set
     printf("The number of primes in the set from %d to %d (inclusive) is %d\n"
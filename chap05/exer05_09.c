@@ -22,7 +22,17 @@
  */
 
 /* Accepts an argument n for the set {2, 3, ..., n} in which we search for prime
- * numbers.
+ * numbers, and an argument b for the number of range blocks (default 1).
+ *
+ * With b = 1 this is the functional decomposition of the exercise, in which
+ * every process holds the whole set and so n is limited by the memory of a
+ * single process.  With b > 1 the processes are arranged in a grid of prime
+ * groups by range blocks: the set {rootn + 1, ..., n} is split into b
+ * contiguous blocks, each block is held by about size / b processes, and those
+ * processes split the sieving primes among themselves and OR-reduce their
+ * arrays within the communicator of their block only.  The memory of each
+ * process drops by a factor of b, while each block keeps the communication
+ * pattern of the functional decomposition.
  */
 
 #include <mpi.h>
@@ -32,6 +42,7 @@
 
 #include "sieve_helper.h"
 #include "parse_args.h"
+#include "mpi_helper.h"
 
 
 int main(int argc, char *argv[]) {
@@ -39,6 +50,12 @@ int main(int argc, char *argv[]) {
     int rank;           // process rank
     int size;           // number of processes
 
+    int nblocks;        // number of range blocks
+    int block;          // range block of this process
+    int block_rank;     // rank of this process in the block communicator
+    int block_size;     // number of processes in the block
+    MPI_Comm block_comm;  // communicator of the processes of the block
+
     int n;              // gives the set {2, 3, ..., n} to search for primes
     int rootn;          // floor( sqrt(n) )
     int rootn_setsize;  // number of odd values in {1, ..., rootn}
@@ -46,12 +63,17 @@ int main(int argc, char *argv[]) {
     int local_low;      // lowest odd value in local set
     int local_high;     // highest value in local set (can be even)
     int local_setsize;  // number of odd values in local set
+    int global_low;     // lowest odd value in {rootn + 1, ..., n}
+    int global_high;    // n
+    int global_setsize; // number of odd values in {rootn + 1, ..., n}
 
     char *grid_rootn;   // track if odd vals in {1, ..., rootn} have factors
+    MPI_Win rootn_win;  // node-shared window holding grid_rootn
     char *grid_local;   // track if odd vals in local set have factors
 
     int nprime_rootn;   // number of prime numbers in {2, ..., rootn}
     int nprime_local;   // number of prime numbers in local set
+    int nprime_high;    // number of prime numbers in {rootn + 1, ..., n}
     double elapsed;     // parallel execution time
 
     // Initialize the MPI environment
@@ -66,57 +88,81 @@ int main(int argc, char *argv[]) {
     // Get the rank of the process
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    /* Default value of n is set to 1e6; if an argument for n is passed in
-     * through the command line then n will be set to this value by parse_args
+    /* Default value of n is set to 1e6 and b to 1; if an argument for n or b
+     * is passed in through the command line then n or b will be set to this
+     * value by parse_functional_args
      */
     n = 1e6;
-    parse_args(argc, argv, NULL, &n, NULL);
+    nblocks = 1;
+    parse_functional_args(argc, argv, &n, &nblocks);
+    if (nblocks > size) {
+	fprintf(stderr, "the number of blocks must be <= the number of processes\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
     rootn = sqrt(n);
     rootn_setsize = (rootn + 1) / 2;
 
-    /* Calculate the smallest odd number in the rank-th set, the largest number
-     * in the rank-th set, and the number of odd values in the set, and store
-     * these values in *low_value, *high_value, and *set_size, respectively.
+    /* Split the processes into nblocks groups of consecutive ranks, one per
+     * range block.  Within a block the processes are the prime groups of the
+     * functional decomposition.
      */
-    local_set_params(rootn + 1, n, 0, 1, &local_low, &local_high, &local_setsize);
+    block = BLOCK_OWNER(rank, nblocks, size);
+    MPI_Comm_split(MPI_COMM_WORLD, block, rank, &block_comm);
+    MPI_Comm_size(block_comm, &block_size);
+    MPI_Comm_rank(block_comm, &block_rank);
+
+    /* Calculate the smallest odd number in the block-th set, the largest
+     * number in the block-th set, and the number of odd values in the set, and
+     * store these values in *low_value, *high_value, and *set_size,
+     * respectively.
+     */
+    local_set_params(rootn + 1, n, block, nblocks, &local_low, &local_high,
+		     &local_setsize);
+    if (local_high < local_low) {
+	local_setsize = 0;
+    }
+    local_set_params(rootn + 1, n, 0, 1, &global_low, &global_high, &global_setsize);
 
-    /* Allocate memory for prime number grids and set each element in each grid to 
+    /* Allocate memory for the local prime number grid and set each element to
      * not having a factor state
      */
-    initialize_grid(&grid_rootn, rootn_setsize);
     initialize_grid(&grid_local, local_setsize);
 
-    /* Select every rank-th prime in {3, ..., rootn} to mark multiples of off in the
-     * set {rootn + 1, ..., n}, such that the multiples are larger then the square
-     * of the prime
+    /* Walk through prime number grid from {1, ..., rootn} and mark elements
+     * for which a factor is found.  The grid is computed once per node, split
+     * among the processes of the node, and shared by all of them.
      */
-    fill_grid_rootn(grid_rootn, rootn, rootn_setsize);
+    fill_grid_rootn_shared(&grid_rootn, rootn, rootn_setsize, &rootn_win);
 
-    /* Walk through prime number grid from {rootn + 1, ..., n} and mark
-     * multiples of every rank-th prime in {3, ..., rootn} as having a factor
+    /* Walk through the block's part of the prime number grid from {rootn + 1,
+     * ..., n} and mark multiples of every block_rank-th prime in {3, ...,
+     * rootn} as having a factor
      */
     fill_grid_local_v4(grid_local, grid_rootn, rootn_setsize, local_low, 
-		       local_setsize, rank, size);
+		       local_setsize, block_rank, block_size);
 
-    /* OR each of the array elements; as a result every element for which a
-     * factor was found by at least one process will be marked as such
+    /* OR each of the array elements within the block; as a result every
+     * element for which a factor was found by at least one process of the
+     * block will be marked as such
      */
-    if (!rank) {
-    	MPI_Reduce(MPI_IN_PLACE, grid_local, local_setsize, MPI_CHAR, MPI_LOR, 0, MPI_COMM_WORLD);
+    if (!block_rank) {
+	MPI_Reduce(MPI_IN_PLACE, grid_local, local_setsize, MPI_CHAR, MPI_LOR, 0, block_comm);
     }
     else {
-    	MPI_Reduce(grid_local, NULL, local_setsize, MPI_CHAR, MPI_LOR, 0, MPI_COMM_WORLD);
+	MPI_Reduce(grid_local, NULL, local_setsize, MPI_CHAR, MPI_LOR, 0, block_comm);
     }
 
-    // Count the number of primes
+    // Count the number of primes of the block, and add up the counts
+    nprime_local = (!block_rank) ? count_primes(grid_local, local_setsize) : 0;
+    MPI_Reduce(&nprime_local, &nprime_high, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
     if (!rank) {
 	nprime_rootn = count_primes(grid_rootn, rootn_setsize);
-	nprime_local = count_primes(grid_local, local_setsize);
     }
 
     // Free data
-    free(grid_rootn);
-    free(grid_local);
+    MPI_Win_free(&rootn_win);
+    free_grid(grid_local);
+    MPI_Comm_free(&block_comm);
 
     // Stop the timer
     elapsed += MPI_Wtime();
@@ -134,12 +180,12 @@ int main(int argc, char *argv[]) {
 
 	printf("The number of primes in the set from %d to %d (inclusive) is %d\n"
 	       "\n",
-	       local_low, local_high, nprime_local);
+	       global_low, global_high, nprime_high);
 	       
 	printf("%d primes are less than or equal to %d\n"
 	       "Total elapsed time: %10.6f\n"
 	       "\n",
-	       nprime_rootn + nprime_local, n, elapsed);
+	       nprime_rootn + nprime_high, n, elapsed);
     }
 
     return 0;
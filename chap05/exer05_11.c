@@ -12,11 +12,35 @@
  * parameters to other processes.
  */
 
+/* The sum is kept as a fixed-point number with enough base 2^32 limbs for d
+ * digits (see bigfix_helper.h), so that the printed digits are exact up to the
+ * truncation of the last one rather than limited to the 15 or so digits of a
+ * double.  Each process adds its share of the terms 1 / k by long division,
+ * and the partial sums are combined by a user-defined MPI reduction.
+ *
+ * For large n the terms past a split point m are replaced by the
+ * Euler-Maclaurin expansion of S_n - S_m (see harmonic_helper.c), with m and
+ * the number of correction terms chosen from d, so that n can be as large as
+ * 1e18.  The argument "m" selects the method: "direct" sums every term, "em"
+ * always uses the expansion, and "auto" (the default) uses it when it is
+ * cheaper.
+ */
+
 #include <mpi.h>
 #include <stdio.h>
-#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 
 #include "parse_args.h"
+#include "bigfix_helper.h"
+#include "harmonic_helper.h"
+
+#define METHOD_AUTO    0
+#define METHOD_DIRECT  1
+#define METHOD_EM      2
+
+#define MAX_N  1000000000000000000LL  // 1e18
 
 
 int main(int argc, char *argv[]) {
@@ -24,15 +48,22 @@ int main(int argc, char *argv[]) {
     int rank;  // process rank
     int size;  // number of processes
     
-    int n;  // variable n in sum_{k=1}^n 1 / k
-    int d;  // precision with which to print S_n
-    int k;
+    long long n;         // variable n in sum_{k=1}^n 1 / k
+    int d;               // precision with which to print S_n
+    const char *mname;   // name of the method
+    int method;          // the method, one of METHOD_*
+    int use_em;          // whether to use the Euler-Maclaurin expansion
+    long long m;         // split point of the Euler-Maclaurin expansion
+    int nterms;          // number of Euler-Maclaurin corrections
 
-    double harm_local;   // store the local portion of S_n
-    double harm_global;  // store the entire value of S_n
+    int nfrac;              // number of fraction limbs of the sums
+    uint32_t *harm_local;   // store the local portion of S_n
+    uint32_t *harm_tail;    // store the local portion of S_n - S_m
+    uint32_t *harm_global;  // store the entire value of S_n
+    char *harm_str;         // decimal representation of S_n
 
-    harm_local = 0;
-    harm_global = 0;
+    MPI_Datatype bigfix_type;
+    MPI_Op sum_op;
 
     // Initialize the MPI environment
     MPI_Init(&argc, &argv);
@@ -41,9 +72,9 @@ int main(int argc, char *argv[]) {
     // Get the rank of the process
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    /* Process 0 looks for command-line arguments for n and d and updates their
-     * values if present.  These values are then broadcast to the remaining
-     * processes.
+    /* Process 0 looks for command-line arguments for n, d, and the method and
+     * updates their values if present.  These values are then broadcast to the
+     * remaining processes.
      *
      * It is surely better to just let each process read the arguments for
      * themselves, but for the sake of the exercise we will do as prompted.
@@ -51,31 +82,97 @@ int main(int argc, char *argv[]) {
     if (!rank) {
 	n = 1000;
 	d = 15;
-    	parse_args(argc, argv, &d, &n, NULL);
+	mname = "auto";
+	parse_harmonic_args(argc, argv, &d, &n, &mname);
+	if (!strcmp(mname, "auto")) {
+	    method = METHOD_AUTO;
+	}
+	else if (!strcmp(mname, "direct")) {
+	    method = METHOD_DIRECT;
+	}
+	else if (!strcmp(mname, "em")) {
+	    method = METHOD_EM;
+	}
+	else {
+	    fprintf(stderr, "Invalid method \"%s\"\n", mname);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	if (n > MAX_N) {
+	    fprintf(stderr, "n must be <= %lld\n", MAX_N);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
     }
-    MPI_Bcast(&n, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&n, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
     MPI_Bcast(&d, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&method, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    // Every process makes the same choice from the same parameters
+    use_em = 0;
+    if (method != METHOD_DIRECT) {
+	use_em = em_choose_split(d, n, size, &m, &nterms);
+    }
+    if ((method == METHOD_EM) && !use_em && !rank) {
+	fprintf(stderr, "n is too small for the Euler-Maclaurin expansion to pay off; "
+		"summing directly\n");
+    }
+    if (!use_em && (n > BIGFIX_MAX_DENOM)) {
+	if (!rank) {
+	    fprintf(stderr, "n must be <= %lld to sum directly\n", BIGFIX_MAX_DENOM);
+	}
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+
+    nfrac = bigfix_nfrac(d);
+    harm_local = malloc((nfrac + 1) * sizeof(uint32_t));
+    harm_tail = malloc((nfrac + 1) * sizeof(uint32_t));
+    harm_global = malloc((nfrac + 1) * sizeof(uint32_t));
+    harm_str = malloc(d + 12);
+    if ((harm_local == NULL) || (harm_tail == NULL) || (harm_global == NULL)
+	|| (harm_str == NULL)) {
+	fprintf(stderr, "error allocating memory for S_n\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
 
     // Compute the local share of S_n
-    for (k = rank + 1; k <= n; k += size) {
-	harm_local += 1.0 / k;
+    if (use_em) {
+	harmonic_direct(harm_local, nfrac, 1, m, rank, size);
+	harmonic_em_tail(harm_tail, nfrac, n, m, nterms, rank, size);
+	bigfix_add(harm_local, harm_tail, nfrac);
+    }
+    else {
+	harmonic_direct(harm_local, nfrac, 1, n, rank, size);
     }
     
-    // Find the sum of the primes found in each process
-    MPI_Reduce(&harm_local, &harm_global, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    // Add the local shares of S_n
+    bigfix_create_sum_op(nfrac, &bigfix_type, &sum_op);
+    MPI_Reduce(harm_local, harm_global, 1, bigfix_type, sum_op, 0, MPI_COMM_WORLD);
+    MPI_Op_free(&sum_op);
+    MPI_Type_free(&bigfix_type);
 
     // Finalize the MPI environment
     MPI_Finalize();
 
     if (!rank) {
+	sprint_bigfix(harm_str, harm_global, nfrac, d);
 	printf("\n"
-	       "The value of S_n for n = %d and printed to %d digits of\n"
+	       "The value of S_n for n = %lld and printed to %d digits of\n"
 	       "precision after the decimal point is:\n"
 	       "\n"
-	       "    %.*f\n"
+	       "    %s\n"
 	       "\n",
-	       n, d, d, harm_global);
+	       n, d, harm_str);
+	if (use_em) {
+	    printf("(the terms past m = %lld were replaced by the Euler-Maclaurin\n"
+		   "expansion with %d corrections)\n"
+		   "\n",
+		   m, nterms);
+	}
     }	       
 
+    free(harm_local);
+    free(harm_tail);
+    free(harm_global);
+    free(harm_str);
+
     return 0;
 }
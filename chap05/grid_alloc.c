@@ -0,0 +1,194 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "grid_alloc.h"
+
+#define KIND_CALLOC  0  // allocated with calloc
+#define KIND_MMAP    1  // allocated with mmap
+
+/* Space kept in front of each grid for the grid_header, a multiple of the
+ * cache line size so that the grid itself stays aligned
+ */
+#define HEADER_SIZE  64
+
+// Memory policy of the mbind system call, from <linux/mempolicy.h>
+#define MPOL_BIND_MODE  2
+
+/* What free_grid needs to know to release a grid, stored just in front of it */
+typedef struct {
+    size_t maplen;  // length of the mapping, including the header
+    int kind;       // KIND_CALLOC or KIND_MMAP
+} grid_header;
+
+static void *map_grid(size_t maplen, int hugepages);
+static void bind_local_node(void *addr, size_t maplen);
+static int env_equals(const char *name, const char *value);
+
+
+
+
+/* Allocate a grid of len bytes, set to 0, to be freed with free_grid.
+ *
+ * Grids of at least GRID_MMAP_MIN bytes are mapped with mmap, backed by huge
+ * pages and bound to the local NUMA node as requested through the environment
+ * variables described in grid_alloc.h.  Huge pages cut the number of TLB
+ * entries needed to sweep a large grid by a factor of 512.  Once the policy
+ * is set every page is touched by zeroing it here, in the process that will
+ * sieve the grid, so that under the kernel's first-touch policy the pages are
+ * placed on the node that the process runs on, and so that the page faults are
+ * not taken inside of the marking loops.
+ */
+
+void *alloc_grid(size_t len) {
+
+    grid_header *header;
+    size_t maplen;
+    char *base;
+    int hugepages;
+
+    maplen = len + HEADER_SIZE;
+    base = NULL;
+
+    if (len >= GRID_MMAP_MIN) {
+	hugepages = !env_equals(GRID_ENV_HUGEPAGES, "none");
+
+	// Explicit huge pages, whose mappings must be whole pages
+	if (env_equals(GRID_ENV_HUGEPAGES, "explicit")) {
+	    maplen = ((maplen + GRID_HUGE_PAGE - 1) / GRID_HUGE_PAGE) * GRID_HUGE_PAGE;
+	    base = map_grid(maplen, 2);
+	}
+	// case: no explicit huge pages; fall back to transparent ones
+	if (base == NULL) {
+	    maplen = len + HEADER_SIZE;
+	    base = map_grid(maplen, hugepages);
+	}
+	if ((base != NULL) && env_equals(GRID_ENV_NUMA, "local")) {
+	    bind_local_node(base, maplen);
+	}
+	if (base != NULL) {
+	    memset(base, 0, maplen);
+	    header = (grid_header *) base;
+	    header->maplen = maplen;
+	    header->kind = KIND_MMAP;
+	}
+    }
+
+    // case: a small grid, or no mapping could be made
+    if (base == NULL) {
+	base = calloc(len + HEADER_SIZE, 1);
+	if (base == NULL) {
+	    fprintf(stderr, "error allocating memory for prime number grid\n");
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	}
+	header = (grid_header *) base;
+	header->maplen = len + HEADER_SIZE;
+	header->kind = KIND_CALLOC;
+    }
+
+    return base + HEADER_SIZE;
+}
+
+
+
+
+/* Free a grid allocated with alloc_grid.  Does nothing if grid is NULL. */
+
+void free_grid(void *grid) {
+
+    grid_header *header;
+
+    if (grid == NULL) {
+	return;
+    }
+
+    header = (grid_header *) ((char *) grid - HEADER_SIZE);
+    if (header->kind == KIND_MMAP) {
+	munmap(header, header->maplen);
+    }
+    else {
+	free(header);
+    }
+}
+
+
+
+
+/* Map maplen bytes of anonymous memory and return its address, or NULL if the
+ * mapping failed.  If hugepages is 1 then transparent huge pages are requested
+ * with madvise, which the kernel may ignore, and if it is 2 then the mapping is
+ * made from explicit huge pages, which fails if the pool is too small.
+ */
+
+static void *map_grid(size_t maplen, int hugepages) {
+
+    void *addr;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_HUGETLB
+    if (hugepages == 2) {
+	flags |= MAP_HUGETLB;
+    }
+#else
+    if (hugepages == 2) {
+	return NULL;
+    }
+#endif
+
+    addr = mmap(NULL, maplen, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (addr == MAP_FAILED) {
+	return NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (hugepages == 1) {
+	madvise(addr, maplen, MADV_HUGEPAGE);
+    }
+#endif
+
+    return addr;
+}
+
+
+
+
+/* Bind the pages of the mapping to the NUMA node of the CPU that the process is
+ * currently running on.  The system calls are made directly so that libnuma is
+ * not needed; if either is unavailable (or the node doesn't fit in the mask)
+ * the mapping is left to the default policy.
+ */
+
+static void bind_local_node(void *addr, size_t maplen) {
+
+#if defined(SYS_getcpu) && defined(SYS_mbind)
+    unsigned int cpu;
+    unsigned int node;
+    unsigned long nodemask;
+
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+	return;
+    }
+    if (node >= 8 * sizeof(nodemask)) {
+	return;
+    }
+    nodemask = 1UL << node;
+    syscall(SYS_mbind, addr, maplen, MPOL_BIND_MODE, &nodemask,
+	    8 * sizeof(nodemask), 0);
+#endif
+}
+
+
+
+
+// Return whether the environment variable name is set to value
+static int env_equals(const char *name, const char *value) {
+
+    const char *env = getenv(name);
+
+    return (env != NULL) && !strcmp(env, value);
+}
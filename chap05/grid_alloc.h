@@ -0,0 +1,27 @@
+#include <stddef.h>
+
+/* Environment variables that control how alloc_grid allocates large grids.
+ *
+ * SIEVE_HUGEPAGES:  "thp" (the default) asks for transparent huge pages with
+ *                   madvise, "explicit" maps pages from the hugetlbfs pool
+ *                   (see /proc/sys/vm/nr_hugepages), and "none" uses the
+ *                   normal page size.
+ * SIEVE_NUMA:       "local" binds the grid to the NUMA node of the CPU that
+ *                   the process is running on, and "none" (the default)
+ *                   leaves the placement to the kernel's first-touch policy.
+ *
+ * Any request that the system can't satisfy silently falls back to the next
+ * best option, down to calloc.
+ */
+#define GRID_ENV_HUGEPAGES  "SIEVE_HUGEPAGES"
+#define GRID_ENV_NUMA       "SIEVE_NUMA"
+
+// Grids smaller than this are allocated with calloc
+#define GRID_MMAP_MIN  (1 << 21)
+
+// Size of an explicit huge page, to which those mappings are rounded up
+#define GRID_HUGE_PAGE  (1 << 21)
+
+void *alloc_grid(size_t len);
+
+void free_grid(void *grid);
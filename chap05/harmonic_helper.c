@@ -0,0 +1,401 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "bigfix_helper.h"
+#include "harmonic_helper.h"
+
+#define LIMB_MASK  0xffffffffULL
+
+static int tangent_limbs(int nterms);
+static uint32_t *tangent_numbers(int nterms, int ntlimbs, int *lens);
+static void div_pow4_minus_1(uint32_t *x, uint32_t *tmp, int nfrac, int k);
+static void mul_big_fix(uint32_t *result, int nfrac, const uint32_t *big, int len,
+			const uint32_t *x, int nfrac_x);
+
+
+
+
+/* Write the local share of \sum_{k = first}^{last} 1 / k to local, each process
+ * adding every size-th term.  last must be at most BIGFIX_MAX_DENOM.
+ */
+
+void harmonic_direct(uint32_t *local, int nfrac, long long first, long long last,
+		     int rank, int size) {
+
+    uint64_t *acc;     // lazy accumulator of the terms
+    long long nlazy;   // number of terms added since the last normalization
+    long long k;
+
+    acc = bigfix_alloc_acc(nfrac);
+
+    nlazy = 0;
+    for (k = first + rank; k <= last; k += size) {
+	bigfix_add_recip(acc, nfrac, k);
+	if (++nlazy == BIGFIX_LAZY_TERMS) {
+	    bigfix_normalize(acc, nfrac);
+	    nlazy = 0;
+	}
+    }
+    bigfix_from_acc(local, acc, nfrac);
+
+    free(acc);
+}
+
+
+
+
+/* Choose the split point m and the number of correction terms nterms with
+ * which harmonic_em_tail finds S_n - S_m to d digits, and return 1 if doing so
+ * is cheaper than summing all n terms directly, or 0 otherwise.
+ *
+ * Truncating the Euler-Maclaurin series of the tail after nterms corrections
+ * leaves an error bounded by the first omitted term, which is about
+ *
+ *     2 (2 nterms + 1)! / (2 pi m)^{2 nterms + 2},
+ *
+ * so more corrections allow a smaller m.  For each nterms we find the smallest
+ * m for which the bound is below 10^-(d + 3), and we take the pair with the
+ * smallest estimated cost (in limb operations per process) of the explicit
+ * sum up to m, the tangent numbers, and the corrections.  Finally m is rounded
+ * up so that n / m is just below a power of 2, which makes the logarithm in
+ * harmonic_em_tail cheap.
+ */
+
+int em_choose_split(int d, long long n, int size, long long *m, int *nterms) {
+
+    double nfrac;       // number of fraction limbs of the result
+    double need;        // log10 of 2 (2k + 1)! 10^(d + 3)
+    double log_2pim;    // smallest allowed log10(2 pi m) for k corrections
+    double ntlimbs;     // limbs of the k-th tangent number
+    double cost;
+    double best_cost;
+    long long split;
+    long long best_split;
+    int best_nterms;
+    int j;
+    int k;
+
+    nfrac = bigfix_nfrac(d);
+    best_cost = INFINITY;
+    best_split = 0;
+    best_nterms = 0;
+    for (k = 1; k <= EM_MAX_TERMS; k++) {
+
+	need = log10(2) + (lgamma((2 * k) + 2) / log(10)) + d + 3;
+	log_2pim = need / ((2 * k) + 2);
+	if (log_2pim > log10(2 * M_PI * (BIGFIX_MAX_DENOM / 2))) {
+	    continue;
+	}
+	split = ceil(pow(10, log_2pim) / (2 * M_PI));
+	if (split < EM_MIN_SPLIT) {
+	    split = EM_MIN_SPLIT;
+	}
+
+	ntlimbs = tangent_limbs(k);
+	cost = (split * nfrac / size)                   // explicit sum
+	    + (k * (double) k * ntlimbs / 4)            // tangent numbers
+	    + (16 * k * (nfrac + ntlimbs))              // powers of 1 / 2m
+	    + (k * ntlimbs * nfrac / (2 * size));       // corrections
+	if (cost < best_cost) {
+	    best_cost = cost;
+	    best_split = split;
+	    best_nterms = k;
+	}
+    }
+
+    // case: no feasible split, or the direct sum is about as cheap
+    if ((best_nterms == 0) || (n <= 2 * best_split)) {
+	return 0;
+    }
+
+    // Find j with 2^j best_split <= n < 2^{j + 1} best_split, and round up
+    for (j = 0; (best_split << (j + 1)) <= n; j++) {
+	;
+    }
+    *m = (n + (1LL << j) - 1) >> j;
+    *nterms = best_nterms;
+
+    return 1;
+}
+
+
+
+
+/* Write the local share of S_n - S_m to local, using the Euler-Maclaurin
+ * formula with nterms corrections:
+ *
+ *     S_n - S_m = ln(n / m) + 1 / 2n - 1 / 2m
+ *                 + \sum_{k=1}^{nterms} B_{2k} / 2k (m^{-2k} - n^{-2k}).
+ *
+ * This is the usual S_n = ln n + gamma + 1 / 2n - \sum B_{2k} / (2k n^{2k})
+ * with gamma eliminated by the same expansion at m, so that Euler's constant
+ * is never needed.  The logarithm is found as
+ *
+ *     ln(n / m) = j ln 2 - 2 atanh((2^j m - n) / (2^j m + n)),
+ *
+ * where j is the smallest integer with 2^j m >= n; when m comes from
+ * em_choose_split, the atanh argument is about 1 / 2m and its series is short.
+ *
+ * The Bernoulli numbers come from the tangent numbers T_k, which are integers,
+ * as B_{2k} / 2k = (-1)^{k-1} T_k / (4^k (4^k - 1)).  Each correction is
+ * therefore T_k times ((2m)^{-2k} - (2n)^{-2k}) / (4^k - 1).  Since T_k is huge
+ * the second factor is kept to ntlimbs more limbs than the result.
+ *
+ * The corrections are split cyclically over the processes, and the last
+ * process also adds the logarithm and the 1 / 2n - 1 / 2m terms, so that rank
+ * 0 (which also does the final decimal conversion) is spared.
+ */
+
+void harmonic_em_tail(uint32_t *local, int nfrac, long long n, long long m,
+		      int nterms, int rank, int size) {
+
+    uint32_t *tmp;       // scratch value at the precision of the result
+    uint32_t *tangents;  // the tangent numbers T_1, ..., T_nterms
+    int *lens;           // the number of limbs of each tangent number
+    uint32_t *gm;        // (2m)^{-2k} at the extended precision
+    uint32_t *gn;        // (2n)^{-2k} at the extended precision
+    uint32_t *corr;      // ((2m)^{-2k} - (2n)^{-2k}) / (4^k - 1)
+    uint32_t *scratch;   // scratch value at the extended precision
+    int ntlimbs;         // limbs of the largest tangent number
+    int nfrac_ext;       // fraction limbs of the extended precision
+    int j;
+    int k;
+
+    tmp = calloc(nfrac + 1, sizeof(uint32_t));
+    if (tmp == NULL) {
+	fprintf(stderr, "error allocating memory for the Euler-Maclaurin tail\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    memset(local, 0, (nfrac + 1) * sizeof(uint32_t));
+
+    // The logarithm and the endpoint terms
+    if (rank == size - 1) {
+	for (j = 0; (m << j) < n; j++) {
+	    ;
+	}
+
+	// j ln 2 = 2 j atanh(1 / 3)
+	bigfix_atanh(tmp, nfrac, 1, 3);
+	bigfix_muldiv_u64(tmp, nfrac, 2 * j, 1);
+	bigfix_add(local, tmp, nfrac);
+
+	bigfix_atanh(tmp, nfrac, (m << j) - n, (m << j) + n);
+	bigfix_muldiv_u64(tmp, nfrac, 2, 1);
+	bigfix_sub(local, tmp, nfrac);
+
+	memset(tmp, 0, (nfrac + 1) * sizeof(uint32_t));
+	tmp[0] = 1;
+	bigfix_muldiv_u64(tmp, nfrac, 1, 2 * n);
+	bigfix_add(local, tmp, nfrac);
+
+	memset(tmp, 0, (nfrac + 1) * sizeof(uint32_t));
+	tmp[0] = 1;
+	bigfix_muldiv_u64(tmp, nfrac, 1, 2 * m);
+	bigfix_sub(local, tmp, nfrac);
+    }
+
+    // The corrections
+    ntlimbs = tangent_limbs(nterms);
+    nfrac_ext = nfrac + ntlimbs;
+    lens = malloc(nterms * sizeof(int));
+    gm = calloc(nfrac_ext + 1, sizeof(uint32_t));
+    gn = calloc(nfrac_ext + 1, sizeof(uint32_t));
+    corr = malloc((nfrac_ext + 1) * sizeof(uint32_t));
+    scratch = malloc((nfrac_ext + 1) * sizeof(uint32_t));
+    if ((lens == NULL) || (gm == NULL) || (gn == NULL) || (corr == NULL)
+	|| (scratch == NULL)) {
+	fprintf(stderr, "error allocating memory for the Euler-Maclaurin tail\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    tangents = tangent_numbers(nterms, ntlimbs, lens);
+
+    gm[0] = 1;
+    gn[0] = 1;
+    for (k = 1; k <= nterms; k++) {
+
+	// Every process needs the powers, but only computes its own corrections
+	bigfix_muldiv_u64(gm, nfrac_ext, 1, 2 * m);
+	bigfix_muldiv_u64(gm, nfrac_ext, 1, 2 * m);
+	if (!bigfix_is_zero(gn, nfrac_ext)) {
+	    bigfix_muldiv_u64(gn, nfrac_ext, 1, 2 * n);
+	    bigfix_muldiv_u64(gn, nfrac_ext, 1, 2 * n);
+	}
+	if ((k - 1) % size != rank) {
+	    continue;
+	}
+
+	memcpy(corr, gm, (nfrac_ext + 1) * sizeof(uint32_t));
+	bigfix_sub(corr, gn, nfrac_ext);
+	div_pow4_minus_1(corr, scratch, nfrac_ext, k);
+
+	mul_big_fix(tmp, nfrac, tangents + ((long long) (k - 1) * ntlimbs), lens[k - 1],
+		    corr, nfrac_ext);
+	if (k % 2) {
+	    bigfix_add(local, tmp, nfrac);
+	}
+	else {
+	    bigfix_sub(local, tmp, nfrac);
+	}
+    }
+
+    free(tmp);
+    free(tangents);
+    free(lens);
+    free(gm);
+    free(gn);
+    free(corr);
+    free(scratch);
+}
+
+
+
+
+/* Return a number of limbs that can hold the tangent numbers T_1, ...,
+ * T_nterms, using T_k < (2k)!
+ */
+
+static int tangent_limbs(int nterms) {
+    return (lgamma((2 * nterms) + 1) / log(2) / 32) + 2;
+}
+
+
+
+
+/* Return the tangent numbers T_1, ..., T_nterms (1, 2, 16, 272, ...), the k-th
+ * stored as an integer in ntlimbs little-endian base 2^32 limbs starting at
+ * index (k - 1) ntlimbs, and write the number of limbs in use of each to lens.
+ *
+ * This is the algorithm of Brent and Harvey: start from T_k = (k - 1)! and
+ * apply T_j = (j - k) T_{j-1} + (j - k + 2) T_j for k = 2, ..., nterms and j =
+ * k, ..., nterms.  It only needs additions and multiplications by small
+ * integers.
+ */
+
+static uint32_t *tangent_numbers(int nterms, int ntlimbs, int *lens) {
+
+    uint32_t *tangents;
+    uint32_t *prev;   // T_{j-1}
+    uint32_t *curr;   // T_j
+    uint64_t carry;
+    int len;
+    int i;
+    int j;
+    int k;
+
+    tangents = calloc((long long) nterms * ntlimbs, sizeof(uint32_t));
+    if (tangents == NULL) {
+	fprintf(stderr, "error allocating memory for the tangent numbers\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    // T_1 = 0! = 1, and T_k = (k - 1) T_{k-1}
+    tangents[0] = 1;
+    lens[0] = 1;
+    for (k = 2; k <= nterms; k++) {
+	prev = tangents + ((long long) (k - 2) * ntlimbs);
+	curr = tangents + ((long long) (k - 1) * ntlimbs);
+	carry = 0;
+	for (i = 0; i < lens[k - 2]; i++) {
+	    carry += (uint64_t) prev[i] * (k - 1);
+	    curr[i] = carry & LIMB_MASK;
+	    carry >>= 32;
+	}
+	lens[k - 1] = lens[k - 2];
+	if (carry) {
+	    curr[lens[k - 1]++] = carry;
+	}
+    }
+
+    for (k = 2; k <= nterms; k++) {
+	for (j = k; j <= nterms; j++) {
+	    prev = tangents + ((long long) (j - 2) * ntlimbs);
+	    curr = tangents + ((long long) (j - 1) * ntlimbs);
+	    len = (lens[j - 2] > lens[j - 1]) ? lens[j - 2] : lens[j - 1];
+	    carry = 0;
+	    for (i = 0; i < len; i++) {
+		carry += ((uint64_t) prev[i] * (j - k)) + ((uint64_t) curr[i] * (j - k + 2));
+		curr[i] = carry & LIMB_MASK;
+		carry >>= 32;
+	    }
+	    while (carry) {
+		if (len == ntlimbs) {
+		    fprintf(stderr, "tangent number T_%d does not fit in %d limbs\n", j, ntlimbs);
+		    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+		}
+		curr[len++] = carry & LIMB_MASK;
+		carry >>= 32;
+	    }
+	    lens[j - 1] = len;
+	}
+    }
+
+    return tangents;
+}
+
+
+
+
+/* Divide x by 4^k - 1, using tmp as scratch space.  For k > 31 the divisor does
+ * not fit in 64 bits, and we use x / (4^k - 1) = \sum_{i >= 1} x / 4^{ki}
+ * instead.
+ */
+
+static void div_pow4_minus_1(uint32_t *x, uint32_t *tmp, int nfrac, int k) {
+
+    long long shift;
+
+    if (k <= 31) {
+	bigfix_muldiv_u64(x, nfrac, 1, (1ULL << (2 * k)) - 1);
+	return;
+    }
+
+    memcpy(tmp, x, (nfrac + 1) * sizeof(uint32_t));
+    memset(x, 0, (nfrac + 1) * sizeof(uint32_t));
+    for (shift = 2 * k; shift < 32LL * (nfrac + 1); shift += 2 * k) {
+	bigfix_shr(tmp, tmp, nfrac, 2 * k);
+	bigfix_add(x, tmp, nfrac);
+    }
+}
+
+
+
+
+/* Write the product of the integer big, which has len little-endian limbs, and
+ * the fixed-point number x, which has nfrac_x fraction limbs, to result, which
+ * has nfrac fraction limbs.  The product must be less than 2^32.
+ *
+ * Limb a of big has weight 2^{32a} and limb b of x has weight 2^{-32b}, so
+ * their product goes to fraction limb b - a of the result, with its high half
+ * one limb up.  Products below the last limb of the result are dropped.
+ */
+
+static void mul_big_fix(uint32_t *result, int nfrac, const uint32_t *big, int len,
+			const uint32_t *x, int nfrac_x) {
+
+    uint64_t *acc;    // lazy accumulator of the result
+    uint64_t prod;
+    int a;
+    int b;
+    int r;
+
+    acc = bigfix_alloc_acc(nfrac);
+
+    for (a = 0; a < len; a++) {
+	for (r = 0; (r <= nfrac) && (r + a <= nfrac_x); r++) {
+	    b = r + a;
+	    prod = (uint64_t) big[a] * x[b];
+	    acc[r] += prod & LIMB_MASK;
+	    if (r > 0) {
+		acc[r - 1] += prod >> 32;
+	    }
+	}
+    }
+    bigfix_from_acc(result, acc, nfrac);
+
+    free(acc);
+}
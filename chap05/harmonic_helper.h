@@ -0,0 +1,13 @@
+
+#include <stdint.h>
+
+#define EM_MIN_SPLIT     16    // smallest split point of the Euler-Maclaurin path
+#define EM_MAX_TERMS   2000    // largest number of Euler-Maclaurin corrections
+
+void harmonic_direct(uint32_t *local, int nfrac, long long first, long long last,
+		     int rank, int size);
+
+int em_choose_split(int d, long long n, int size, long long *m, int *nterms);
+
+void harmonic_em_tail(uint32_t *local, int nfrac, long long n, long long m,
+		      int nterms, int rank, int size);
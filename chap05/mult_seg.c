@@ -0,0 +1,144 @@
+/* A segmented sieve for the multiplicative functions of every value in a
+ * range {low, ..., n} with n up to 1e18: the smallest prime factor, Euler's
+ * totient phi, the Moebius function mu, and the number omega of distinct prime
+ * factors.  The range is split into contiguous blocks, and each process sieves
+ * its block a segment at a time with the sieving primes up to sqrt(n), which
+ * are found in parallel and shared (see gather_sieving_primes).
+ *
+ * The arrays of each segment are handed to a callback as soon as they are
+ * done; here the callback summarizes them, and the summaries are combined by
+ * a user-defined MPI reduction.  The running sum of mu of each block is
+ * shifted by the sum of mu over the blocks before it, found with MPI_Exscan,
+ * so that the extremes of the Mertens function M(x) are found as well.
+ */
+
+/* Accepts an argument n for the largest value of the range (default 1e6), an
+ * argument l for its lowest value (default 1), and an argument s for the
+ * number of values per segment (default MF_SEG_LEN).  When l > 1 the sums of
+ * mu are relative to M(l - 1).
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "parse_args.h"
+#include "segsieve_helper.h"
+#include "multfcn_helper.h"
+
+#define MAX_N  1000000000000000000LL  // 1e18
+
+
+int main(int argc, char *argv[]) {
+
+    int rank;           // process rank
+    int size;           // number of processes
+
+    long long low;      // lowest value of the range
+    long long n;        // largest value of the range
+    long long seg_len;  // number of values per segment
+
+    int *primes;              // odd primes up to sqrt(n)
+    int nprimes;
+
+    long long local_low;      // lowest value in local block
+    long long local_high;     // highest value in local block
+    long long offset;         // sum of mu over the blocks of lower ranks
+    mult_summary local;       // summary of the local block
+    mult_summary global;      // summary of the whole range
+    MPI_Datatype summary_type;
+    MPI_Op summary_op;
+    char phi_str[U192_STRLEN];
+    char spf_str[U192_STRLEN];
+    const char *mname;        // name of the sums of mu
+    double elapsed;           // parallel execution time
+    int w;
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Start the timer
+    MPI_Barrier(MPI_COMM_WORLD);
+    elapsed = -MPI_Wtime();
+
+    // Get the number of the processes
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    // Get the rank of the process
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* Default values of the range and of the segment length; if arguments are
+     * passed in through the command line then they will be set by
+     * parse_mult_args
+     */
+    low = 1;
+    n = 1e6;
+    seg_len = MF_SEG_LEN;
+    parse_mult_args(argc, argv, &low, &n, &seg_len);
+    if (n > MAX_N) {
+	fprintf(stderr, "n must be <= %lld\n", MAX_N);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    if (low > n) {
+	fprintf(stderr, "l must be <= n\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+
+    nprimes = gather_sieving_primes((int) isqrt_ll(n), rank, size, &primes);
+
+    // Sieve the local block, summarizing each segment as it is done
+    block_range_ll(low, n, rank, size, &local_low, &local_high);
+    init_mult_summary(&local);
+    mult_sieve_range(local_low, local_high, seg_len, primes, nprimes,
+		     summarize_mult_segment, &local);
+    free(primes);
+
+    // The result of MPI_Exscan is undefined on process 0
+    MPI_Exscan(&local.mertens, &offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (!rank) {
+	offset = 0;
+    }
+    shift_mult_summary(&local, offset);
+
+    create_mult_summary_op(&summary_type, &summary_op);
+    MPI_Reduce(&local, &global, 1, summary_type, summary_op, 0, MPI_COMM_WORLD);
+    MPI_Op_free(&summary_op);
+    MPI_Type_free(&summary_type);
+
+    // Stop the timer
+    elapsed += MPI_Wtime();
+
+    // Finalize the MPI environment
+    MPI_Finalize();
+
+    // Print the results
+    if (!rank) {
+	mname = (low == 1) ? "M(x)" : "M(x) - M(l - 1)";
+	sprint_u192(phi_str, 0, global.sum_phi);
+	sprint_u192(spf_str, 0, global.sum_spf);
+	printf("\n"
+	       "Multiplicative functions of the values in {%lld, ..., %lld}\n"
+	       "\n"
+	       "The sum of mu is:                     %lld\n"
+	       "The largest value of %s is:  %lld, at x = %lld\n"
+	       "The smallest value of %s is: %lld, at x = %lld\n"
+	       "The number of squarefree values is:   %lld\n"
+	       "The sum of phi is:                    %s\n"
+	       "The sum of the smallest prime factors is: %s\n"
+	       "\n"
+	       "Number of values by number of distinct prime factors:\n",
+	       low, n, global.mertens, mname, global.mertens_max, global.arg_max,
+	       mname, global.mertens_min, global.arg_min, global.nsquarefree,
+	       phi_str, spf_str);
+	for (w = 0; w <= MF_MAX_OMEGA; w++) {
+	    if (global.nomega[w]) {
+		printf("    omega = %2d: %lld\n", w, global.nomega[w]);
+	    }
+	}
+	printf("Total elapsed time: %10.6f\n"
+	       "\n",
+	       elapsed);
+    }
+
+    return 0;
+}
@@ -0,0 +1,364 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "segsieve_helper.h"
+#include "multfcn_helper.h"
+
+static void alloc_mult_segment(mult_segment *seg, long long seg_len);
+static void free_mult_segment(mult_segment *seg);
+static void reset_mult_segment(mult_segment *seg);
+static long long divide_prime(mult_segment *seg, long long p, long long k);
+static long long divide_power(mult_segment *seg, long long p, long long q,
+			      long long k);
+static void divide_powers(mult_segment *seg, long long p, long long q,
+			  long long seg_high);
+static void finish_mult_segment(mult_segment *seg);
+static long long first_idx(long long q, long long low);
+static void mult_summary_reduce(void *invec, void *inoutvec, int *len,
+				MPI_Datatype *type);
+
+
+
+
+/* Compute spf, phi, mu, and omega for every value in {low, ..., high}, a
+ * segment of at most seg_len values at a time, and call fcn on each segment
+ * once it is done.
+ *
+ * Every cell starts with its value as the unfactored remainder rem and as
+ * phi.  For each prime p, each multiple of p has its remainder divided by p,
+ * phi multiplied by 1 - 1 / p (phi - phi / p is exact, since p still divides
+ * phi), mu negated, and omega incremented; each multiple of p^2, p^3, ... has
+ * its remainder divided by p once more and mu set to 0.  Only the primes up to
+ * the square root of the largest value in the segment are needed: what is left
+ * of the remainder afterwards has no prime factor up to the square root of its
+ * value, so it is 1 or a prime, which is accounted for at the end.
+ *
+ * As in sieve_range, the index of the next multiple of each odd prime is
+ * carried over from one segment to the next, and a prime is only made active
+ * once its square falls inside a segment.  The index is less than the prime,
+ * so it is kept as an int, which matters when there are tens of millions of
+ * sieving primes.  The far fewer multiples of 2 and of the powers of each
+ * prime are found by division.
+ *
+ * PRE: primes contains every odd prime up to sqrt(high) in increasing order
+ */
+
+void mult_sieve_range(long long low, long long high, long long seg_len,
+		      const int *primes, int nprimes,
+		      mult_segment_fcn fcn, void *data) {
+
+    mult_segment seg;
+    int *next;           // index of next multiple of each active prime
+    int nactive;         // primes[0], ..., primes[nactive - 1] are active
+    long long seg_high;  // largest value in the current segment
+    long long p;
+    int i;
+
+    if (low < 1) {
+	low = 1;
+    }
+    if (high < low) {
+	return;
+    }
+
+    alloc_mult_segment(&seg, seg_len);
+    next = malloc((nprimes + 1) * sizeof(int));
+    if (next == NULL) {
+	fprintf(stderr, "error allocating memory for sieving offsets\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    nactive = 0;
+
+    seg.low = low;
+    while (seg.low <= high) {
+
+	seg.len = (high - seg.low < seg_len) ? high - seg.low + 1 : seg_len;
+	seg_high = seg.low + seg.len - 1;
+
+	reset_mult_segment(&seg);
+	divide_powers(&seg, 2, 2, seg_high);
+
+	// Add the primes whose squares are now inside of the segment
+	while ((nactive < nprimes) && ((long long) primes[nactive] * primes[nactive] <= seg_high)) {
+	    next[nactive] = first_idx(primes[nactive], seg.low);
+	    nactive++;
+	}
+
+	for (i = 0; i < nactive; i++) {
+	    p = primes[i];
+	    next[i] = divide_prime(&seg, p, next[i]);
+	    divide_powers(&seg, p, p * p, seg_high);
+	}
+
+	finish_mult_segment(&seg);
+	fcn(&seg, data);
+
+	seg.low += seg.len;
+    }
+
+    free(next);
+    free_mult_segment(&seg);
+}
+
+
+
+
+/* Initialize *summary to describe an empty range */
+
+void init_mult_summary(mult_summary *summary) {
+    memset(summary, 0, sizeof(mult_summary));
+}
+
+
+
+
+/* Add the values of the segment, which must follow every value already in the
+ * mult_summary pointed to by data, to it.  May be passed to mult_sieve_range.
+ */
+
+void summarize_mult_segment(const mult_segment *seg, void *data) {
+
+    mult_summary *summary = data;
+    long long m = summary->mertens;  // running sum of mu
+    long long i;
+
+    for (i = 0; i < seg->len; i++) {
+	m += seg->mu[i];
+	if (!summary->arg_max || (m > summary->mertens_max)) {
+	    summary->mertens_max = m;
+	    summary->arg_max = seg->low + i;
+	}
+	if (!summary->arg_min || (m < summary->mertens_min)) {
+	    summary->mertens_min = m;
+	    summary->arg_min = seg->low + i;
+	}
+	summary->nsquarefree += (seg->mu[i] != 0);
+	summary->nomega[seg->omega[i]]++;
+	summary->sum_phi += seg->phi[i];
+	summary->sum_spf += seg->spf[i];
+    }
+    summary->mertens = m;
+}
+
+
+
+
+/* Add offset, the sum of mu over the values below the range of *summary, to
+ * the extremes of its running sum, so that they refer to the whole set rather
+ * than to the range alone.  The offsets of the ranges of the processes are
+ * found with MPI_Exscan.
+ */
+
+void shift_mult_summary(mult_summary *summary, long long offset) {
+    if (summary->arg_max) {
+	summary->mertens_max += offset;
+	summary->mertens_min += offset;
+    }
+}
+
+
+
+
+/* Create the MPI type of a mult_summary and a reduction operator that combines
+ * the summaries of disjoint ranges after shift_mult_summary.  Both should be
+ * freed by the caller.
+ */
+
+void create_mult_summary_op(MPI_Datatype *type, MPI_Op *op) {
+    MPI_Type_contiguous(sizeof(mult_summary), MPI_BYTE, type);
+    MPI_Type_commit(type);
+    MPI_Op_create(mult_summary_reduce, 1, op);
+}
+
+
+
+
+/* Allocate the arrays of a segment of up to seg_len values */
+
+static void alloc_mult_segment(mult_segment *seg, long long seg_len) {
+
+    seg->spf = malloc(seg_len * sizeof(long long));
+    seg->phi = malloc(seg_len * sizeof(long long));
+    seg->rem = malloc(seg_len * sizeof(long long));
+    seg->mu = malloc(seg_len * sizeof(signed char));
+    seg->omega = malloc(seg_len * sizeof(unsigned char));
+    if ((seg->spf == NULL) || (seg->phi == NULL) || (seg->rem == NULL)
+	|| (seg->mu == NULL) || (seg->omega == NULL)) {
+	fprintf(stderr, "error allocating memory for a segment\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+}
+
+
+
+
+/* Free the arrays of a segment */
+
+static void free_mult_segment(mult_segment *seg) {
+    free(seg->spf);
+    free(seg->phi);
+    free(seg->rem);
+    free(seg->mu);
+    free(seg->omega);
+}
+
+
+
+
+/* Set every cell of the segment to its state before any prime is divided out */
+
+static void reset_mult_segment(mult_segment *seg) {
+
+    long long i;
+
+    for (i = 0; i < seg->len; i++) {
+	seg->rem[i] = seg->low + i;
+	seg->phi[i] = seg->low + i;
+    }
+    memset(seg->spf, 0, seg->len * sizeof(long long));
+    memset(seg->mu, 1, seg->len * sizeof(signed char));
+    memset(seg->omega, 0, seg->len * sizeof(unsigned char));
+}
+
+
+
+
+/* Divide the prime p out of the multiples of p in the segment, starting at
+ * index k.  Return the index of the next multiple relative to the start of the
+ * following segment.
+ */
+
+static long long divide_prime(mult_segment *seg, long long p, long long k) {
+
+    for ( ; k < seg->len; k += p) {
+	seg->rem[k] /= p;
+	seg->phi[k] -= seg->phi[k] / p;
+	seg->mu[k] = -seg->mu[k];
+	seg->omega[k]++;
+	if (!seg->spf[k]) {
+	    seg->spf[k] = p;
+	}
+    }
+
+    return k - seg->len;
+}
+
+
+
+
+/* Divide the prime p out once more of the multiples of its power q in the
+ * segment, starting at index k, and set mu to 0 for them.  Return the index of
+ * the next multiple relative to the start of the following segment.
+ */
+
+static long long divide_power(mult_segment *seg, long long p, long long q,
+			      long long k) {
+
+    for ( ; k < seg->len; k += q) {
+	seg->rem[k] /= p;
+	seg->mu[k] = 0;
+    }
+
+    return k - seg->len;
+}
+
+
+
+
+/* Divide p out of the multiples of its powers q, q p, q p^2, ... up to
+ * seg_high, where q is p itself or a power p^e with e >= 2, finding the first
+ * multiple of each by division
+ */
+
+static void divide_powers(mult_segment *seg, long long p, long long q,
+			  long long seg_high) {
+    while (1) {
+	if (q == p) {
+	    divide_prime(seg, p, first_idx(p, seg->low));
+	}
+	else {
+	    divide_power(seg, p, q, first_idx(q, seg->low));
+	}
+	// case: the next power is past the segment (or would overflow)
+	if (q > seg_high / p) {
+	    break;
+	}
+	q *= p;
+    }
+}
+
+
+
+
+/* Account for the remainders left after every prime up to the square root of
+ * the largest value has been divided out.  Each is 1 or a prime; for the value
+ * 1, and for a prime value, it is also the smallest prime factor.
+ */
+
+static void finish_mult_segment(mult_segment *seg) {
+
+    long long i;
+
+    for (i = 0; i < seg->len; i++) {
+	if (seg->rem[i] > 1) {
+	    seg->phi[i] -= seg->phi[i] / seg->rem[i];
+	    seg->mu[i] = -seg->mu[i];
+	    seg->omega[i]++;
+	}
+	if (!seg->spf[i]) {
+	    seg->spf[i] = seg->rem[i];
+	}
+    }
+}
+
+
+
+
+/* Return the index of the first multiple of q that is >= low, relative to low */
+
+static long long first_idx(long long q, long long low) {
+    return (q - (low % q)) % q;
+}
+
+
+
+
+/* MPI user function: combine the summaries of disjoint ranges.  Ties between
+ * extremes go to the lower value, so that the result does not depend on the
+ * order of the combination.
+ */
+
+static void mult_summary_reduce(void *invec, void *inoutvec, int *len,
+				MPI_Datatype *type) {
+
+    mult_summary *in = invec;
+    mult_summary *inout = inoutvec;
+    int k;
+    int w;
+
+    for (k = 0; k < *len; k++, in++, inout++) {
+	if (in->arg_max
+	    && (!inout->arg_max || (in->mertens_max > inout->mertens_max)
+		|| ((in->mertens_max == inout->mertens_max) && (in->arg_max < inout->arg_max)))) {
+	    inout->mertens_max = in->mertens_max;
+	    inout->arg_max = in->arg_max;
+	}
+	if (in->arg_min
+	    && (!inout->arg_min || (in->mertens_min < inout->mertens_min)
+		|| ((in->mertens_min == inout->mertens_min) && (in->arg_min < inout->arg_min)))) {
+	    inout->mertens_min = in->mertens_min;
+	    inout->arg_min = in->arg_min;
+	}
+	inout->mertens += in->mertens;
+	inout->nsquarefree += in->nsquarefree;
+	for (w = 0; w <= MF_MAX_OMEGA; w++) {
+	    inout->nomega[w] += in->nomega[w];
+	}
+	inout->sum_phi += in->sum_phi;
+	inout->sum_spf += in->sum_spf;
+    }
+}
@@ -0,0 +1,61 @@
+#include <mpi.h>
+#include <stdint.h>
+
+#include "aggregate_helper.h"
+
+// Default number of values per segment of the multiplicative-function sieve
+#define MF_SEG_LEN  32768
+
+// omega(v) <= 15 for every v <= 1e18, since 2 * 3 * ... * 53 > 1e18
+#define MF_MAX_OMEGA  15
+
+/* One segment of the multiplicative-function sieve: cell i holds the value
+ * low + i, its smallest prime factor spf (1 for the value 1), Euler's totient
+ * phi, the Moebius function mu, and the number omega of its distinct prime
+ * factors.  rem is the part of each value not yet factored, which is only of
+ * use while the segment is sieved.
+ */
+typedef struct {
+    long long low;
+    long long len;
+    long long *spf;
+    long long *phi;
+    signed char *mu;
+    unsigned char *omega;
+    long long *rem;
+} mult_segment;
+
+/* Type of the function called by mult_sieve_range once a segment has been
+ * sieved
+ */
+typedef void (*mult_segment_fcn)(const mult_segment *seg, void *data);
+
+/* Summary of the multiplicative functions over a range of values.  mertens is
+ * the sum of mu over the range, and mertens_max and mertens_min are the
+ * extremes of its running sum, attained first at the values arg_max and
+ * arg_min (0 when the range is empty).  nomega[w] is the number of values with
+ * w distinct prime factors.
+ */
+typedef struct {
+    long long mertens;
+    long long mertens_max;
+    long long arg_max;
+    long long mertens_min;
+    long long arg_min;
+    long long nsquarefree;
+    long long nomega[MF_MAX_OMEGA + 1];
+    uint128_t sum_phi;
+    uint128_t sum_spf;
+} mult_summary;
+
+void mult_sieve_range(long long low, long long high, long long seg_len,
+		      const int *primes, int nprimes,
+		      mult_segment_fcn fcn, void *data);
+
+void init_mult_summary(mult_summary *summary);
+
+void summarize_mult_segment(const mult_segment *seg, void *data);
+
+void shift_mult_summary(mult_summary *summary, long long offset);
+
+void create_mult_summary_op(MPI_Datatype *type, MPI_Op *op);
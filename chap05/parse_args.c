@@ -74,3 +74,333 @@ void parse_args(int argc, char *argv[], int *d, int *n, int *p) {
 	}
     }
 }
+
+
+
+
+/* Parse user parameter specifications for the harmonic sums: the number of
+ * digits d, a possibly very large n, and the name of the method.  Each is
+ * written only if given.
+ */
+
+void parse_harmonic_args(int argc, char *argv[], int *d, long long *n,
+			 const char **method) {
+
+    int opt;        // argument type info
+    char* endptr;   // point to next char after int read (should point to '\0')
+
+    // To distinguish success / failure after a call to strtol or strtoll
+    errno = 0;
+
+    while ((opt = getopt(argc, argv, "d:n:m:")) != -1) {
+	switch (opt) {
+	case 'd':
+	    *d = strtol(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for d\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for d\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*d < 0) {
+		fprintf(stderr, "d must be >= 0\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'n':
+	    *n = strtoll(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*n < 2) {
+		fprintf(stderr, "n must be >= 2\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'm':
+	    *method = optarg;
+	    break;
+	case '?':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	case ':':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+    }
+}
+
+
+
+
+/* Parse user parameter specifications for the functional sieve: n as for
+ * parse_args, and the number nblocks of range blocks that the set is split
+ * into.  Each is written only if given.
+ */
+
+void parse_functional_args(int argc, char *argv[], int *n, int *nblocks) {
+
+    int opt;        // argument type info
+    char* endptr;   // point to next char after int read (should point to '\0')
+
+    // To distinguish success / failure after a call to strtol
+    errno = 0;
+
+    while ((opt = getopt(argc, argv, "n:b:")) != -1) {
+	switch (opt) {
+	case 'n':
+	    *n = strtol(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*n < 2) {
+		fprintf(stderr, "n must be >= 2\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'b':
+	    *nblocks = strtol(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for the number of blocks\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for the number of blocks\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*nblocks < 1) {
+		fprintf(stderr, "the number of blocks must be >= 1\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case '?':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	case ':':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+    }
+}
+
+
+
+
+/* Parse user parameter specifications for the segmented sieve: a possibly very
+ * large n, the name of the sieve engine, the index k of a prime to find, the
+ * flag aggregate, which is set by the option -a, the name outfile of a prime
+ * file to export the primes to, the interval in seconds between progress
+ * reports, the name status of the file that they are appended to, and the list
+ * of moduli whose residue classes the primes are counted in.  Each is written
+ * only if given.
+ */
+
+void parse_sieve_args(int argc, char *argv[], long long *n, const char **engine,
+		      long long *k, int *aggregate, const char **outfile,
+		      double *interval, const char **status, const char **moduli) {
+
+    int opt;        // argument type info
+    char* endptr;   // point to next char after int read (should point to '\0')
+
+    // To distinguish success / failure after a call to strtoll
+    errno = 0;
+
+    while ((opt = getopt(argc, argv, "n:e:k:ao:p:q:s:")) != -1) {
+	switch (opt) {
+	case 'n':
+	    *n = strtoll(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*n < 2) {
+		fprintf(stderr, "n must be >= 2\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'e':
+	    *engine = optarg;
+	    break;
+	case 'k':
+	    *k = strtoll(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for k\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for k\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*k < 1) {
+		fprintf(stderr, "k must be >= 1\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'a':
+	    *aggregate = 1;
+	    break;
+	case 'o':
+	    *outfile = optarg;
+	    break;
+	case 'p':
+	    *interval = strtod(optarg, &endptr);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for p\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (!(*interval > 0)) {
+		fprintf(stderr, "p must be > 0\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'q':
+	    *moduli = optarg;
+	    break;
+	case 's':
+	    *status = optarg;
+	    break;
+	case '?':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	case ':':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+    }
+}
+
+
+
+
+/* Parse user parameter specifications for the multiplicative-function sieve:
+ * the lowest value low and the largest value n of the set, and the number
+ * seg_len of values per segment.  Each is written only if given.
+ */
+
+void parse_mult_args(int argc, char *argv[], long long *low, long long *n,
+		     long long *seg_len) {
+
+    int opt;        // argument type info
+    char* endptr;   // point to next char after int read (should point to '\0')
+
+    // To distinguish success / failure after a call to strtoll
+    errno = 0;
+
+    while ((opt = getopt(argc, argv, "l:n:s:")) != -1) {
+	switch (opt) {
+	case 'l':
+	    *low = strtoll(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for l\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for l\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*low < 1) {
+		fprintf(stderr, "l must be >= 1\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 'n':
+	    *n = strtoll(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for n\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*n < 1) {
+		fprintf(stderr, "n must be >= 1\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case 's':
+	    *seg_len = strtoll(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for s\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for s\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*seg_len < 1) {
+		fprintf(stderr, "s must be >= 1\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case '?':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	case ':':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+    }
+}
+
+
+
+
+/* Parse user parameter specifications for the prime file reader: the name
+ * fname of the file, and the index k of a prime to look up.  Each is written
+ * only if given.
+ */
+
+void parse_read_args(int argc, char *argv[], const char **fname, long long *k) {
+
+    int opt;        // argument type info
+    char* endptr;   // point to next char after int read (should point to '\0')
+
+    // To distinguish success / failure after a call to strtoll
+    errno = 0;
+
+    while ((opt = getopt(argc, argv, "f:k:")) != -1) {
+	switch (opt) {
+	case 'f':
+	    *fname = optarg;
+	    break;
+	case 'k':
+	    *k = strtoll(optarg, &endptr, 10);
+	    if (*endptr != '\0') {
+		fprintf(stderr, "Invalid argument for k\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (errno != 0) {
+		fprintf(stderr, "Underflow / overflow for k\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    else if (*k < 1) {
+		fprintf(stderr, "k must be >= 1\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	    }
+	    break;
+	case '?':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	case ':':
+	    // Note: error message automatically written to stderr by getopt
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+    }
+}
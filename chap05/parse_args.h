@@ -1,2 +1,16 @@
 
 void parse_args(int argc, char* argv[], int *d, int *n, int *p);
+
+void parse_harmonic_args(int argc, char *argv[], int *d, long long *n,
+			 const char **method);
+
+void parse_functional_args(int argc, char *argv[], int *n, int *nblocks);
+
+void parse_sieve_args(int argc, char *argv[], long long *n, const char **engine,
+		      long long *k, int *aggregate, const char **outfile,
+		      double *interval, const char **status, const char **moduli);
+
+void parse_mult_args(int argc, char *argv[], long long *low, long long *n,
+		     long long *seg_len);
+
+void parse_read_args(int argc, char *argv[], const char **fname, long long *k);
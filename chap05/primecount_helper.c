@@ -0,0 +1,397 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "primecount_helper.h"
+
+#define EULER_GAMMA  0.57721566490153286061
+#define WINDOW_MIN   4096    // smallest correction window searched at a time
+
+/* Data passed through sieve_range to find_in_segment */
+typedef struct {
+    long long remaining;  // the prime wanted is the remaining-th one to come
+    long long result;     // the prime, once found
+} prime_search;
+
+static double li(double x);
+static long long locate_in_window(long long low, long long high, int upward,
+				  long long *need, const int *primes, int nprimes,
+				  int rank, int size);
+static void ensure_primes(long long high, int **primes, int *nprimes,
+			  long long *limit, int rank, int size);
+static void count_segment(const uint64_t *bits, long long seg_low,
+			  long long nown, long long nbits, void *data);
+static void find_in_segment(const uint64_t *bits, long long seg_low,
+			    long long nown, long long nbits, void *data);
+
+
+
+
+/* Sieve the odd values in {low, ..., high} with the given engine, a segment at a
+ * time, calling fcn after each segment as sieve_range does
+ */
+
+void engine_range(int engine, long long low, long long high, const int *primes,
+		  int nprimes, segment_fcn fcn, void *data) {
+
+    if (engine == ENGINE_ATKIN) {
+	atkin_range(low, high, SEG_NBITS, primes, nprimes, fcn, data);
+    }
+    else {
+	sieve_range(low, high, high, SEG_NBITS, 0, primes, nprimes, fcn, data);
+    }
+}
+
+
+
+
+/* The same as engine_range, but with progress reports through *pm unless pm is
+ * NULL.  Must then be called by every process of MPI_COMM_WORLD.
+ */
+
+void monitored_range(int engine, long long low, long long high, const int *primes,
+		     int nprimes, segment_fcn fcn, void *data,
+		     progress_monitor *pm) {
+
+    if (pm == NULL) {
+	engine_range(engine, low, high, primes, nprimes, fcn, data);
+	return;
+    }
+
+    start_progress(pm, low, high, fcn, data);
+    engine_range(engine, low, high, primes, nprimes, progress_segment, pm);
+    finish_progress(pm);
+}
+
+
+
+
+/* Return, on every process, the number of primes in {low, ..., high}.  The set
+ * is split into size contiguous blocks and each process counts the primes of
+ * its block with the given engine, reporting its progress through *pm unless
+ * pm is NULL.
+ *
+ * PRE: primes contains every odd prime up to sqrt(high) in increasing order
+ */
+
+long long count_range(int engine, long long low, long long high,
+		      const int *primes, int nprimes, int rank, int size,
+		      progress_monitor *pm) {
+
+    long long local_low;
+    long long local_high;
+    long long local_setsize;
+    long long nprime_local;
+    long long nprime_global;
+
+    local_set_params_ll(low, high, rank, size, &local_low, &local_high, &local_setsize);
+
+    nprime_local = 0;
+    monitored_range(engine, local_low, local_high, primes, nprimes,
+		    count_segment, &nprime_local, pm);
+
+    // The sieve only represents odd values, so the even prime 2 is added by hand
+    if (!rank && (low <= 2) && (high >= 2)) {
+	nprime_local++;
+    }
+
+    MPI_Allreduce(&nprime_local, &nprime_global, 1, MPI_LONG_LONG, MPI_SUM,
+		  MPI_COMM_WORLD);
+
+    return nprime_global;
+}
+
+
+
+
+/* Return the x > 2 with li(x) = y, found with Newton's method, for y >= 2.
+ * Since li'(x) = 1 / ln(x) each step is x -= (li(x) - y) ln(x), and starting
+ * from y ln(y), which is below the root, the iteration converges monotonically.
+ */
+
+double inverse_li(double y) {
+
+    double x;
+    double step;
+    int iter;
+
+    x = (y > 2) ? y * log(y) : 3;
+    for (iter = 0; iter < 100; iter++) {
+	step = (li(x) - y) * log(x);
+	x -= step;
+	if (fabs(step) < 1e-6 * x) {
+	    break;
+	}
+    }
+
+    return x;
+}
+
+
+
+
+/* Return the k-th prime, for k >= 1, on every process.
+ *
+ * The prime is first estimated as x = li^-1(k), whose error is of the order of
+ * sqrt(x) ln(x).  The primes up to x are then counted with the given engine,
+ * and the difference between the count and k says how many primes further on
+ * (or back) the k-th prime is.  Finally, that short window past (or before) x
+ * is sieved by all of the processes, each taking a slice of it, so that the
+ * whole query costs little more than the single count up to x.
+ *
+ * The estimate, the number of primes up to it, and the number of values in
+ * the correction windows searched are written to *estimate, *nprime_estimate,
+ * and *nwindow.  The progress of the count up to x is reported through *pm
+ * unless pm is NULL.
+ */
+
+long long nth_prime(int engine, long long k, int rank, int size,
+		    long long *estimate, long long *nprime_estimate,
+		    long long *nwindow, progress_monitor *pm) {
+
+    int *primes;        // odd primes up to limit
+    int nprimes;
+    long long limit;    // the sieving primes are those up to limit
+    long long x;
+    long long need;     // the prime wanted is the need-th one in its direction
+    long long width;    // width of the current window
+    long long low;
+    long long high;
+    long long result;
+
+    // case: the only even prime, which the odd-only sieves don't see
+    if (k == 1) {
+	*estimate = 2;
+	*nprime_estimate = 1;
+	*nwindow = 0;
+	return 2;
+    }
+
+    x = (long long) inverse_li((double) k);
+    if (x < 3) {
+	x = 3;
+    }
+    *estimate = x;
+
+    limit = 0;
+    primes = NULL;
+    nprimes = 0;
+    ensure_primes(x, &primes, &nprimes, &limit, rank, size);
+    *nprime_estimate = count_range(engine, 1, x, primes, nprimes, rank, size,
+				   pm);
+
+    /* The windows step away from x, each a bit wider than the expected distance
+     * to the prime, ln(x) per prime
+     */
+    *nwindow = 0;
+    result = 0;
+    if (*nprime_estimate >= k) {
+	need = *nprime_estimate - k + 1;
+	high = x;
+	while (!result) {
+	    width = (long long) (1.2 * (need + (2 * sqrt(need)) + 16) * log(x));
+	    width = (width < WINDOW_MIN) ? WINDOW_MIN : width;
+	    low = (high - width + 1 < 1) ? 1 : high - width + 1;
+	    *nwindow += high - low + 1;
+	    result = locate_in_window(low, high, 0, &need, primes, nprimes, rank, size);
+	    high = low - 1;
+	}
+    }
+    else {
+	need = k - *nprime_estimate;
+	low = x + 1;
+	while (!result) {
+	    width = (long long) (1.2 * (need + (2 * sqrt(need)) + 16) * log(x));
+	    width = (width < WINDOW_MIN) ? WINDOW_MIN : width;
+	    high = low + width - 1;
+	    ensure_primes(high, &primes, &nprimes, &limit, rank, size);
+	    *nwindow += high - low + 1;
+	    result = locate_in_window(low, high, 1, &need, primes, nprimes, rank, size);
+	    low = high + 1;
+	}
+    }
+
+    free(primes);
+
+    return result;
+}
+
+
+
+
+/* Return li(x) = int_0^x dt / ln(t) for x > 1, by Ramanujan's series
+ *
+ *     li(x) = gamma + ln ln x + sqrt(x) sum_{n >= 1} (-1)^{n - 1} (ln x)^n
+ *             / (n! 2^{n - 1}) sum_{j = 0}^{floor((n - 1) / 2)} 1 / (2j + 1)
+ *
+ * which converges for every x > 1, quickly enough for x up to 1e18.
+ */
+
+static double li(double x) {
+
+    double lnx = log(x);
+    double term = 1;     // (-1)^{n - 1} (ln x)^n / (n! 2^{n - 1}), up to sign
+    double inner = 0;    // sum_{j = 0}^{floor((n - 1) / 2)} 1 / (2j + 1)
+    double sum = 0;
+    int n;
+
+    for (n = 1; n < 1000; n++) {
+	term *= lnx / n;
+	if (n > 1) {
+	    term /= -2;
+	}
+	if (n % 2) {
+	    inner += 1.0 / n;
+	}
+	sum += term * inner;
+	if (fabs(term * inner) < 1e-17 * fabs(sum)) {
+	    break;
+	}
+    }
+
+    return EULER_GAMMA + log(lnx) + (sqrt(x) * sum);
+}
+
+
+
+
+/* Look for a prime in the window {low, ..., high}, split into size contiguous
+ * slices.  The prime wanted is the *need-th one counting up from low if upward
+ * is set, and counting down from high otherwise.  Return the prime on every
+ * process if the window contains it, and otherwise return 0 and reduce *need
+ * by the number of primes in the window.
+ */
+
+static long long locate_in_window(long long low, long long high, int upward,
+				  long long *need, const int *primes, int nprimes,
+				  int rank, int size) {
+
+    long long local_low;
+    long long local_high;
+    long long local_setsize;
+    long long count;        // number of primes in the local slice
+    long long *counts;      // number of primes in each slice
+    long long want;         // the prime is the want-th one counting up from low
+    long long total;
+    prime_search search;
+    int owner;              // the rank whose slice contains the prime
+    int r;
+
+    local_set_params_ll(low, high, rank, size, &local_low, &local_high, &local_setsize);
+    count = 0;
+    sieve_range(local_low, local_high, local_high, SEG_NBITS, 0, primes, nprimes,
+		count_segment, &count);
+    if (!rank && (low <= 2) && (high >= 2)) {
+	count++;
+    }
+
+    counts = malloc(size * sizeof(long long));
+    if (counts == NULL) {
+	fprintf(stderr, "error allocating memory for the window counts\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    MPI_Allgather(&count, 1, MPI_LONG_LONG, counts, 1, MPI_LONG_LONG, MPI_COMM_WORLD);
+    total = 0;
+    for (r = 0; r < size; r++) {
+	total += counts[r];
+    }
+
+    // case: the prime is past the window
+    if (total < *need) {
+	*need -= total;
+	free(counts);
+	return 0;
+    }
+
+    // Find the slice that holds the want-th prime from low, and its index there
+    want = upward ? *need : total - *need + 1;
+    for (owner = 0; want > counts[owner]; owner++) {
+	want -= counts[owner];
+    }
+    free(counts);
+
+    search.result = 0;
+    if (rank == owner) {
+	if (!rank && (low <= 2) && (high >= 2)) {
+	    want--;
+	    search.result = (want == 0) ? 2 : 0;
+	}
+	if (!search.result) {
+	    search.remaining = want;
+	    sieve_range(local_low, local_high, local_high, SEG_NBITS, 0, primes, nprimes,
+			find_in_segment, &search);
+	}
+    }
+    MPI_Bcast(&search.result, 1, MPI_LONG_LONG, owner, MPI_COMM_WORLD);
+
+    return search.result;
+}
+
+
+
+
+/* Make sure that *primes holds every odd prime up to sqrt(high), gathering the
+ * primes again with some room to spare if it does not
+ */
+
+static void ensure_primes(long long high, int **primes, int *nprimes,
+			  long long *limit, int rank, int size) {
+
+    long long rooth = isqrt_ll(high);
+
+    if (rooth <= *limit) {
+	return;
+    }
+
+    free(*primes);
+    *limit = rooth + (rooth / 8) + 16;
+    *nprimes = gather_sieving_primes((int) *limit, rank, size, primes);
+}
+
+
+
+
+/* Add the number of primes among the values that the segment is responsible
+ * for to the long long pointed to by data
+ */
+
+static void count_segment(const uint64_t *bits, long long seg_low,
+			  long long nown, long long nbits, void *data) {
+
+    *(long long *) data += count_bits(bits, nown);
+}
+
+
+
+
+/* Count down the primes of the segment until the one that the prime_search
+ * pointed to by data is looking for, and record it
+ */
+
+static void find_in_segment(const uint64_t *bits, long long seg_low,
+			    long long nown, long long nbits, void *data) {
+
+    prime_search *search = data;
+    long long count;
+    long long k;
+
+    if (search->result) {
+	return;
+    }
+
+    count = count_bits(bits, nown);
+    if (count < search->remaining) {
+	search->remaining -= count;
+	return;
+    }
+
+    for (k = 0; k < nown; k++) {
+	if (SEG_TEST(bits, k) && (--search->remaining == 0)) {
+	    search->result = seg_low + (2 * k);
+	    return;
+	}
+    }
+}
@@ -0,0 +1,22 @@
+#include "atkin_helper.h"
+#include "progress_helper.h"
+
+#define ENGINE_ERAT   0  // segmented Sieve of Eratosthenes
+#define ENGINE_ATKIN  1  // segmented Sieve of Atkin
+
+void engine_range(int engine, long long low, long long high, const int *primes,
+		  int nprimes, segment_fcn fcn, void *data);
+
+void monitored_range(int engine, long long low, long long high, const int *primes,
+		     int nprimes, segment_fcn fcn, void *data,
+		     progress_monitor *pm);
+
+long long count_range(int engine, long long low, long long high,
+		      const int *primes, int nprimes, int rank, int size,
+		      progress_monitor *pm);
+
+double inverse_li(double y);
+
+long long nth_prime(int engine, long long k, int rank, int size,
+		    long long *estimate, long long *nprime_estimate,
+		    long long *nwindow, progress_monitor *pm);
@@ -0,0 +1,428 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "segsieve_helper.h"
+#include "primefile_helper.h"
+
+#define IO_CHUNK  (1LL << 30)  // largest number of bytes per MPI-IO call
+
+static void export_prime(long long p, void *data);
+static void check_io(int err, const char *what, const char *fname);
+static void check_file(int ok, const char *fname, const char *what);
+static void check_index(const prime_file_header *hdr,
+			const prime_index_entry *index, const char *fname);
+static void write_at_all_chunked(MPI_File fh, MPI_Offset offset, const void *buf,
+				 long long len, MPI_Comm comm);
+
+
+
+
+/* Initialize *exp to hold no primes, to be split into blocks of block_len */
+
+void init_prime_export(prime_export *exp, long long block_len) {
+
+    memset(exp, 0, sizeof(prime_export));
+    exp->block_len = block_len;
+    exp->cap = 1 << 16;
+    exp->data = malloc(exp->cap);
+    exp->index_cap = 64;
+    exp->index = malloc(exp->index_cap * sizeof(prime_index_entry));
+    if ((exp->data == NULL) || (exp->index == NULL)) {
+	fprintf(stderr, "error allocating memory for the encoded primes\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+}
+
+
+
+
+/* Encode the prime p, which must be larger than every prime already in *exp.
+ * p starts a new block if the current one is full; otherwise half of its gap
+ * to the previous prime is appended as a varint.
+ */
+
+void add_export_prime(prime_export *exp, long long p) {
+
+    uint64_t gap;
+
+    // case: first prime of a block; only its index entry is written
+    if (!exp->nblocks || (exp->nfill == exp->block_len)) {
+	if (exp->nblocks == exp->index_cap) {
+	    exp->index_cap *= 2;
+	    exp->index = realloc(exp->index, exp->index_cap * sizeof(prime_index_entry));
+	    if (exp->index == NULL) {
+		fprintf(stderr, "error allocating memory for the prime index\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	    }
+	}
+	exp->index[exp->nblocks].first = p;
+	exp->index[exp->nblocks].first_idx = exp->count;
+	exp->index[exp->nblocks].offset = exp->len;
+	exp->nblocks++;
+	exp->nfill = 0;
+    }
+    else {
+	if (exp->len + PRIME_VARINT_MAX > exp->cap) {
+	    exp->cap *= 2;
+	    exp->data = realloc(exp->data, exp->cap);
+	    if (exp->data == NULL) {
+		fprintf(stderr, "error allocating memory for the encoded primes\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	    }
+	}
+	gap = (exp->last == 2) ? 0 : (p - exp->last) / 2;
+	while (gap >= 0x80) {
+	    exp->data[exp->len++] = (gap & 0x7f) | 0x80;
+	    gap >>= 7;
+	}
+	exp->data[exp->len++] = gap;
+    }
+
+    exp->nfill++;
+    exp->count++;
+    exp->last = p;
+}
+
+
+
+
+/* Encode the primes among the values that the segment is responsible for into
+ * the prime_export pointed to by data.  May be passed to sieve_range or
+ * atkin_range.
+ */
+
+void export_segment(const uint64_t *bits, long long seg_low,
+		    long long nown, long long nbits, void *data) {
+    for_each_prime(bits, seg_low, nown, export_prime, data);
+}
+
+
+
+
+/* Write the primes encoded by the processes of comm, in rank order, to the
+ * prime file fname, replacing any file of that name.  Must be called by every
+ * process of comm.
+ *
+ * The file offset of each process's data, and the position of its entries in
+ * the index, are found with MPI_Exscan over the numbers of bytes and blocks of
+ * the processes before it, and the data and the index are then written with
+ * collective writes, so that nothing passes through a single process.  The
+ * index entries of *exp are made absolute in the process.
+ */
+
+void write_prime_file(prime_export *exp, const char *fname, long long n,
+		      MPI_Comm comm) {
+
+    prime_file_header hdr;
+    MPI_File fh;
+    long long local[3];    // bytes, blocks, and primes of this process
+    long long before[3];   // the same, summed over the processes before it
+    long long total[3];    // the same, summed over all of the processes
+    MPI_Offset data_offset;
+    MPI_Offset index_offset;
+    int rank;
+    long long b;
+
+    MPI_Comm_rank(comm, &rank);
+
+    local[0] = exp->len;
+    local[1] = exp->nblocks;
+    local[2] = exp->count;
+    MPI_Exscan(local, before, 3, MPI_LONG_LONG, MPI_SUM, comm);
+    // The result of MPI_Exscan is undefined on process 0
+    if (!rank) {
+	before[0] = before[1] = before[2] = 0;
+    }
+    MPI_Allreduce(local, total, 3, MPI_LONG_LONG, MPI_SUM, comm);
+
+    data_offset = sizeof(prime_file_header) + before[0];
+    index_offset = sizeof(prime_file_header) + total[0];
+    for (b = 0; b < exp->nblocks; b++) {
+	exp->index[b].first_idx += before[2];
+	exp->index[b].offset += data_offset;
+    }
+
+    check_io(MPI_File_open(comm, fname, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+			   MPI_INFO_NULL, &fh),
+	     "opening", fname);
+    write_at_all_chunked(fh, data_offset, exp->data, exp->len, comm);
+    write_at_all_chunked(fh, index_offset + (before[1] * sizeof(prime_index_entry)),
+			 exp->index, exp->nblocks * sizeof(prime_index_entry), comm);
+
+    if (!rank) {
+	memset(&hdr, 0, sizeof(prime_file_header));
+	memcpy(hdr.magic, PRIME_FILE_MAGIC, sizeof(hdr.magic));
+	hdr.n = n;
+	hdr.nprimes = total[2];
+	hdr.nblocks = total[1];
+	hdr.block_len = exp->block_len;
+	hdr.data_offset = sizeof(prime_file_header);
+	hdr.index_offset = index_offset;
+	check_io(MPI_File_write_at(fh, 0, &hdr, sizeof(prime_file_header), MPI_BYTE,
+				   MPI_STATUS_IGNORE),
+		 "writing", fname);
+    }
+
+    // Cut off what is left of a longer file of the same name
+    check_io(MPI_File_set_size(fh, index_offset + (total[1] * sizeof(prime_index_entry))),
+	     "resizing", fname);
+    MPI_File_close(&fh);
+}
+
+
+
+
+/* Free the buffers of *exp */
+
+void free_prime_export(prime_export *exp) {
+    free(exp->data);
+    free(exp->index);
+}
+
+
+
+
+/* Open the prime file fname for reading by the processes of comm, write its
+ * header to *hdr, and store its index in a newly allocated array pointed to by
+ * *index.  Return the file handle, which should be closed by the caller.
+ *
+ * Abort if the file is too short for its header and index, or if the header
+ * or the index do not describe a consistent layout, so that the offsets and
+ * counts can be trusted by the caller.  The encoded gaps themselves are only
+ * checked as they are decoded.
+ */
+
+MPI_File open_prime_file(const char *fname, MPI_Comm comm,
+			 prime_file_header *hdr, prime_index_entry **index) {
+
+    MPI_File fh;
+    MPI_Offset size;
+
+    check_io(MPI_File_open(comm, fname, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh),
+	     "opening", fname);
+    check_io(MPI_File_get_size(fh, &size), "sizing", fname);
+    check_file(size >= (MPI_Offset) sizeof(prime_file_header), fname,
+	       "too short for a header");
+    read_at_all_chunked(fh, 0, hdr, sizeof(prime_file_header), comm);
+    if (memcmp(hdr->magic, PRIME_FILE_MAGIC, sizeof(hdr->magic))) {
+	fprintf(stderr, "\"%s\" is not a prime file\n", fname);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    check_file((hdr->block_len >= 1) && (hdr->block_len <= PRIME_BLOCK_MAX), fname,
+	       "implausible block length");
+    check_file((hdr->nblocks >= 1) && (hdr->nblocks <= hdr->nprimes)
+	       && ((hdr->nprimes - 1) / hdr->block_len < hdr->nblocks), fname,
+	       "numbers of blocks and primes do not match");
+    check_file((hdr->n >= 2) && (hdr->n <= LLONG_MAX / 2) && (hdr->nprimes <= hdr->n),
+	       fname, "implausible n");
+    check_file((hdr->data_offset >= sizeof(prime_file_header))
+	       && (hdr->data_offset <= hdr->index_offset)
+	       && (hdr->index_offset <= (uint64_t) size)
+	       && (hdr->nblocks <= ((uint64_t) size - hdr->index_offset)
+		   / sizeof(prime_index_entry)), fname,
+	       "data and index do not fit in the file");
+
+    *index = malloc((hdr->nblocks + 1) * sizeof(prime_index_entry));
+    if (*index == NULL) {
+	fprintf(stderr, "error allocating memory for the prime index\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    read_at_all_chunked(fh, hdr->index_offset, *index,
+			hdr->nblocks * sizeof(prime_index_entry), comm);
+    check_index(hdr, *index, fname);
+
+    return fh;
+}
+
+
+
+
+/* Read len bytes at offset of fh into buf with as many collective reads as it
+ * takes, each of at most IO_CHUNK bytes.  Every process of comm must call it,
+ * with len possibly 0.
+ */
+
+void read_at_all_chunked(MPI_File fh, MPI_Offset offset, void *buf, long long len,
+			 MPI_Comm comm) {
+
+    long long nchunks = (len + IO_CHUNK - 1) / IO_CHUNK;
+    long long max_nchunks;
+    long long count;
+    MPI_Status status;
+    int nread;
+    long long i;
+
+    MPI_Allreduce(&nchunks, &max_nchunks, 1, MPI_LONG_LONG, MPI_MAX, comm);
+    for (i = 0; i < max_nchunks; i++) {
+	count = len - (i * IO_CHUNK);
+	count = (count < 0) ? 0 : ((count > IO_CHUNK) ? IO_CHUNK : count);
+	check_io(MPI_File_read_at_all(fh, offset + (i * IO_CHUNK),
+				      (char *) buf + ((count > 0) ? i * IO_CHUNK : 0),
+				      count, MPI_BYTE, &status),
+		 "reading", "prime file");
+	MPI_Get_count(&status, MPI_BYTE, &nread);
+	if (nread != count) {
+	    fprintf(stderr, "error reading prime file: read %d of %lld bytes at offset %lld\n",
+		    nread, count, (long long) (offset + (i * IO_CHUNK)));
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	}
+    }
+}
+
+
+
+
+/* Decode the count primes of a block whose first prime is first and whose
+ * encoded gaps start at buf and end before end, store them in primes, and
+ * return the position right after the block.  Most half gaps fit in a single
+ * byte, which is handled before the general loop.  Return NULL if the gaps run
+ * past end, if a varint is longer than PRIME_VARINT_MAX bytes, or if a prime
+ * overflows, all of which only happen in a corrupt file.
+ */
+
+const unsigned char *decode_prime_block(const unsigned char *buf,
+					const unsigned char *end, long long first,
+					long long count, long long *primes) {
+
+    const unsigned char *stop;  // end of the longest varint that fits
+    long long p = first;
+    uint64_t gap;
+    int shift;
+    long long i;
+
+    if (count > 0) {
+	primes[0] = first;
+    }
+    for (i = 1; i < count; i++) {
+	if (buf == end) {
+	    return NULL;
+	}
+	else if (*buf < 0x80) {
+	    gap = *buf++;
+	}
+	else {
+	    stop = (end - buf > PRIME_VARINT_MAX) ? buf + PRIME_VARINT_MAX : end;
+	    gap = 0;
+	    shift = 0;
+	    do {
+		if (buf == stop) {
+		    return NULL;
+		}
+		gap |= (uint64_t) (*buf & 0x7f) << shift;
+		shift += 7;
+	    } while (*buf++ & 0x80);
+	    if (gap > (uint64_t) (LLONG_MAX - p) / 2) {
+		return NULL;
+	    }
+	}
+	p += gap ? 2 * gap : 1;
+	primes[i] = p;
+    }
+
+    return buf;
+}
+
+
+
+
+/* Encode the prime p into the prime_export pointed to by data; the prime_fcn
+ * passed to for_each_prime by export_segment
+ */
+
+static void export_prime(long long p, void *data) {
+    add_export_prime(data, p);
+}
+
+
+
+
+/* Abort with a message naming the operation what and the file fname if err is
+ * an MPI error code
+ */
+
+static void check_io(int err, const char *what, const char *fname) {
+
+    char msg[MPI_MAX_ERROR_STRING];
+    int len;
+
+    if (err != MPI_SUCCESS) {
+	MPI_Error_string(err, msg, &len);
+	fprintf(stderr, "error %s \"%s\": %s\n", what, fname, msg);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+}
+
+
+
+
+/* Abort with a message saying that the prime file fname is corrupt, and what
+ * is wrong with it, unless ok
+ */
+
+static void check_file(int ok, const char *fname, const char *what) {
+    if (!ok) {
+	fprintf(stderr, "\"%s\" is corrupt: %s\n", fname, what);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+}
+
+
+
+
+/* Check that the entries of index lie in the order and within the bounds that
+ * hdr gives them: the offsets increase from data_offset up to index_offset,
+ * the prime indices increase from 0 up to nprimes in steps of at most
+ * block_len, and the first primes increase up to n
+ */
+
+static void check_index(const prime_file_header *hdr,
+			const prime_index_entry *index, const char *fname) {
+
+    uint64_t b;
+
+    check_file((index[0].offset == hdr->data_offset) && (index[0].first_idx == 0),
+	       fname, "the first block is not at the start of the data");
+    for (b = 0; b < hdr->nblocks; b++) {
+	check_file((index[b].first >= 2) && (index[b].first <= hdr->n)
+		   && (index[b].first_idx < hdr->nprimes)
+		   && (index[b].offset <= hdr->index_offset), fname,
+		   "index entry out of range");
+	check_file((b == 0) || ((index[b].first > index[b - 1].first)
+				&& (index[b].first_idx > index[b - 1].first_idx)
+				&& (index[b].first_idx - index[b - 1].first_idx <= hdr->block_len)
+				&& (index[b].offset >= index[b - 1].offset)), fname,
+		   "index entries out of order");
+    }
+    check_file(hdr->nprimes - index[hdr->nblocks - 1].first_idx <= hdr->block_len,
+	       fname, "the last block is too long");
+}
+
+
+
+
+/* The counterpart of read_at_all_chunked for writing */
+
+static void write_at_all_chunked(MPI_File fh, MPI_Offset offset, const void *buf,
+				 long long len, MPI_Comm comm) {
+
+    long long nchunks = (len + IO_CHUNK - 1) / IO_CHUNK;
+    long long max_nchunks;
+    long long count;
+    long long i;
+
+    MPI_Allreduce(&nchunks, &max_nchunks, 1, MPI_LONG_LONG, MPI_MAX, comm);
+    for (i = 0; i < max_nchunks; i++) {
+	count = len - (i * IO_CHUNK);
+	count = (count < 0) ? 0 : ((count > IO_CHUNK) ? IO_CHUNK : count);
+	check_io(MPI_File_write_at_all(fh, offset + (i * IO_CHUNK),
+				       (const char *) buf + ((count > 0) ? i * IO_CHUNK : 0),
+				       count, MPI_BYTE, MPI_STATUS_IGNORE),
+		 "writing", "prime file");
+    }
+}
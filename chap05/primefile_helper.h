@@ -0,0 +1,77 @@
+#include <mpi.h>
+#include <stdint.h>
+
+/* A prime file holds the primes up to some n in increasing order.  It starts
+ * with a prime_file_header, followed by the encoded primes, and ends with an
+ * index of the blocks that the primes are split into.  Each block holds at
+ * most block_len primes: the first is given by its index entry, and each of
+ * the others is stored as a varint (7 bits per byte, least significant group
+ * first, the high bit set on every byte but the last) of half its gap to the
+ * previous prime.  The gap of 1 from 2 to 3 is stored as 0.  Blocks can thus
+ * be decoded independently of each other.  The header and the index are in
+ * the byte order of the machine that wrote the file.
+ */
+
+#define PRIME_FILE_MAGIC    "PRIMGAP1"
+#define PRIME_BLOCK_LEN     65536  // default number of primes per block
+#define PRIME_VARINT_MAX    10     // largest number of bytes of a varint
+#define PRIME_BLOCK_MAX   (1 << 24)  // largest block_len accepted when reading
+
+typedef struct {
+    char magic[8];
+    uint64_t n;             // the file holds the primes up to n
+    uint64_t nprimes;       // number of primes in the file
+    uint64_t nblocks;       // number of blocks, and of index entries
+    uint64_t block_len;     // largest number of primes in a block
+    uint64_t data_offset;   // file offset of the first block
+    uint64_t index_offset;  // file offset of the index
+    uint64_t reserved;
+} prime_file_header;
+
+/* Index entry of a block: its first prime, the index (counted from 0) of that
+ * prime among all the primes of the file, and the file offset of the block's
+ * encoded gaps.  The block ends where the next one starts, or at the index.
+ */
+typedef struct {
+    uint64_t first;
+    uint64_t first_idx;
+    uint64_t offset;
+} prime_index_entry;
+
+/* The encoded primes of one process, along with the index of its blocks, whose
+ * offsets are relative to the start of its data until it is written
+ */
+typedef struct {
+    unsigned char *data;
+    long long len;
+    long long cap;
+    prime_index_entry *index;
+    long long nblocks;
+    long long index_cap;
+    long long block_len;
+    long long nfill;         // number of primes in the current block
+    long long count;         // number of primes encoded
+    long long last;          // last prime encoded
+} prime_export;
+
+void init_prime_export(prime_export *exp, long long block_len);
+
+void add_export_prime(prime_export *exp, long long p);
+
+void export_segment(const uint64_t *bits, long long seg_low,
+		    long long nown, long long nbits, void *data);
+
+void write_prime_file(prime_export *exp, const char *fname, long long n,
+		      MPI_Comm comm);
+
+void free_prime_export(prime_export *exp);
+
+MPI_File open_prime_file(const char *fname, MPI_Comm comm,
+			 prime_file_header *hdr, prime_index_entry **index);
+
+void read_at_all_chunked(MPI_File fh, MPI_Offset offset, void *buf, long long len,
+			 MPI_Comm comm);
+
+const unsigned char *decode_prime_block(const unsigned char *buf,
+					const unsigned char *end, long long first,
+					long long count, long long *primes);
@@ -0,0 +1,250 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "progress_helper.h"
+
+static void start_exchange(progress_monitor *pm, int finished);
+static int all_finished(const progress_monitor *pm);
+static void write_report(const progress_monitor *pm);
+
+
+
+
+/* Set up *pm to report every interval seconds to the status file fname, or to
+ * stdout if fname is NULL.  Must be called by every process of MPI_COMM_WORLD.
+ */
+
+void init_progress(progress_monitor *pm, double interval, const char *fname) {
+
+    memset(pm, 0, sizeof(progress_monitor));
+    MPI_Comm_dup(MPI_COMM_WORLD, &pm->comm);
+    MPI_Comm_rank(pm->comm, &pm->rank);
+    MPI_Comm_size(pm->comm, &pm->size);
+    pm->interval = interval;
+    pm->fname = fname;
+
+    pm->all = malloc(pm->size * PROG_NFIELDS * sizeof(double));
+    if (pm->all == NULL) {
+	fprintf(stderr, "error allocating memory for progress reports\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+}
+
+
+
+
+/* Reset the counters of *pm for the sieving of the odd values in {low, ...,
+ * high} by this process, passing each segment on to fcn with data
+ */
+
+void start_progress(progress_monitor *pm, long long low, long long high,
+		    segment_fcn fcn, void *data) {
+
+    low += !(low % 2);
+    pm->total = (high < low) ? 0 : ((high - low) / 2) + 1;
+    pm->done = 0;
+    pm->nsegments = 0;
+    pm->nprimes = 0;
+    pm->fcn = fcn;
+    pm->data = data;
+    pm->start = MPI_Wtime();
+    pm->next = pm->start + pm->interval;
+}
+
+
+
+
+/* Segment function that wraps the one given to start_progress.  After passing
+ * the segment on and counting it, either test for the completion of the
+ * exchange under way, reporting it if it is done, or start a new exchange if
+ * it is time for one.
+ */
+
+void progress_segment(const uint64_t *bits, long long seg_low,
+		      long long nown, long long nbits, void *data) {
+
+    progress_monitor *pm = data;
+    int flag;
+
+    pm->fcn(bits, seg_low, nown, nbits, pm->data);
+
+    pm->done += nown;
+    pm->nsegments++;
+    pm->nprimes += count_bits(bits, nown);
+
+    if (pm->active) {
+	MPI_Test(&pm->req, &flag, MPI_STATUS_IGNORE);
+	if (flag) {
+	    pm->active = 0;
+	    write_report(pm);
+	}
+    }
+    else if (MPI_Wtime() >= pm->next) {
+	start_exchange(pm, 0);
+	pm->next += pm->interval;
+    }
+}
+
+
+
+
+/* Take part in exchanges until one of them shows that every process is done
+ * with its range, which must be called by every process of MPI_COMM_WORLD
+ * once it is.
+ *
+ * Since the processes start exchanges at their own pace, they may have started
+ * different numbers of them.  Collectives are matched in order though, so a
+ * process that is done keeps starting exchanges, marked as finished, and
+ * waits for each to complete.  All of the processes see the same snapshots
+ * in every exchange, so they all stop after the same one, the first whose
+ * snapshots are all marked as finished.
+ */
+
+void finish_progress(progress_monitor *pm) {
+
+    do {
+	if (pm->active) {
+	    MPI_Wait(&pm->req, MPI_STATUS_IGNORE);
+	    pm->active = 0;
+	    write_report(pm);
+	    if (all_finished(pm)) {
+		break;
+	    }
+	}
+	start_exchange(pm, 1);
+    } while (1);
+}
+
+
+
+
+/* Free the communicator and buffers of *pm */
+
+void free_progress(progress_monitor *pm) {
+    MPI_Comm_free(&pm->comm);
+    free(pm->all);
+}
+
+
+
+
+/* Start an exchange of snapshots of the counters of the processes */
+
+static void start_exchange(progress_monitor *pm, int finished) {
+
+    pm->snapshot[PROG_DONE] = pm->done;
+    pm->snapshot[PROG_TOTAL] = pm->total;
+    pm->snapshot[PROG_SEGMENTS] = pm->nsegments;
+    pm->snapshot[PROG_PRIMES] = pm->nprimes;
+    pm->snapshot[PROG_ELAPSED] = MPI_Wtime() - pm->start;
+    pm->snapshot[PROG_FINISHED] = finished;
+
+    MPI_Iallgather(pm->snapshot, PROG_NFIELDS, MPI_DOUBLE, pm->all, PROG_NFIELDS,
+		   MPI_DOUBLE, pm->comm, &pm->req);
+    pm->active = 1;
+}
+
+
+
+
+/* Return whether every snapshot of the last exchange is marked as finished */
+
+static int all_finished(const progress_monitor *pm) {
+
+    int r;
+
+    for (r = 0; r < pm->size; r++) {
+	if (!pm->all[(r * PROG_NFIELDS) + PROG_FINISHED]) {
+	    return 0;
+	}
+    }
+
+    return 1;
+}
+
+
+
+
+/* Append a line describing the last exchange to the status file, on process 0
+ * only.  The throughput is the sum over the processes of their values per
+ * second.  The slowest process is the one with the smallest fraction of its
+ * range done, and the time left is the longest of the times that the
+ * processes would take to finish at their current rates.  It is unknown while
+ * any process with values left has not done any yet, whatever the order of
+ * the processes.
+ */
+
+static void write_report(const progress_monitor *pm) {
+
+    const double *snap;
+    double done = 0;
+    double total = 0;
+    double nprimes = 0;
+    double nsegments = 0;
+    double rate = 0;       // values per second, over all processes
+    double eta = 0;        // seconds left, over the processes that have started
+    double elapsed = 0;    // seconds since the start of the range
+    double frac;
+    double slowest_frac = 2;
+    int slowest = 0;
+    int unstarted = 0;     // whether some process has values left but none done
+    FILE *out;
+    int r;
+
+    if (pm->rank) {
+	return;
+    }
+
+    for (r = 0; r < pm->size; r++) {
+	snap = pm->all + (r * PROG_NFIELDS);
+	done += snap[PROG_DONE];
+	total += snap[PROG_TOTAL];
+	nsegments += snap[PROG_SEGMENTS];
+	nprimes += snap[PROG_PRIMES];
+	elapsed = (snap[PROG_ELAPSED] > elapsed) ? snap[PROG_ELAPSED] : elapsed;
+	if (snap[PROG_ELAPSED] > 0) {
+	    rate += snap[PROG_DONE] / snap[PROG_ELAPSED];
+	}
+	// case: the process has values left; estimate the time it needs
+	if (snap[PROG_DONE] < snap[PROG_TOTAL]) {
+	    if (snap[PROG_DONE] > 0) {
+		frac = (snap[PROG_TOTAL] - snap[PROG_DONE]) * snap[PROG_ELAPSED] / snap[PROG_DONE];
+		eta = (frac > eta) ? frac : eta;
+	    }
+	    else {
+		unstarted = 1;
+	    }
+	}
+	frac = (snap[PROG_TOTAL] > 0) ? snap[PROG_DONE] / snap[PROG_TOTAL] : 1;
+	if (frac < slowest_frac) {
+	    slowest_frac = frac;
+	    slowest = r;
+	}
+    }
+
+    out = stdout;
+    if ((pm->fname != NULL) && ((out = fopen(pm->fname, "a")) == NULL)) {
+	fprintf(stderr, "error opening \"%s\" for appending\n", pm->fname);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    fprintf(out, "[%10.1f s] %5.1f%% of %.3e values, %.0f segments, %.0f primes, "
+	    "%.3e values/s, ", elapsed, (total > 0) ? 100 * done / total : 100.0,
+	    total, nsegments, nprimes, rate);
+    if (unstarted) {
+	fprintf(out, "ETA unknown, ");
+    }
+    else {
+	fprintf(out, "ETA %.1f s, ", eta);
+    }
+    fprintf(out, "slowest rank %d at %.1f%%\n", slowest, 100 * slowest_frac);
+    if (out != stdout) {
+	fclose(out);
+    }
+    else {
+	fflush(out);
+    }
+}
@@ -0,0 +1,53 @@
+#include <mpi.h>
+#include <stdint.h>
+
+#include "segsieve_helper.h"
+
+// Fields of the snapshot that each process contributes to a progress report
+#define PROG_DONE      0  // odd values sieved so far
+#define PROG_TOTAL     1  // odd values to sieve
+#define PROG_SEGMENTS  2  // segments sieved so far
+#define PROG_PRIMES    3  // primes found so far
+#define PROG_ELAPSED   4  // seconds since the start of the range
+#define PROG_FINISHED  5  // 1 once the process is done with the range
+#define PROG_NFIELDS   6
+
+/* Periodic progress reports of a sieve run.  progress_segment is passed to the
+ * sieve in place of the segment function fcn, which it calls before updating
+ * the counters of the process.  About every interval seconds the processes
+ * exchange snapshots of their counters with a nonblocking MPI_Iallgather on a
+ * communicator of their own, which is only tested between segments, and
+ * process 0 appends a line to the status file fname (or to stdout if NULL)
+ * once the exchange has completed.
+ */
+typedef struct {
+    MPI_Comm comm;
+    int rank;
+    int size;
+    double interval;
+    const char *fname;
+    segment_fcn fcn;
+    void *data;
+    double start;         // MPI_Wtime at the start of the range
+    double next;          // time at which to start the next exchange
+    long long total;
+    long long done;
+    long long nsegments;
+    long long nprimes;
+    double snapshot[PROG_NFIELDS];
+    double *all;          // the snapshots of every process
+    MPI_Request req;
+    int active;           // whether an exchange is under way
+} progress_monitor;
+
+void init_progress(progress_monitor *pm, double interval, const char *fname);
+
+void start_progress(progress_monitor *pm, long long low, long long high,
+		    segment_fcn fcn, void *data);
+
+void progress_segment(const uint64_t *bits, long long seg_low,
+		      long long nown, long long nbits, void *data);
+
+void finish_progress(progress_monitor *pm);
+
+void free_progress(progress_monitor *pm);
@@ -0,0 +1,264 @@
+/* Reads back a prime file written by sieve_seg -o (see primefile_helper.h).
+ *
+ * By default every block of the file is decoded and checked: the blocks are
+ * split among the processes, each of which reads the encoded gaps of its own
+ * blocks with a single collective read, decodes them, and checks that the
+ * primes increase, that each block ends where the next one starts, and that
+ * the counts agree with the index.  The counts, the largest prime, and the sum
+ * of the primes are then combined on process 0.
+ */
+
+/* Accepts an argument f for the name of the file (default "primes.bin"), and an
+ * argument k to instead look up the k-th prime, which only takes a search of
+ * the index and the decoding of a single block.
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "parse_args.h"
+#include "segsieve_helper.h"
+#include "aggregate_helper.h"
+#include "primefile_helper.h"
+
+static long long block_count(const prime_file_header *hdr,
+			     const prime_index_entry *index, long long b);
+static MPI_Offset block_end(const prime_file_header *hdr,
+			    const prime_index_entry *index, long long b);
+
+
+int main(int argc, char *argv[]) {
+
+    int rank;           // process rank
+    int size;           // number of processes
+
+    const char *fname;  // name of the prime file
+    long long k;        // index of the prime to look up, or 0 to check the file
+
+    MPI_File fh;
+    prime_file_header hdr;
+    prime_index_entry *index;  // the index of the file
+    long long b0;              // first block of this process
+    long long b1;              // last block of this process
+    long long b;
+    MPI_Offset start;          // file offset of block b0
+    MPI_Offset end;            // file offset right after block b1
+    MPI_Status status;
+    int nread;                 // number of bytes read by MPI_File_read_at
+    unsigned char *buf;        // the encoded gaps of blocks b0 to b1
+    const unsigned char *pos;  // start of the current block in buf
+    long long *primes;         // the primes of the current block
+    long long count;           // number of primes in the current block
+    long long prev;            // last prime of the previous block
+    long long lo;
+    long long hi;
+    long long local[2];        // number of primes and of errors of this process
+    long long global[2];
+    long long local_max;       // largest prime of this process
+    long long global_max;
+    uint128_t local_sum;       // sum of the primes of this process
+    uint128_t *sums;           // local_sum of every process, on process 0
+    uint128_t global_sum;
+    char sum_str[U192_STRLEN];
+    double elapsed;            // parallel execution time
+    long long i;
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Start the timer
+    MPI_Barrier(MPI_COMM_WORLD);
+    elapsed = -MPI_Wtime();
+
+    // Get the number of the processes
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    // Get the rank of the process
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* Default value of the file name; if arguments are passed in through the
+     * command line then they will be set by parse_read_args
+     */
+    fname = "primes.bin";
+    k = 0;
+    parse_read_args(argc, argv, &fname, &k);
+
+    fh = open_prime_file(fname, MPI_COMM_WORLD, &hdr, &index);
+    primes = malloc(hdr.block_len * sizeof(long long));
+    if (primes == NULL) {
+	fprintf(stderr, "error allocating memory for a block of primes\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    // case: look up the k-th prime, by a binary search for its block
+    if (k) {
+	if (k > (long long) hdr.nprimes) {
+	    if (!rank) {
+		fprintf(stderr, "the file holds only %llu primes\n",
+			(unsigned long long) hdr.nprimes);
+	    }
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	if (!rank) {
+	    lo = 0;
+	    hi = hdr.nblocks - 1;
+	    while (lo < hi) {
+		b = (lo + hi + 1) / 2;
+		if ((long long) index[b].first_idx <= k - 1) {
+		    lo = b;
+		}
+		else {
+		    hi = b - 1;
+		}
+	    }
+	    end = block_end(&hdr, index, lo);
+	    buf = malloc(end - index[lo].offset + 1);
+	    if (buf == NULL) {
+		fprintf(stderr, "error allocating memory for the encoded primes\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	    }
+	    MPI_File_read_at(fh, index[lo].offset, buf, end - index[lo].offset,
+			     MPI_BYTE, &status);
+	    MPI_Get_count(&status, MPI_BYTE, &nread);
+	    if ((nread != end - (MPI_Offset) index[lo].offset)
+		|| (decode_prime_block(buf, buf + nread, index[lo].first,
+				       k - index[lo].first_idx, primes) == NULL)) {
+		fprintf(stderr, "\"%s\" is corrupt: block %lld cannot be decoded\n",
+			fname, lo);
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	    }
+	    local_max = primes[k - 1 - index[lo].first_idx];
+	    free(buf);
+	}
+    }
+    // case: decode and check every block, each process taking its share
+    else {
+	block_range_ll(0, hdr.nblocks - 1, rank, size, &b0, &b1);
+	start = (b0 < (long long) hdr.nblocks) ? index[b0].offset : hdr.index_offset;
+	end = (b1 < b0) ? start : block_end(&hdr, index, b1);
+	buf = malloc(end - start + 1);
+	if (buf == NULL) {
+	    fprintf(stderr, "error allocating memory for the encoded primes\n");
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	}
+	read_at_all_chunked(fh, start, buf, end - start, MPI_COMM_WORLD);
+
+	local[0] = 0;
+	local[1] = 0;
+	local_max = 0;
+	local_sum = 0;
+	pos = buf;
+	for (b = b0; b <= b1; b++) {
+	    count = block_count(&hdr, index, b);
+	    if ((count < 1) || (count > (long long) hdr.block_len)
+		|| (pos != buf + (index[b].offset - start))) {
+		local[1]++;
+		break;
+	    }
+	    pos = decode_prime_block(pos, buf + (block_end(&hdr, index, b) - start),
+				     index[b].first, count, primes);
+	    // case: the gaps ran past the end of the block, or are malformed
+	    if (pos == NULL) {
+		local[1]++;
+		break;
+	    }
+
+	    prev = (b > 0) ? index[b - 1].first : 1;
+	    for (i = 0; i < count; i++) {
+		if (primes[i] <= prev) {
+		    local[1]++;
+		}
+		prev = primes[i];
+		local_sum += primes[i];
+	    }
+	    local[0] += count;
+	    local_max = primes[count - 1];
+	    // case: the block ran past the start of the next one
+	    if ((b + 1 < (long long) hdr.nblocks) && (primes[count - 1] >= (long long) index[b + 1].first)) {
+		local[1]++;
+	    }
+	}
+	free(buf);
+
+	MPI_Reduce(local, global, 2, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+	MPI_Reduce(&local_max, &global_max, 1, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+	sums = malloc(size * sizeof(uint128_t));
+	if (sums == NULL) {
+	    fprintf(stderr, "error allocating memory for the sums\n");
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	}
+	MPI_Gather(&local_sum, sizeof(uint128_t), MPI_BYTE, sums, sizeof(uint128_t),
+		   MPI_BYTE, 0, MPI_COMM_WORLD);
+	global_sum = 0;
+	for (i = 0; i < size; i++) {
+	    global_sum += sums[i];
+	}
+	free(sums);
+    }
+
+    MPI_File_close(&fh);
+    free(primes);
+    free(index);
+
+    // Stop the timer
+    elapsed += MPI_Wtime();
+
+    // Finalize the MPI environment
+    MPI_Finalize();
+
+    // Print the results
+    if (!rank && k) {
+	printf("\n"
+	       "The %lld-th prime is %lld\n"
+	       "Total elapsed time: %10.6f\n"
+	       "\n",
+	       k, local_max, elapsed);
+    }
+    else if (!rank) {
+	sprint_u192(sum_str, 0, global_sum);
+	printf("\n"
+	       "\"%s\" holds the %llu primes up to %llu in %llu blocks (%.3f bytes per prime)\n"
+	       "%lld primes were decoded, the largest %lld, with sum %s\n",
+	       fname, (unsigned long long) hdr.nprimes, (unsigned long long) hdr.n,
+	       (unsigned long long) hdr.nblocks,
+	       (double) (hdr.index_offset - hdr.data_offset) / hdr.nprimes,
+	       global[0], global_max, sum_str);
+	if (global[1] || (global[0] != (long long) hdr.nprimes)) {
+	    printf("The file is corrupt: %lld errors were found\n", global[1]);
+	}
+	printf("Total elapsed time: %10.6f (%.1f million primes per second)\n"
+	       "\n",
+	       elapsed, global[0] / elapsed / 1e6);
+    }
+
+    return 0;
+}
+
+
+
+
+/* Return the number of primes in block b of a prime file */
+
+static long long block_count(const prime_file_header *hdr,
+			     const prime_index_entry *index, long long b) {
+    if (b + 1 < (long long) hdr->nblocks) {
+	return index[b + 1].first_idx - index[b].first_idx;
+    }
+    return hdr->nprimes - index[b].first_idx;
+}
+
+
+
+
+/* Return the file offset right after the encoded gaps of block b of a prime
+ * file, i.e. the start of the next block or of the index
+ */
+
+static MPI_Offset block_end(const prime_file_header *hdr,
+			    const prime_index_entry *index, long long b) {
+    if (b + 1 < (long long) hdr->nblocks) {
+	return index[b + 1].offset;
+    }
+    return hdr->index_offset;
+}
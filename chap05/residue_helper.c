@@ -0,0 +1,314 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "segsieve_helper.h"
+#include "residue_helper.h"
+
+static void count_masked(residue_modulus *mod, const uint64_t *bits,
+			 long long seg_low, long long nwords, uint64_t tail);
+static void residue_prime(long long p, void *data);
+static int gcd(int a, int b);
+
+
+
+
+/* Read the comma-separated list of moduli str, e.g. "3,4,10", into moduli and
+ * return their number
+ */
+
+int parse_moduli(const char *str, int *moduli) {
+
+    const char *curr;  // start of the modulus currently being read
+    char *endptr;      // point to next char after int read
+    long val;
+    int nmoduli;
+
+    // To distinguish success / failure after a call to strtol
+    errno = 0;
+
+    nmoduli = 0;
+    curr = str;
+    while (1) {
+
+	val = strtol(curr, &endptr, 10);
+	if ((endptr == curr) || ((*endptr != ',') && (*endptr != '\0'))) {
+	    fprintf(stderr, "Invalid list of moduli \"%s\"\n", str);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	else if ((errno != 0) || (val < 1) || (val > MAX_MODULUS)) {
+	    fprintf(stderr, "Moduli in \"%s\" must be between 1 and %d\n", str,
+		    MAX_MODULUS);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	else if (nmoduli == MAX_MODULI) {
+	    fprintf(stderr, "At most %d moduli can be counted\n", MAX_MODULI);
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+	}
+	moduli[nmoduli++] = (int) val;
+
+	if (*endptr == '\0') {
+	    break;
+	}
+	curr = endptr + 1;
+    }
+
+    return nmoduli;
+}
+
+
+
+
+/* Set up *rc to count the primes in each residue class modulo each of the
+ * nmoduli moduli, building the masks of the moduli with few enough classes
+ */
+
+void init_residue_counts(residue_counts *rc, const int *moduli, int nmoduli) {
+
+    residue_modulus *mod;
+    long long offset;
+    long long t;
+    int i;
+
+    memset(rc, 0, sizeof(residue_counts));
+    rc->nmoduli = nmoduli;
+    for (i = 0; i < nmoduli; i++) {
+	rc->nhist += moduli[i];
+    }
+    rc->hist = calloc(rc->nhist, sizeof(long long));
+    if (rc->hist == NULL) {
+	fprintf(stderr, "error allocating memory for the residue counts\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    offset = 0;
+    for (i = 0; i < nmoduli; i++) {
+	mod = &rc->mods[i];
+	mod->q = moduli[i];
+	mod->nclasses = (mod->q % 2) ? mod->q : mod->q / 2;
+	mod->period = mod->nclasses / gcd(mod->nclasses, 64);
+	mod->counts = rc->hist + offset;
+	offset += mod->q;
+
+	if (mod->nclasses > MAX_MASK_CLASSES) {
+	    continue;
+	}
+	mod->masks = calloc((long long) mod->period * mod->nclasses, sizeof(uint64_t));
+	if (mod->masks == NULL) {
+	    fprintf(stderr, "error allocating memory for the residue masks\n");
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	}
+	// Bit t of the period belongs to class t mod nclasses
+	for (t = 0; t < 64LL * mod->period; t++) {
+	    mod->masks[((t / 64) * mod->nclasses) + (t % mod->nclasses)] |= (uint64_t) 1 << (t % 64);
+	}
+    }
+}
+
+
+
+
+/* Add the prime p to the counts; used for the even prime 2, which the sieve
+ * does not represent
+ */
+
+void add_residue_prime(residue_counts *rc, long long p) {
+
+    int i;
+
+    for (i = 0; i < rc->nmoduli; i++) {
+	rc->mods[i].counts[p % rc->mods[i].q]++;
+    }
+}
+
+
+
+
+/* Add the primes among the values that the segment is responsible for to the
+ * residue_counts pointed to by data.  May be passed to sieve_range or
+ * atkin_range.  The moduli without masks share a single pass over the primes
+ * of the segment.
+ */
+
+void residue_segment(const uint64_t *bits, long long seg_low,
+		     long long nown, long long nbits, void *data) {
+
+    residue_counts *rc = data;
+    long long nwords;
+    int nunmasked;       // number of moduli without masks
+    int i;
+
+    nwords = SEG_NWORDS(nown);
+
+    nunmasked = 0;
+    for (i = 0; i < rc->nmoduli; i++) {
+	if (rc->mods[i].masks != NULL) {
+	    count_masked(&rc->mods[i], bits, seg_low, nwords, SEG_TAIL_MASK(nown));
+	}
+	else {
+	    nunmasked++;
+	}
+    }
+    if (nunmasked) {
+	for_each_prime(bits, seg_low, nown, residue_prime, rc);
+    }
+}
+
+
+
+
+/* Free the buffers of *rc */
+
+void free_residue_counts(residue_counts *rc) {
+
+    int i;
+
+    for (i = 0; i < rc->nmoduli; i++) {
+	free(rc->mods[i].masks);
+    }
+    free(rc->hist);
+}
+
+
+
+
+/* Print the counts of the primes in the residue classes coprime to each of the
+ * moduli, where hist holds the counts of the moduli one after another as in a
+ * residue_counts.  The other classes of a modulus q only hold the primes
+ * dividing q, which are summed up in a single line.
+ */
+
+void print_residue_counts(const long long *hist, const int *moduli, int nmoduli) {
+
+    long long nother;  // number of primes dividing the modulus
+    long long lo;      // smallest count of a coprime class
+    long long hi;      // largest count of a coprime class
+    int ncoprime;      // number of coprime classes, phi(q)
+    int q;
+    int a;
+    int i;
+
+    for (i = 0; i < nmoduli; i++) {
+	q = moduli[i];
+	ncoprime = 0;
+	for (a = 0; a < q; a++) {
+	    ncoprime += (gcd(a, q) == 1);
+	}
+	printf("\n"
+	       "Primes in the %d residue classes coprime to %d:\n"
+	       "\n"
+	       "       a  pi(n; %d, a)\n",
+	       ncoprime, q, q);
+
+	nother = 0;
+	lo = -1;
+	hi = 0;
+	for (a = 0; a < q; a++) {
+	    if (gcd(a, q) != 1) {
+		nother += hist[a];
+		continue;
+	    }
+	    printf("    %4d  %lld\n", a, hist[a]);
+	    lo = ((lo < 0) || (hist[a] < lo)) ? hist[a] : lo;
+	    hi = (hist[a] > hi) ? hist[a] : hi;
+	}
+	printf("\n"
+	       "Largest minus smallest count: %lld\n"
+	       "Primes dividing %d: %lld\n",
+	       hi - lo, q, nother);
+	hist += q;
+    }
+    printf("\n");
+}
+
+
+
+
+/* Count the primes of each class of the first nwords words of a segment with
+ * masked popcounts, ANDing the last word with tail, and add them to the counts
+ * of their residues.  Bit t stands for seg_low + 2t, so class c holds the
+ * residue (seg_low + 2c) mod q.  The count of the last class is the total
+ * count less the others, which saves a popcount per word.
+ */
+
+static void count_masked(residue_modulus *mod, const uint64_t *bits,
+			 long long seg_low, long long nwords, uint64_t tail) {
+
+    long long seg_counts[MAX_MASK_CLASSES];  // counts of each class
+    const uint64_t *mask;
+    long long total;
+    uint64_t word;
+    long long w;
+    int last = mod->nclasses - 1;
+    int r0;    // residue of class 0
+    int k;     // word of the period that word w falls on
+    int c;
+
+    memset(seg_counts, 0, mod->nclasses * sizeof(long long));
+    total = 0;
+    k = 0;
+    for (w = 0; w < nwords; w++) {
+	word = (w == nwords - 1) ? bits[w] & tail : bits[w];
+	mask = mod->masks + ((long long) k * mod->nclasses);
+	total += __builtin_popcountll(word);
+	for (c = 0; c < last; c++) {
+	    seg_counts[c] += __builtin_popcountll(word & mask[c]);
+	}
+	if (++k == mod->period) {
+	    k = 0;
+	}
+    }
+    for (c = 0; c < last; c++) {
+	total -= seg_counts[c];
+    }
+    seg_counts[last] = total;
+
+    r0 = seg_low % mod->q;
+    for (c = 0; c < mod->nclasses; c++) {
+	mod->counts[(r0 + (2 * c)) % mod->q] += seg_counts[c];
+    }
+}
+
+
+
+
+/* Add the prime p to the counts of the moduli without masks of the
+ * residue_counts pointed to by data; the prime_fcn passed to for_each_prime by
+ * residue_segment
+ */
+
+static void residue_prime(long long p, void *data) {
+
+    residue_counts *rc = data;
+    residue_modulus *mod;
+    int i;
+
+    for (i = 0; i < rc->nmoduli; i++) {
+	mod = &rc->mods[i];
+	if (mod->masks == NULL) {
+	    mod->counts[p % mod->q]++;
+	}
+    }
+}
+
+
+
+
+/* Return the greatest common divisor of a and b */
+
+static int gcd(int a, int b) {
+
+    int r;
+
+    while (b) {
+	r = a % b;
+	a = b;
+	b = r;
+    }
+
+    return a;
+}
@@ -0,0 +1,51 @@
+#include <stdint.h>
+
+#define MAX_MODULI        16       // maximum number of moduli counted in one pass
+#define MAX_MODULUS       1000000  // largest modulus
+#define MAX_MASK_CLASSES  10       // most classes of odd values counted by masks
+
+/* The counts of the primes in each residue class modulo q, i.e. counts[a] is
+ * pi(n; q, a) for 0 <= a < q.
+ *
+ * The odd values of a segment fall into nclasses classes modulo q: bit t of a
+ * segment stands for seg_low + 2t, whose residue only depends on t modulo q
+ * for odd q, or modulo q / 2 for even q.  For a small nclasses the primes of
+ * class c are counted with popcounts of the segment words ANDed with a mask of
+ * the bits t = c (mod nclasses).  The masks repeat every period words, and
+ * word k of the mask of class c is masks[(k * nclasses) + c].  This takes
+ * nclasses popcounts per word, whereas a word holds only about 128 / ln(n)
+ * primes, so for a larger nclasses masks is NULL and the primes are instead
+ * found one at a time (past about 10 classes this is the faster of the two
+ * for n around 1e9).
+ */
+typedef struct {
+    int q;
+    int nclasses;
+    int period;
+    uint64_t *masks;
+    long long *counts;
+} residue_modulus;
+
+/* Data passed through sieve_range to residue_segment.  The counts of the
+ * moduli lie one after another in hist, so that they can be combined with a
+ * single reduction of nhist values.
+ */
+typedef struct {
+    int nmoduli;
+    residue_modulus mods[MAX_MODULI];
+    long long *hist;
+    long long nhist;
+} residue_counts;
+
+int parse_moduli(const char *str, int *moduli);
+
+void init_residue_counts(residue_counts *rc, const int *moduli, int nmoduli);
+
+void add_residue_prime(residue_counts *rc, long long p);
+
+void residue_segment(const uint64_t *bits, long long seg_low,
+		     long long nown, long long nbits, void *data);
+
+void free_residue_counts(residue_counts *rc);
+
+void print_residue_counts(const long long *hist, const int *moduli, int nmoduli);
@@ -0,0 +1,121 @@
+#!/bin/sh
+#
+# Run a program of this chapter over a sweep of process counts and report its
+# scaling: a table on standard output and CSV in the file given by -o,
+#
+#     mode,program,nprocs,n,seconds,speedup,efficiency,karp_flatt
+#
+# In strong mode (the default) every run gets the same n, and in weak mode the
+# run with p processes gets p times the base n, so the work per process stays
+# the same.  The time of a run is the "Total elapsed time" that the program
+# prints, or the wall time of mpirun if it prints none.  Each run is repeated
+# and the fastest time is kept.
+#
+# The first process count p0 of the sweep is the baseline, taken to scale
+# perfectly up to itself, so that with T the time of a run with p processes
+#
+#     strong speedup      S = p0 T(p0) / T
+#     weak (scaled) one   S = p0 T(p0) / T * p / p0 = p T(p0) / T
+#     efficiency          E = S / p
+#     Karp-Flatt          e = (1 / S - 1 / p) / (1 - 1 / p)
+#
+# where e, the experimentally determined serial fraction, is left empty for
+# p = 1.  An e that grows with p points at parallel overhead rather than at
+# serial code.
+#
+# Usage: ./scaling.sh [-m strong|weak] [-n n] [-p "nprocs ..."] [-r repeats]
+#                     [-o csv] program [arg ...]
+#
+# The program gets "-n n" after its own arguments, e.g. "./scaling.sh -m weak
+# -n 1e8 ./sieve_seg -e atkin" (n may be given in e notation).  The defaults
+# are n = 1e8 and the sweep "1 2 4 8".  Set MPIRUN to change how the programs
+# are launched; the default oversubscribes, so that sweeps past the number of
+# cores of one machine still run (their times then measure the overhead of
+# sharing the cores rather than scaling).
+
+mode=strong
+nbase=1e8
+plist="1 2 4 8"
+repeats=3
+csv=scaling.csv
+MPIRUN=${MPIRUN:-"mpirun --oversubscribe"}
+
+usage="usage: $0 [-m strong|weak] [-n n] [-p \"nprocs ...\"] [-r repeats] [-o csv] program [arg ...]"
+
+while getopts "m:n:o:p:r:" opt; do
+    case $opt in
+	m) mode=$OPTARG ;;
+	n) nbase=$OPTARG ;;
+	o) csv=$OPTARG ;;
+	p) plist=$OPTARG ;;
+	r) repeats=$OPTARG ;;
+	*) echo "$usage" >&2; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+if [ $# -lt 1 ] || { [ "$mode" != strong ] && [ "$mode" != weak ]; }; then
+    echo "$usage" >&2
+    exit 1
+fi
+prog=$1
+shift
+
+make -s -C "$(dirname "$prog")" "$(basename "$prog")" || exit 1
+
+# Print the current time in seconds
+now() {
+    date +%s.%N
+}
+
+# Run the program with $1 processes, n = $2, and the rest of the arguments
+# $repeats times and print the fastest time
+time_run() {
+    np=$1
+    nrun=$2
+    shift 2
+    best=""
+    i=0
+    while [ $i -lt "$repeats" ]; do
+	start=$(now)
+	out=$($MPIRUN -np "$np" "$prog" "$@" -n "$nrun" 2>&1) || {
+	    echo "$out" >&2
+	    exit 1
+	}
+	stop=$(now)
+	secs=$(echo "$out" | sed -n 's/^Total elapsed time: *\([0-9.e+-]*\).*/\1/p' | head -n 1)
+	best=$(awk -v s="$secs" -v b="$best" -v t0="$start" -v t1="$stop" \
+	    'BEGIN { if (s == "") s = t1 - t0; print (b == "" || s < b) ? s : b }')
+	i=$((i + 1))
+    done
+    echo "$best"
+}
+
+echo "mode,program,nprocs,n,seconds,speedup,efficiency,karp_flatt" > "$csv" || exit 1
+printf "%s scaling of %s\n\n" "$mode" "$(echo "$prog $*" | sed "s/ *$//")"
+printf "%8s  %14s  %10s  %8s  %10s  %10s\n" nprocs n seconds speedup efficiency karp-flatt
+
+p0=""
+t0=""
+for p in $plist; do
+    # The n of this run, printed without e notation for the program
+    n=$(awk -v n="$nbase" -v p="$p" -v m="$mode" \
+	'BEGIN { printf "%.0f", (m == "weak") ? n * p : n }')
+    t=$(time_run "$p" "$n" "$@") || exit 1
+    if [ -z "$p0" ]; then
+	p0=$p
+	t0=$t
+    fi
+    awk -v m="$mode" -v prog="$(basename "$prog")" -v p="$p" -v n="$n" -v t="$t" \
+	-v p0="$p0" -v t0="$t0" -v csv="$csv" 'BEGIN {
+	s = (t > 0) ? p0 * t0 / t : 0
+	if (m == "weak")
+	    s *= p / p0
+	e = s / p
+	kf = ""
+	if ((p > 1) && (s > 0))
+	    kf = sprintf("%.4f", (1 / s - 1 / p) / (1 - 1 / p))
+	printf "%8d  %14s  %10.4f  %8.3f  %10.3f  %10s\n", p, n, t, s, e, kf
+	printf "%s,%s,%d,%s,%s,%.4f,%.4f,%s\n", m, prog, p, n, t, s, e, kf >> csv
+    }'
+done
+printf "\nCSV written to %s\n" "$csv"
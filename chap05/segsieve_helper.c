@@ -0,0 +1,602 @@
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "segsieve_helper.h"
+
+/* The unrolled marking kernels of mark_multiples.  With the grid seen as
+ * bytes, the odd prime p = 8q + pr steps through the 8 bit positions of a byte
+ * in a fixed order, so 8 consecutive multiples starting at bit r of some byte
+ * lie at byte offsets i q + (r + i pr) / 8 and bits (r + i pr) % 8, and the
+ * next 8 multiples start at bit r again, p bytes further on.  For each of the
+ * 32 pairs (pr, r) a kernel clears 8 multiples per iteration with offsets and
+ * masks that are constants except for the term i q.
+ */
+#define CLEAR_MULTIPLE(i, r, pr)					\
+    byte[((i) * q) + (((r) + ((i) * (pr))) >> 3)]			\
+	&= (uint8_t) ~(1 << (((r) + ((i) * (pr))) & 7))
+
+#define MARK_KERNEL(r, pr)						\
+    case (((pr) / 2) * 8) + (r):					\
+	for ( ; byte < end; byte += p) {				\
+	    CLEAR_MULTIPLE(0, r, pr);					\
+	    CLEAR_MULTIPLE(1, r, pr);					\
+	    CLEAR_MULTIPLE(2, r, pr);					\
+	    CLEAR_MULTIPLE(3, r, pr);					\
+	    CLEAR_MULTIPLE(4, r, pr);					\
+	    CLEAR_MULTIPLE(5, r, pr);					\
+	    CLEAR_MULTIPLE(6, r, pr);					\
+	    CLEAR_MULTIPLE(7, r, pr);					\
+	}								\
+	break;
+
+#define MARK_KERNELS(pr)						\
+    MARK_KERNEL(0, pr) MARK_KERNEL(1, pr) MARK_KERNEL(2, pr)		\
+    MARK_KERNEL(3, pr) MARK_KERNEL(4, pr) MARK_KERNEL(5, pr)		\
+    MARK_KERNEL(6, pr) MARK_KERNEL(7, pr)
+
+
+/* Data passed through sieve_range to collect_primes */
+typedef struct {
+    int *primes;  // array of primes found so far
+    int len;      // number of primes stored in primes
+    int cap;      // number of elements allocated for primes
+} prime_list;
+
+static void reset_segment(uint64_t *bits, long long seg_low, long long nbits,
+			  long long grid_nbits);
+static void mark_multiples(uint64_t *bits, long long start_idx, long long nbits, int p);
+static long long first_multiple_idx(int p, long long seg_low);
+static void collect_primes(const uint64_t *bits, long long seg_low,
+			   long long nown, long long nbits, void *data);
+static void append_prime(long long p, void *data);
+static int small_odd_primes(int limit, int **base);
+
+
+
+
+/* Return floor( sqrt(n) ) for n >= 0.  The floating-point square root is only
+ * used as a first guess since a double cannot represent every long long, and
+ * the corrections are written in terms of division so that they can't
+ * overflow.
+ */
+
+long long isqrt_ll(long long n) {
+
+    long long r;
+
+    if (n < 2) {
+	return n;
+    }
+
+    r = (long long) sqrt((double) n);
+    while (r > n / r) {
+	r--;
+    }
+    while ((r + 1) <= n / (r + 1)) {
+	r++;
+    }
+
+    return r;
+}
+
+
+
+
+/* Write the lowest and highest values of the rank-th of size contiguous blocks
+ * of {startval, ..., endval} to *low_value and *high_value.  The block is empty
+ * when *high_value < *low_value.  BLOCK_LOW is not used directly since rank *
+ * n_elem can overflow even a long long when n_elem is near 1e18; instead we use
+ * floor(r * n / z) == r * (n / z) + floor(r * (n % z) / z).
+ */
+
+void block_range_ll(long long startval, long long endval, int rank, int size,
+		    long long *low_value, long long *high_value) {
+
+    long long n_elem = endval - startval + 1;
+    long long quot = n_elem / size;
+    long long rem = n_elem % size;
+
+    *low_value = (rank * quot) + ((rank * rem) / size) + startval;
+    *high_value = ((rank + 1) * quot) + (((rank + 1) * rem) / size) + startval - 1;
+}
+
+
+
+
+/* The same as local_set_params in sieve_helper.c but for sets whose values may
+ * not be representable as an int (see block_range_ll)
+ */
+
+void local_set_params_ll(long long startval, long long endval, int rank, int size,
+			 long long *low_value, long long *high_value,
+			 long long *set_size) {
+
+    // Find the lowest value and the largest value (even is okay) of the set
+    block_range_ll(startval, endval, rank, size, low_value, high_value);
+    // Find the lowest odd value in the rank-th set
+    if (!(*low_value % 2)) {
+	(*low_value)++;
+    }
+
+    /* Find the amount of odd numbers between low_value and high_value,
+     * inclusive.  Note that this is 0 when the set contains no odd numbers.
+     */
+    *set_size = (*high_value < *low_value) ? 0 : ((*high_value - *low_value) / 2) + 1;
+}
+
+
+
+
+/* Find the odd primes in {3, ..., limit}, store them in increasing order in a
+ * newly allocated array pointed to by *primes, and return the number of primes.
+ * The work is split among the size processes of MPI_COMM_WORLD, each of which
+ * gets the whole array of primes.
+ *
+ * Every process finds the primes up to sqrt(limit) with a small unsegmented
+ * sieve, which takes little time, and sieves its own contiguous slice of {3,
+ * ..., limit} with them a segment at a time.  The slices are then assembled
+ * with MPI_Allgatherv.  Since the gaps between consecutive odd primes below
+ * 2^31 are even and at most 292, each prime is sent as half of its gap to the
+ * previous prime in a single byte, along with the first prime of each slice,
+ * which cuts the volume of the exchange by a factor of 4.
+ */
+
+int gather_sieving_primes(int limit, int rank, int size, int **primes) {
+
+    int *base;          // the odd primes in {3, ..., sqrt(limit)}
+    int nbase;
+    prime_list list;    // the primes of this process's slice
+    long long low;      // lowest odd value of the slice
+    long long high;     // highest value of the slice
+    long long setsize;
+    unsigned char *gaps;      // half gaps of every slice, in rank order
+    int *counts;        // number of primes of each slice
+    int *displs;
+    int *firsts;        // first prime of each slice
+    int first;
+    int ntotal;
+    int i;
+    int r;
+
+    list.len = 0;
+    list.cap = 1024;
+    list.primes = malloc(list.cap * sizeof(int));
+    counts = malloc(size * sizeof(int));
+    displs = malloc(size * sizeof(int));
+    firsts = malloc(size * sizeof(int));
+    if ((list.primes == NULL) || (counts == NULL) || (displs == NULL)
+	|| (firsts == NULL)) {
+	fprintf(stderr, "error allocating memory for sieving primes\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    // Sieve this process's slice of {3, ..., limit}
+    if (limit >= 3) {
+	nbase = small_odd_primes((int) isqrt_ll(limit), &base);
+	local_set_params_ll(3, limit, rank, size, &low, &high, &setsize);
+	sieve_range(low, high, high, SEG_NBITS, 0, base, nbase, collect_primes, &list);
+	free(base);
+    }
+
+    // Encode the slice as half gaps, the first prime as a gap of 0
+    gaps = malloc(list.len + 1);
+    if (gaps == NULL) {
+	fprintf(stderr, "error allocating memory for sieving primes\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    first = (list.len > 0) ? list.primes[0] : 0;
+    for (i = 0; i < list.len; i++) {
+	gaps[i] = (i > 0) ? (list.primes[i] - list.primes[i - 1]) / 2 : 0;
+    }
+
+    MPI_Allgather(&list.len, 1, MPI_INT, counts, 1, MPI_INT, MPI_COMM_WORLD);
+    MPI_Allgather(&first, 1, MPI_INT, firsts, 1, MPI_INT, MPI_COMM_WORLD);
+    ntotal = 0;
+    for (r = 0; r < size; r++) {
+	displs[r] = ntotal;
+	ntotal += counts[r];
+    }
+
+    /* Gather the half gaps into the bytes of the array of primes, and then
+     * widen them in place from the back, since the decoded primes are 4 times
+     * as large as the encoded ones
+     */
+    *primes = malloc((ntotal + 1) * sizeof(int));
+    if (*primes == NULL) {
+	fprintf(stderr, "error allocating memory for sieving primes\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    MPI_Allgatherv(gaps, list.len, MPI_UNSIGNED_CHAR, *primes, counts, displs,
+		   MPI_UNSIGNED_CHAR, MPI_COMM_WORLD);
+
+    for (i = ntotal - 1; i >= 0; i--) {
+	(*primes)[i] = ((unsigned char *) *primes)[i];
+    }
+    for (r = 0; r < size; r++) {
+	for (i = 0; i < counts[r]; i++) {
+	    (*primes)[displs[r] + i] = (i > 0)
+		? (*primes)[displs[r] + i - 1] + (2 * (*primes)[displs[r] + i])
+		: firsts[r];
+	}
+    }
+
+    free(list.primes);
+    free(gaps);
+    free(counts);
+    free(displs);
+    free(firsts);
+
+    return ntotal;
+}
+
+
+
+
+/* Allocate a zeroed bit grid large enough for nbits bits plus one extra word,
+ * where the extra word is what allows SEG_SHIFTED_WORD to read past the end of
+ * the grid.
+ */
+
+uint64_t *alloc_segment(long long nbits) {
+
+    uint64_t *bits;
+
+    bits = calloc(SEG_NWORDS(nbits) + 1, sizeof(uint64_t));
+    if (bits == NULL) {
+	fprintf(stderr, "error allocating memory for segment bit grid\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+
+    return bits;
+}
+
+
+
+
+/* Sieve the nbits odd values starting at the odd value seg_low with the odd
+ * primes in primes, so that afterwards exactly the bits of the prime values are
+ * set.  The primes must be in increasing order and must include every odd prime
+ * up to sqrt(seg_low + 2 * (nbits - 1)).
+ *
+ * This is the stand-alone version of a single step of sieve_range, meant for
+ * sieving an isolated window; the starting index of each prime is found by
+ * division.
+ */
+
+void sieve_segment(uint64_t *bits, long long seg_low, long long nbits,
+		   const int *primes, int nprimes) {
+
+    long long seg_high;  // largest value in the segment
+    int i;
+
+    reset_segment(bits, seg_low, nbits, nbits);
+    seg_high = seg_low + (2 * (nbits - 1));
+
+    for (i = 0; (i < nprimes) && ((long long) primes[i] * primes[i] <= seg_high); i++) {
+	mark_multiples(bits, first_multiple_idx(primes[i], seg_low), nbits, primes[i]);
+    }
+}
+
+
+
+
+/* Sieve the odd values in {low, ..., high} a segment of seg_nbits values at a
+ * time and call fcn after each segment has been sieved.
+ *
+ * Each segment additionally sieves up to overlap odd values past its end (but
+ * never past maxval), so that fcn can look at patterns of primes that start in
+ * the segment and end in the next one.  The values in the look-ahead region are
+ * sieved again as part of the next segment.
+ *
+ * Rather than dividing to find where to start marking each prime in every
+ * segment, the index of the next multiple of each prime is carried over from
+ * one segment to the next.  A prime is only added to the set of active primes
+ * once its square falls inside a segment.
+ *
+ * PRE: low >= 1, maxval >= high, and primes contains every odd prime up to
+ * sqrt(maxval) in increasing order
+ */
+
+void sieve_range(long long low, long long high, long long maxval,
+		 long long seg_nbits, long long overlap,
+		 const int *primes, int nprimes, segment_fcn fcn, void *data) {
+
+    uint64_t *bits;      // bit grid for the current segment
+    long long *next;     // index of next multiple of each active prime
+    int nactive;         // primes[0], ..., primes[nactive - 1] are active
+    long long seg_low;   // lowest odd value in the current segment
+    long long seg_high;  // largest value sieved in the current segment
+    long long nleft;     // number of odd values left in {low, ..., high}
+    long long nown;      // number of odd values the segment is responsible for
+    long long nbits;     // nown plus the number of look-ahead values
+    long long k;
+    int p;
+    int i;
+
+    // Advance to the first odd number in the range
+    if (low < 1) {
+	low = 1;
+    }
+    if (!(low % 2)) {
+	low++;
+    }
+    if (high < low) {
+	return;
+    }
+
+    bits = alloc_segment(seg_nbits + overlap);
+    next = malloc((nprimes + 1) * sizeof(long long));
+    if (next == NULL) {
+	fprintf(stderr, "error allocating memory for sieving offsets\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    nactive = 0;
+
+    seg_low = low;
+    nleft = ((high - low) / 2) + 1;
+    while (nleft > 0) {
+
+	nown = (nleft < seg_nbits) ? nleft : seg_nbits;
+	nbits = nown + overlap;
+	// case: the look-ahead region would extend past maxval
+	if (nbits > ((maxval - seg_low) / 2) + 1) {
+	    nbits = ((maxval - seg_low) / 2) + 1;
+	}
+	seg_high = seg_low + (2 * (nbits - 1));
+
+	reset_segment(bits, seg_low, nbits, seg_nbits + overlap);
+
+	// Add the primes whose squares are now inside of the segment
+	while ((nactive < nprimes) && ((long long) primes[nactive] * primes[nactive] <= seg_high)) {
+	    next[nactive] = first_multiple_idx(primes[nactive], seg_low);
+	    nactive++;
+	}
+
+	/* Mark the multiples of each active prime, and then move its offset to
+	 * the first multiple belonging to the next segment.  Multiples that fell
+	 * in the look-ahead region belong to the next segment too.
+	 */
+	for (i = 0; i < nactive; i++) {
+	    p = primes[i];
+	    k = next[i];
+	    mark_multiples(bits, k, nbits, p);
+	    if (k < nown) {
+		k += ((nown - k + p - 1) / p) * p;
+	    }
+	    next[i] = k - nown;
+	}
+
+	fcn(bits, seg_low, nown, nbits, data);
+
+	seg_low += 2 * nown;
+	nleft -= nown;
+    }
+
+    free(next);
+    free(bits);
+}
+
+
+
+
+/* Return the number of bits set in the first nbits bits of bits */
+
+long long count_bits(const uint64_t *bits, long long nbits) {
+
+    long long ct;
+    long long nfull;  // number of words entirely within the first nbits bits
+    long long w;
+
+    nfull = nbits / 64;
+    ct = 0;
+    for (w = 0; w < nfull; w++) {
+	ct += __builtin_popcountll(bits[w]);
+    }
+    if (nbits % 64) {
+	ct += __builtin_popcountll(bits[nfull] & SEG_TAIL_MASK(nbits));
+    }
+
+    return ct;
+}
+
+
+
+
+/* Call fcn with data for the value of each bit that is set among the first nown
+ * bits of a segment whose lowest value is seg_low, in increasing order.  This
+ * is the walk over the primes of a segment shared by the segment functions
+ * that need the primes themselves rather than their number.
+ */
+
+void for_each_prime(const uint64_t *bits, long long seg_low, long long nown,
+		    prime_fcn fcn, void *data) {
+
+    long long nwords = SEG_NWORDS(nown);
+    uint64_t word;
+    long long w;
+
+    for (w = 0; w < nwords; w++) {
+	word = bits[w];
+	// case: last word; ignore bits past nown
+	if (w == nwords - 1) {
+	    word &= SEG_TAIL_MASK(nown);
+	}
+	while (word) {
+	    fcn(seg_low + (2 * ((64 * w) + __builtin_ctzll(word))), data);
+	    word &= word - 1;
+	}
+    }
+}
+
+
+
+
+/* Set the first nbits bits of a grid allocated for grid_nbits bits to 1 and
+ * every remaining bit up to the end of its padding word to 0.  Clearing all of
+ * the words past nbits, rather than only the next one, matters when a short
+ * last segment is read past its end by SEG_SHIFTED_WORD, which would otherwise
+ * see the bits left over from the previous segment.  The value 1 is not prime,
+ * so if it is in the segment then its bit is cleared.
+ */
+
+static void reset_segment(uint64_t *bits, long long seg_low, long long nbits,
+			  long long grid_nbits) {
+
+    long long nwords = SEG_NWORDS(nbits);
+
+    memset(bits, 0xff, nwords * sizeof(uint64_t));
+    if (nbits % 64) {
+	bits[nwords - 1] = SEG_TAIL_MASK(nbits);
+    }
+    memset(bits + nwords, 0, (SEG_NWORDS(grid_nbits) + 1 - nwords) * sizeof(uint64_t));
+
+    if (seg_low == 1) {
+	bits[0] &= ~((uint64_t) 1);
+    }
+}
+
+
+
+
+/* Clear every p-th bit of the grid starting with bit start_idx.  Since the grid
+ * only contains odd values, each step skips over the even multiples of p.
+ *
+ * As long as 8 multiples remain, they are cleared by the kernel for the
+ * residue of p mod 8 and the bit position of the first multiple (see
+ * MARK_KERNEL), which relies on the bits of a word being numbered from its
+ * lowest-addressed byte up.  The rest are cleared one at a time.
+ */
+
+static void mark_multiples(uint64_t *bits, long long start_idx, long long nbits, int p) {
+
+    long long k = start_idx;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint8_t *base = (uint8_t *) bits;
+    uint8_t *byte;   // byte of the first of the next 8 multiples
+    uint8_t *end;    // first byte at which fewer than 8 multiples remain
+    long long q = p / 8;
+    int r = k & 7;
+
+    /* A pass starting at bit 8 (byte - base) + r clears bits up to 7p past it,
+     * which must be less than nbits
+     */
+    if (k + (7LL * p) < nbits) {
+	byte = base + (k >> 3);
+	end = base + ((nbits - r - (7LL * p) + 7) >> 3);
+	switch ((((p & 7) / 2) * 8) + r) {
+	    MARK_KERNELS(1)
+	    MARK_KERNELS(3)
+	    MARK_KERNELS(5)
+	    MARK_KERNELS(7)
+	}
+	k = (8 * (byte - base)) + r;
+    }
+#endif
+
+    for ( ; k < nbits; k += p) {
+	bits[k >> 6] &= ~((uint64_t) 1 << (k & 63));
+    }
+}
+
+
+
+
+/* Return the index, relative to the odd value seg_low, of the first odd multiple
+ * of p that is >= both p^2 and seg_low.  This is the same quantity as computed
+ * by num_odd_past in sieve_helper.c, but for values that need not fit in an int.
+ */
+
+static long long first_multiple_idx(int p, long long seg_low) {
+
+    long long first;
+
+    first = (long long) p * p;
+    if (first < seg_low) {
+	first = ((seg_low + p - 1) / p) * p;
+	// case: even multiple; the next multiple is odd
+	if (!(first % 2)) {
+	    first += p;
+	}
+    }
+
+    return (first - seg_low) / 2;
+}
+
+
+
+
+/* Find the odd primes in {3, ..., limit} with a small unsegmented sieve, store
+ * them in increasing order in a newly allocated array pointed to by *base, and
+ * return the number of primes.  Meant for limit up to sqrt of the values being
+ * sieved.
+ */
+
+static int small_odd_primes(int limit, int **base) {
+
+    char *grid;        // grid[i] is set to 1 once a factor of 2i + 1 is found
+    int setsize;       // number of odd values in {1, ..., limit}
+    int nbase;
+    int i;
+    int k;
+
+    /* Sieve the odd values in {1, ..., limit}; grid[i] corresponds to the
+     * value 2i + 1 and is set to 1 once a factor has been found
+     */
+    setsize = (limit + 1) / 2;
+    grid = calloc(setsize + 1, 1);
+    *base = malloc((setsize + 1) * sizeof(int));
+    if ((grid == NULL) || (*base == NULL)) {
+	fprintf(stderr, "error allocating memory for sieving primes\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+    }
+    nbase = 0;
+    for (i = 1; i < setsize; i++) {
+	if (!grid[i]) {
+	    (*base)[nbase++] = (2 * i) + 1;
+	    for (k = (((2 * i) + 1) * ((2 * i) + 1)) / 2; k < setsize; k += (2 * i) + 1) {
+		grid[k] = 1;
+	    }
+	}
+    }
+    free(grid);
+
+    return nbase;
+}
+
+
+
+
+/* Append the values of the bits that are set among the first nown bits to the
+ * prime_list pointed to by data
+ */
+
+static void collect_primes(const uint64_t *bits, long long seg_low,
+			   long long nown, long long nbits, void *data) {
+    for_each_prime(bits, seg_low, nown, append_prime, data);
+}
+
+
+
+
+/* Append the prime p to the prime_list pointed to by data */
+
+static void append_prime(long long p, void *data) {
+
+    prime_list *list = data;
+
+    // case: out of room; double the size of the array
+    if (list->len == list->cap) {
+	list->cap *= 2;
+	list->primes = realloc(list->primes, list->cap * sizeof(int));
+	if (list->primes == NULL) {
+	    fprintf(stderr, "error allocating memory for sieving primes\n");
+	    MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	}
+    }
+    list->primes[list->len++] = (int) p;
+}
@@ -0,0 +1,70 @@
+
+#include <stdint.h>
+
+/* The segmented sieve stores one bit for each odd value in a segment: bit i of
+ * a segment whose lowest value is the odd number seg_low corresponds to the
+ * value seg_low + 2i.  In contrast to the char grids used by sieve_helper.c, a
+ * bit value of 1 means that no factor was found for the value (i.e. that it is
+ * prime), so that primes can be counted with popcounts and combined with
+ * bitwise ANDs.
+ */
+
+// Default number of odd values sieved per segment (32 KiB worth of bits)
+#define SEG_NBITS  262144
+
+// Number of 64-bit words needed to store nbits bits
+#define SEG_NWORDS(nbits)  (((nbits) + 63) / 64)
+
+// Test whether bit k is set
+#define SEG_TEST(bits, k)  (((bits)[(k) >> 6] >> ((k) & 63)) & 1)
+
+// Mask of the bits of the last word of the first nbits bits that are among them
+#define SEG_TAIL_MASK(nbits)						\
+    (((nbits) % 64) ? ~(uint64_t) 0 >> (64 - ((nbits) % 64)) : ~(uint64_t) 0)
+
+/* The 64 bits starting at bit (64 * w) + s, i.e. word w after shifting the
+ * grid down by s bits.  Reads one word past word w + s / 64.
+ */
+#define SEG_SHIFTED_WORD(bits, w, s)					\
+    (((s) & 63)								\
+     ? (((bits)[(w) + ((s) >> 6)] >> ((s) & 63))			\
+	| ((bits)[(w) + ((s) >> 6) + 1] << (64 - ((s) & 63))))		\
+     : (bits)[(w) + ((s) >> 6)])
+
+/* Type of the function called by sieve_range once a segment has been sieved.
+ * The first nown bits are the values that the segment is responsible for; the
+ * bits from nown to nbits - 1 are the look-ahead values requested through the
+ * overlap argument of sieve_range.  Every bit from nbits up to the end of the
+ * word following bit nown + overlap - 1 is 0, even in a last segment that is
+ * cut short at maxval, so that SEG_SHIFTED_WORD may shift by up to overlap.
+ */
+typedef void (*segment_fcn)(const uint64_t *bits, long long seg_low,
+			    long long nown, long long nbits, void *data);
+
+// Type of the function called by for_each_prime for each prime of a segment
+typedef void (*prime_fcn)(long long p, void *data);
+
+void block_range_ll(long long startval, long long endval, int rank, int size,
+		    long long *low_value, long long *high_value);
+
+void local_set_params_ll(long long startval, long long endval, int rank, int size,
+			 long long *low_value, long long *high_value,
+			 long long *set_size);
+
+long long isqrt_ll(long long n);
+
+int gather_sieving_primes(int limit, int rank, int size, int **primes);
+
+uint64_t *alloc_segment(long long nbits);
+
+void sieve_segment(uint64_t *bits, long long seg_low, long long nbits,
+		   const int *primes, int nprimes);
+
+void sieve_range(long long low, long long high, long long maxval,
+		 long long seg_nbits, long long overlap,
+		 const int *primes, int nprimes, segment_fcn fcn, void *data);
+
+long long count_bits(const uint64_t *bits, long long nbits);
+
+void for_each_prime(const uint64_t *bits, long long seg_low, long long nown,
+		    prime_fcn fcn, void *data);
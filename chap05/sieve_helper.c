@@ -5,6 +5,7 @@
 #include <math.h>
 
 #include "mpi_helper.h"
+#include "grid_alloc.h"
 
 #define NOT_MARK 0  // not yet marked as having a factor
 #define YES_MARK 1  // has been marked as having a factor
@@ -93,20 +94,18 @@ int num_odd_past(int m, int bnd) {
 
 
 /* Allocate len bytes of memory and initialize to NOT_MARK, and set *grid to
- * point to the memory location
+ * point to the memory location.  The grid must be freed with free_grid.
  */
 
 void initialize_grid(char **grid, int len) {
 
     /* Allocate memory to store this process's share of the prime number grid.
      * The amount of memory allocated is enough to store a value for every odd
-     * number b/w low_value and high_value, inclusive.
+     * number b/w low_value and high_value, inclusive.  Large grids are backed
+     * by huge pages and placed on the local NUMA node as configured through
+     * the environment (see grid_alloc.h).
      */
-    *grid = calloc(len, 1);
-    if (*grid == NULL) {
-	fprintf(stderr, "error allocating memory for prime number grid\n");
-	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
-    }
+    *grid = alloc_grid(len);
 }
 
 
@@ -120,7 +119,8 @@ void initialize_grid(char **grid, int len) {
  * numbers from {1, ..., rootn} is done simultaneously as marking off odd
  * multiples of the primes.  If it is not the 0-th process, then the process
  * waits for a broadcast from the 0-th process for each prime number before
- * marking off multiples.
+ * marking off multiples.  This serial search is the algorithm of the text that
+ * the later exercises improve on, so it is left as is.
  */
 
 void fill_grid_v1(char *grid_local, int rootn, int local_low, int local_setsize, int rank) {
@@ -241,6 +241,100 @@ void fill_grid_rootn(char *grid_rootn, int rootn, int rootn_setsize) {
 
 
 
+/* The same as fill_grid_rootn, except that the grid is computed once per node
+ * and shared by the processes of the node through an MPI shared-memory window,
+ * which is written to *win and must be freed with MPI_Win_free.  *grid_rootn
+ * is set to point to the start of the grid.
+ *
+ * The window is split into one contiguous slice of the grid per process of the
+ * node, and each process marks the multiples in its own slice of the odd
+ * primes up to sqrt(rootn), which it finds with a small private grid.  Once
+ * every process of the node has finished, the whole grid is visible to all of
+ * them without any copies.
+ *
+ * The exercises that use this grid are bounded by an int n, so rootn is at
+ * most 46341 and the small private grid at most 108 values, and the work on
+ * the grid is already split among the processes of each node.  This is why
+ * they do not use gather_sieving_primes of segsieve_helper.c, which is meant
+ * for the sqrt(n) up to 1e9 of the segmented sieve.
+ */
+
+void fill_grid_rootn_shared(char **grid_rootn, int rootn, int rootn_setsize,
+			    MPI_Win *win) {
+
+    MPI_Comm node_comm;   // the processes that share memory with this one
+    int node_rank;
+    int node_size;
+    char *slice;          // this process's slice of the grid
+    int slice_low;        // index in the grid of the first element of slice
+    int slice_size;       // number of elements in slice
+
+    char *grid_small;     // track if odd vals in {1, ..., sqrt(rootn)} have factors
+    int rootrootn;        // floor( sqrt(rootn) )
+    int small_setsize;    // number of odd values in {1, ..., rootrootn}
+    MPI_Aint winsize;
+    int disp_unit;
+    int currval;
+    int curr_idx;
+    int k;
+
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL,
+			&node_comm);
+    MPI_Comm_size(node_comm, &node_size);
+    MPI_Comm_rank(node_comm, &node_rank);
+
+    /* The slices are allocated contiguously in rank order, so the grid starts
+     * at the first slice with a nonzero size, which is what querying
+     * MPI_PROC_NULL returns
+     */
+    slice_low = BLOCK_LOW(node_rank, node_size, rootn_setsize);
+    slice_size = BLOCK_SIZE(node_rank, node_size, rootn_setsize);
+    MPI_Win_allocate_shared(slice_size, 1, MPI_INFO_NULL, node_comm, &slice, win);
+    MPI_Win_shared_query(*win, MPI_PROC_NULL, &winsize, &disp_unit, grid_rootn);
+
+    // The sieving primes of the grid
+    rootrootn = sqrt(rootn);
+    small_setsize = (rootrootn + 1) / 2;
+    initialize_grid(&grid_small, small_setsize);
+    fill_grid_rootn(grid_small, rootrootn, small_setsize);
+
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, *win);
+
+    for (k = 0; k < slice_size; k++) {
+	slice[k] = NOT_MARK;
+    }
+
+    /* Mark the multiples of each odd prime in {3, ..., sqrt(rootn)} within the
+     * slice.  The odd multiples of currval have the indices congruent to
+     * currval / 2 mod currval, starting with the index of currval^2.
+     */
+    for (curr_idx = 1; curr_idx < small_setsize; curr_idx++) {
+	if (grid_small[curr_idx]) {
+	    continue;
+	}
+	currval = (2 * curr_idx) + 1;
+	k = currval * currval / 2;
+	if (k < slice_low) {
+	    k += ((slice_low - k + currval - 1) / currval) * currval;
+	}
+	for (k -= slice_low; k < slice_size; k += currval) {
+	    slice[k] = YES_MARK;
+	}
+    }
+
+    // Make the slices of every process of the node visible to the others
+    MPI_Win_sync(*win);
+    MPI_Barrier(node_comm);
+    MPI_Win_sync(*win);
+    MPI_Win_unlock_all(*win);
+
+    free_grid(grid_small);
+    MPI_Comm_free(&node_comm);
+}
+
+
+
+
 /* Find the odd values in the set {local_low, ..., local_high} that have factors
  * and flag the corresponding elements in the array grid_local with the value
  * YES_MARK.
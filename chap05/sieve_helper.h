@@ -1,3 +1,5 @@
+#include "grid_alloc.h"
+
 
 void local_set_params(int startval, int endval, int rank, int size, 
 		      int *low_value, int *high_value, int *set_size);
@@ -10,6 +12,9 @@ void fill_grid_v1(char *grid_local, int rootn, int local_low, int local_setsize,
 
 void fill_grid_rootn(char *grid_rootn, int rootn, int rootn_setsize);
 
+void fill_grid_rootn_shared(char **grid_rootn, int rootn, int rootn_setsize,
+			    MPI_Win *win);
+
 void fill_grid_local_v2(char *grid_locol, char *grid_rootn, int rootn_setsize, 
 			int local_low, int local_high, int local_setsize);
 
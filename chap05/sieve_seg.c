@@ -0,0 +1,290 @@
+/* A segmented bit sieve for the set {2, 3, ..., n} with n up to 1e18, built on
+ * the engines of segsieve_helper.c and atkin_helper.c rather than on the char
+ * grids of sieve_helper.c.  The set is split into contiguous blocks as in the
+ * exercises (see local_set_params_ll), each process sieves its block a
+ * segment at a time so that its memory does not grow with n, and the local
+ * prime counts are summed with MPI_Reduce.
+ */
+
+/* Accepts an argument n for the set {2, 3, ..., n} in which we count prime
+ * numbers (default 1e6), and an argument e for the sieve engine: "erat" (the
+ * default) for the segmented Sieve of Eratosthenes, or "atkin" for the
+ * segmented Sieve of Atkin.
+ *
+ * Given an argument k, the program instead finds the k-th prime p_k, by
+ * counting the primes up to an estimate of p_k and then sieving the short
+ * window between the estimate and p_k (see nth_prime in primecount_helper.c).
+ *
+ * Given the argument a, the program also computes the sum of the primes up to
+ * n, the sum of their squares, the sum of their reciprocals, and the sum of
+ * the reciprocals of the twin primes.  Each process aggregates the primes of
+ * its block as they are sieved, and the aggregates are combined by a
+ * user-defined MPI reduction, so the primes are never stored.
+ *
+ * Given an argument o, the program writes the primes up to n to the prime file
+ * of that name instead (see primefile_helper.h).  Each process encodes the
+ * primes of its block as they are sieved, and the processes write their parts
+ * of the file at once with MPI-IO.  read_primes reads the file back.
+ *
+ * Given an argument p, the progress of the sieve is reported about every p
+ * seconds (see progress_helper.h), to stdout or, given an argument s, appended
+ * to the status file of that name.
+ *
+ * Given an argument q, a comma-separated list of moduli, the program instead
+ * counts the primes up to n in every residue class modulo each of the moduli,
+ * i.e. pi(n; q, a) for every q and a, in a single pass of the sieve (see
+ * residue_helper.h).  The counts of each process are combined with a single
+ * MPI_Reduce of all of the classes of all of the moduli.
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "parse_args.h"
+#include "primecount_helper.h"
+#include "aggregate_helper.h"
+#include "primefile_helper.h"
+#include "residue_helper.h"
+
+#define MAX_N  1000000000000000000LL  // 1e18
+#define MAX_K  24739954287740860LL    // pi(1e18)
+
+
+int main(int argc, char *argv[]) {
+
+    int rank;           // process rank
+    int size;           // number of processes
+
+    long long n;        // gives the set {2, 3, ..., n} to search for primes
+    long long k;        // index of the prime to find, or 0 to count primes
+    const char *ename;  // name of the sieve engine
+    int engine;         // the sieve engine, one of ENGINE_*
+    int aggregate;      // whether to compute the aggregates of the primes
+    const char *outfile;  // name of the prime file to export to, or NULL
+    double interval;    // seconds between progress reports, or 0 for none
+    const char *status;   // name of the status file, or NULL for stdout
+    const char *mstr;     // list of moduli for residue counts, or NULL
+    progress_monitor progress;
+    progress_monitor *pm;   // &progress, or NULL without progress reports
+
+    int *primes;              // odd primes up to sqrt(n)
+    int nprimes;
+
+    long long nprime_global;  // number of prime numbers in {2, ..., n}
+    long long local_low;      // lowest odd value in local set
+    long long local_high;     // highest value in local set (can be even)
+    long long local_setsize;  // number of odd values in local set
+    prime_aggregate agg_local;   // aggregates of the primes in the local set
+    prime_aggregate agg_global;  // aggregates of the primes in {2, ..., n}
+    MPI_Datatype agg_type;
+    MPI_Op agg_op;
+    char sum_str[U192_STRLEN];
+    char sum2_str[U192_STRLEN];
+    prime_export exp;         // the encoded primes of the local set
+    int moduli[MAX_MODULI];   // the moduli of the residue counts
+    int nmoduli;
+    residue_counts rc;        // residue counts of the primes in the local set
+    long long *hist_global;   // residue counts of the primes in {2, ..., n}
+    long long pk;             // the k-th prime
+    long long estimate;       // estimate of the k-th prime
+    long long nprime_est;     // number of primes up to the estimate
+    long long nwindow;        // number of values in the correction windows
+    double elapsed;           // parallel execution time
+    long long i;
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Start the timer
+    MPI_Barrier(MPI_COMM_WORLD);
+    elapsed = -MPI_Wtime();
+
+    // Get the number of the processes
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    // Get the rank of the process
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* Default value of n is set to 1e6 and the engine to "erat"; if arguments
+     * are passed in through the command line then they will be set by
+     * parse_sieve_args
+     */
+    n = 1e6;
+    k = 0;
+    ename = "erat";
+    aggregate = 0;
+    outfile = NULL;
+    interval = 0;
+    status = NULL;
+    mstr = NULL;
+    parse_sieve_args(argc, argv, &n, &ename, &k, &aggregate, &outfile,
+		     &interval, &status, &mstr);
+    if (!strcmp(ename, "erat")) {
+	engine = ENGINE_ERAT;
+    }
+    else if (!strcmp(ename, "atkin")) {
+	engine = ENGINE_ATKIN;
+    }
+    else {
+	fprintf(stderr, "Invalid engine \"%s\"\n", ename);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    if (n > MAX_N) {
+	fprintf(stderr, "n must be <= %lld\n", MAX_N);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    if (k > MAX_K) {
+	fprintf(stderr, "k must be <= %lld\n", MAX_K);
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    if ((outfile != NULL) && (k || aggregate)) {
+	fprintf(stderr, "o cannot be combined with k or a\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    if ((mstr != NULL) && (k || aggregate || (outfile != NULL))) {
+	fprintf(stderr, "q cannot be combined with k, a, or o\n");
+	MPI_Abort(MPI_COMM_WORLD, MPI_ERR_ARG);
+    }
+    nmoduli = (mstr != NULL) ? parse_moduli(mstr, moduli) : 0;
+    hist_global = NULL;
+    pm = NULL;
+    if (interval > 0) {
+	init_progress(&progress, interval, status);
+	pm = &progress;
+    }
+
+    // case: find the k-th prime
+    if (k) {
+	pk = nth_prime(engine, k, rank, size, &estimate, &nprime_est, &nwindow,
+			pm);
+    }
+    /* case: aggregate the primes up to n.  The even prime 2 is added by hand
+     * by rank 0, before its odd primes.
+     */
+    else if (aggregate) {
+	nprimes = gather_sieving_primes((int) isqrt_ll(n), rank, size, &primes);
+	local_set_params_ll(1, n, rank, size, &local_low, &local_high, &local_setsize);
+	init_aggregate(&agg_local);
+	if (!rank) {
+	    add_prime_aggregate(&agg_local, 2);
+	}
+	monitored_range(engine, local_low, local_high, primes, nprimes,
+			aggregate_segment, &agg_local, pm);
+	free(primes);
+
+	create_aggregate_op(&agg_type, &agg_op);
+	MPI_Reduce(&agg_local, &agg_global, 1, agg_type, agg_op, 0, MPI_COMM_WORLD);
+	MPI_Op_free(&agg_op);
+	MPI_Type_free(&agg_type);
+	nprime_global = agg_global.count;
+    }
+    /* case: export the primes up to n.  As for the aggregates, the even prime
+     * 2 is added by hand by rank 0.
+     */
+    else if (outfile != NULL) {
+	nprimes = gather_sieving_primes((int) isqrt_ll(n), rank, size, &primes);
+	local_set_params_ll(1, n, rank, size, &local_low, &local_high, &local_setsize);
+	init_prime_export(&exp, PRIME_BLOCK_LEN);
+	if (!rank) {
+	    add_export_prime(&exp, 2);
+	}
+	monitored_range(engine, local_low, local_high, primes, nprimes,
+			export_segment, &exp, pm);
+	free(primes);
+
+	write_prime_file(&exp, outfile, n, MPI_COMM_WORLD);
+	MPI_Allreduce(&exp.count, &nprime_global, 1, MPI_LONG_LONG, MPI_SUM,
+		      MPI_COMM_WORLD);
+	free_prime_export(&exp);
+    }
+    /* case: count the primes up to n in each residue class.  As for the
+     * aggregates, the even prime 2 is added by hand by rank 0.
+     */
+    else if (nmoduli) {
+	nprimes = gather_sieving_primes((int) isqrt_ll(n), rank, size, &primes);
+	local_set_params_ll(1, n, rank, size, &local_low, &local_high, &local_setsize);
+	init_residue_counts(&rc, moduli, nmoduli);
+	if (!rank) {
+	    add_residue_prime(&rc, 2);
+	}
+	monitored_range(engine, local_low, local_high, primes, nprimes,
+			residue_segment, &rc, pm);
+	free(primes);
+
+	if (!rank) {
+	    hist_global = malloc(rc.nhist * sizeof(long long));
+	    if (hist_global == NULL) {
+		fprintf(stderr, "error allocating memory for the residue counts\n");
+		MPI_Abort(MPI_COMM_WORLD, MPI_ERR_OTHER);
+	    }
+	}
+	MPI_Reduce(rc.hist, hist_global, rc.nhist, MPI_LONG_LONG, MPI_SUM, 0,
+		   MPI_COMM_WORLD);
+	free_residue_counts(&rc);
+	// The classes of any one modulus hold every prime
+	nprime_global = 0;
+	for (i = 0; !rank && (i < moduli[0]); i++) {
+	    nprime_global += hist_global[i];
+	}
+    }
+    // case: count the primes up to n, each process sieving its block
+    else {
+	nprimes = gather_sieving_primes((int) isqrt_ll(n), rank, size, &primes);
+	nprime_global = count_range(engine, 1, n, primes, nprimes, rank, size,
+				    pm);
+	free(primes);
+    }
+
+    if (pm != NULL) {
+	free_progress(pm);
+    }
+
+    // Stop the timer
+    elapsed += MPI_Wtime();
+
+    // Finalize the MPI environment
+    MPI_Finalize();
+
+    // Print the results
+    if (!rank && k) {
+	printf("\n"
+	       "The estimate li^-1(%lld) is %lld, and %lld primes are less than or\n"
+	       "equal to it; %lld values past it were sieved (engine %s)\n"
+	       "\n"
+	       "The %lld-th prime is %lld\n"
+	       "Total elapsed time: %10.6f\n"
+	       "\n",
+	       k, estimate, nprime_est, nwindow, ename, k, pk, elapsed);
+    }
+    else if (!rank) {
+	printf("\n"
+	       "%lld primes are less than or equal to %lld (engine %s)\n",
+	       nprime_global, n, ename);
+	if (outfile != NULL) {
+	    printf("They were written to \"%s\"\n", outfile);
+	}
+	if (aggregate) {
+	    sprint_u192(sum_str, 0, agg_global.sum);
+	    sprint_u192(sum2_str, agg_global.sum2_hi, agg_global.sum2);
+	    printf("\n"
+		   "The sum of the primes is:                     %s\n"
+		   "The sum of the squares of the primes is:      %s\n"
+		   "The sum of the reciprocals of the primes is:  %.15f\n"
+		   "The number of twin prime pairs is:            %lld\n"
+		   "The sum of their reciprocals is:              %.15f\n",
+		   sum_str, sum2_str, agg_global.recip + agg_global.recip_comp,
+		   agg_global.ntwins, agg_global.twin + agg_global.twin_comp);
+	}
+	if (nmoduli) {
+	    print_residue_counts(hist_global, moduli, nmoduli);
+	    free(hist_global);
+	}
+	printf("Total elapsed time: %10.6f\n"
+	       "\n",
+	       elapsed);
+    }
+
+    return 0;
+}